@@ -7,24 +7,87 @@
  *     Bouncing ball animation with optimized circle rendering
  *     using pre-computed geometry and DMA-accelerated drawing.
  *
+ *     Up to BOUNCER_MAX balls move in Q16.16 fixed point and
+ *     collide with each other; ballphys.c runs the physics,
+ *     this file draws the result.
+ *
+ *     Each frame, every ball's old position (erase) and new
+ *     position (draw) is added to a SpanBatch. The batch is
+ *     then swept top to bottom: each screen row is built once
+ *     in a row buffer, background first and balls on top, and
+ *     spans closer than SPAN_MERGE_GAP are sent as a single
+ *     transfer. No pixel is sent twice in a frame, and a
+ *     ball's erase and redraw share transfers.
+ *
+ *     Every disc in a batch carries its own radius; disc
+ *     shapes come from the circle.c cache. Balls are drawn
+ *     anti-aliased: the edge pixels of each row are blended
+ *     against the background through a per-ball table that
+ *     is rebuilt only when the ball changes color. Erases
+ *     reach one pixel past the solid edge to clear the
+ *     blended fringe.
+ *
+ *     In trail mode (trail.c) the background under the balls
+ *     is the fading trail. A row whose trail changed is added
+ *     to the sweep as one more erase span, and trail rows no
+ *     ball touches are sent after the sweep.
+ *
  **************************************************************/
 
 #include "ball.h"
+#include "circle.h"
+#include "trail.h"
 #include "../lib/src/ST7789/hardware.h"
 #include "../lib/src/graphics/util.h"
 #include <stdint.h>
 #include <stdbool.h>
 
 #define BORDER 1
-#define MAX_R 32
-
-static uint8_t halfw[MAX_R + 1];
-static int cached_r = -1;
+#define MAX_R 100
+
+#define SPAN_MERGE_GAP 16
+#define BATCH_MAX      (2 * BOUNCER_MAX)
+
+typedef struct {
+        int16_t cx, cy;
+        int16_t top;
+        int16_t r;
+        const CircleTable *shape;
+        const uint16_t *lut;
+        uint16_t color;
+        bool erase;
+} Disc;
+
+typedef struct {
+        int16_t x0, x1;
+        int16_t cx;
+        uint8_t hw;
+        uint8_t cover;
+        const uint16_t *lut;
+        uint16_t color;
+        bool erase;
+} Span;
+
+typedef struct {
+        uint n;
+        uint16_t bg;
+        const uint16_t *trail;
+        Disc d[BATCH_MAX];
+} SpanBatch;
+
+static SpanBatch batch;
+static uint16_t rowbuf[2][SCREEN_WIDTH];
+static uint rowbuf_next = 0;
 
 static inline uint16_t swap565(uint16_t c);
-static void precompute_circle(int r);
-static uint16_t next_corner_color(uint16_t cur);
-static void draw_circle_spans(int cx, int cy, int r, uint16_t color);
+static inline int16_t to_pixel(int32_t v);
+static void batch_begin(uint16_t bg, const uint16_t *trail);
+static void batch_add(int cx, int cy, int r, uint16_t color,
+                      const uint16_t *lut, bool erase);
+static void batch_flush(void);
+static void send_run(int y, const Span *spans, uint first, uint last,
+                     int x0, int x1);
+static void flush_trail_rows(void);
 static void draw_border(uint16_t border565);
 
 /********** swap565 ********
@@ -47,36 +110,24 @@ static inline uint16_t swap565(uint16_t c)
         return (uint16_t)((c << 8) | (c >> 8));
 }
 
-/********** precompute_circle ********
+/********** to_pixel ********
  *
- * Pre-compute half-width values for each vertical offset of circle
+ * Round a Q16.16 position to the nearest pixel
  *
  * Parameters:
- *      int r: radius of circle in pixels
+ *      int32_t v: position in Q16.16
  *
- * Return: none
+ * Return: pixel coordinate
  *
  * Expects:
- *      r <= MAX_R
+ *      none
  ************************/
-static void precompute_circle(int r)
+static inline int16_t to_pixel(int32_t v)
 {
-        if (r == cached_r) {
-                return;
-        }
-        cached_r = r;
-
-        int rr = r * r;
-        for (int dy = 0; dy <= r; dy++) {
-                int x = r;
-                while (x > 0 && (x * x + dy * dy) > rr) {
-                        x--;
-                }
-                halfw[dy] = (uint8_t)x;
-        }
+        return (int16_t)((v + BALLPHYS_ONE / 2) >> BALLPHYS_SHIFT);
 }
 
-/********** next_corner_color ********
+/********** bouncer_next_color ********
  *
  * Cycle to next color in predefined palette
  *
@@ -90,8 +141,9 @@ static void precompute_circle(int r)
  *
  * Notes:
  *      Returns first color if current not found in palette
+ *      Also colors the sparks page's bursts
  ************************/
-static uint16_t next_corner_color(uint16_t cur)
+uint16_t bouncer_next_color(uint16_t cur)
 {
         static const uint16_t colors[] = {
                 0xF800, /* red */
@@ -112,59 +164,274 @@ static uint16_t next_corner_color(uint16_t cur)
         return colors[0];
 }
 
-/********** draw_circle_spans ********
+/********** batch_begin ********
  *
- * Draw filled circle using horizontal spans with DMA
+ * Start collecting discs for one frame
  *
  * Parameters:
- *      int cx, cy:              center coordinates
- *      int r:                   radius in pixels
- *      uint16_t color:          fill color (RGB565)
+ *      uint16_t bg:           background color (RGB565) for
+ *                             erased discs
+ *      const uint16_t *trail: blend table for trail pixels, or
+ *                             NULL without trails
  *
  * Return: none
  *
  * Expects:
- *      r <= MAX_R
- *      precompute_circle(r) has been called
+ *      none
+ ************************/
+static void batch_begin(uint16_t bg, const uint16_t *trail)
+{
+        batch.n = 0;
+        batch.bg = bg;
+        batch.trail = trail;
+}
+
+/********** batch_add ********
+ *
+ * Add a disc to the frame's batch, keeping it sorted by top
+ *
+ * Parameters:
+ *      int cx, cy:     center in pixels
+ *      int r:          radius in pixels
+ *      uint16_t color: fill color (RGB565), unused if erase
+ *      const uint16_t *lut: edge blend table for color, unused
+ *                      if erase
+ *      bool erase:     true to paint the disc with background
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Fewer than BATCH_MAX discs added since batch_begin
+ *      At most CIRCLE_CACHE_SLOTS different radii per batch
  *
  * Notes:
- *      Clips to screen bounds
+ *      Insertion keeps the order stable, so later draws still
+ *      paint over earlier ones on the same pixels
  ************************/
-static void draw_circle_spans(int cx, int cy, int r, uint16_t color)
+static void batch_add(int cx, int cy, int r, uint16_t color,
+                      const uint16_t *lut, bool erase)
 {
-        static uint16_t spanbuf[2 * MAX_R + 1];
-        uint16_t pix = swap565(color);
+        Disc d = {
+                .cx = (int16_t)cx,
+                .cy = (int16_t)cy,
+                .top = (int16_t)(cy - r),
+                .r = (int16_t)r,
+                .shape = circle_table(r),
+                .lut = lut,
+                .color = color,
+                .erase = erase,
+        };
+        uint i = batch.n++;
 
-        for (int i = 0; i < 2 * r + 1; i++) {
-                spanbuf[i] = pix;
+        while (i > 0 && batch.d[i - 1].top > d.top) {
+                batch.d[i] = batch.d[i - 1];
+                i--;
         }
+        batch.d[i] = d;
+}
 
-        for (int dy = -r; dy <= r; dy++) {
-                int ay = dy < 0 ? -dy : dy;
-                int dx = halfw[ay];
+/********** send_run ********
+ *
+ * Build one run of a row and send it to the panel
+ *
+ * Parameters:
+ *      int y:              screen row
+ *      const Span *spans:  the row's spans, sorted by x0
+ *      uint first, last:   spans [first, last) make up the run
+ *      int x0, x1:         run extent (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= x0 <= x1 < SCREEN_WIDTH
+ *
+ * Notes:
+ *      Gaps between spans are background, or the trail in
+ *      trail mode: nothing else is drawn inside the border
+ *      The two row buffers alternate, so one is filled while
+ *      the previous transfer may still be on the wire
+ ************************/
+static void send_run(int y, const Span *spans, uint first, uint last,
+                     int x0, int x1)
+{
+        uint16_t *buf = rowbuf[rowbuf_next];
+        uint16_t bg = swap565(batch.bg);
+
+        rowbuf_next ^= 1;
+        if (batch.trail != NULL) {
+                trail_row_fill(y, buf, x0, x1, bg, batch.trail);
+        } else {
+                for (int x = x0; x <= x1; x++) {
+                        buf[x] = bg;
+                }
+        }
+        for (uint s = first; s < last; s++) {
+                if (spans[s].erase) {
+                        continue;
+                }
+                const Span *sp = &spans[s];
+                circle_row_fill(buf, sp->x0, sp->x1, sp->cx, sp->hw,
+                                sp->cover, swap565(sp->color), sp->lut);
+        }
 
-                int y = cy + dy;
-                int x0 = cx - dx;
-                int x1 = cx + dx;
+        set_address_window((uint16_t)x0, (uint16_t)y,
+                           (uint16_t)x1, (uint16_t)y);
+        start_display_transfer(buf + x0, (size_t)(x1 - x0 + 1));
+}
 
-                if (y < 0 || y >= SCREEN_HEIGHT) {
-                        continue;
+/********** batch_flush ********
+ *
+ * Draw every disc in the batch, one row at a time
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      batch_begin and batch_add have been called
+ *
+ * Notes:
+ *      Discs enter an active list when the sweep reaches their
+ *      top and leave it after their bottom; rows no disc
+ *      touches are skipped
+ *      Clips to inside the border, which the rim of a ball
+ *      against the wall would otherwise reach
+ *      The active and span lists are static to keep them off
+ *      the render core's small stack
+ *      With trails, each swept row's changed trail range is
+ *      taken as an extra erase span
+ ************************/
+static void batch_flush(void)
+{
+        static uint8_t active[BATCH_MAX];
+        static Span spans[BATCH_MAX + 1];
+        uint nactive = 0;
+        uint next = 0;
+
+        if (batch.n == 0) {
+                return;
+        }
+
+        for (int y = batch.d[0].top; nactive > 0 || next < batch.n; y++) {
+                if (nactive == 0 && batch.d[next].top > y) {
+                        y = batch.d[next].top;
                 }
-                if (x0 < 0) {
-                        x0 = 0;
+                while (next < batch.n && batch.d[next].top <= y) {
+                        active[nactive++] = (uint8_t)next++;
                 }
-                if (x1 >= SCREEN_WIDTH) {
-                        x1 = SCREEN_WIDTH - 1;
+
+                uint n = 0;
+                uint keep = 0;
+                for (uint a = 0; a < nactive; a++) {
+                        const Disc *d = &batch.d[active[a]];
+                        int dy = y - d->cy;
+
+                        if (dy > d->r) {
+                                continue;
+                        }
+                        active[keep++] = active[a];
+
+                        int ady = dy < 0 ? -dy : dy;
+                        int hw = d->shape->halfw[ady];
+                        Span sp = {
+                                .x0 = (int16_t)(d->cx - hw - 1),
+                                .x1 = (int16_t)(d->cx + hw + 1),
+                                .cx = d->cx,
+                                .hw = (uint8_t)hw,
+                                .cover = d->shape->cover[ady],
+                                .lut = d->lut,
+                                .color = d->color,
+                                .erase = d->erase,
+                        };
+                        if (sp.x0 < BORDER) {
+                                sp.x0 = BORDER;
+                        }
+                        if (sp.x1 > SCREEN_WIDTH - 1 - BORDER) {
+                                sp.x1 = SCREEN_WIDTH - 1 - BORDER;
+                        }
+                        if (sp.x0 > sp.x1) {
+                                continue;
+                        }
+
+                        uint i = n++;
+                        while (i > 0 && spans[i - 1].x0 > sp.x0) {
+                                spans[i] = spans[i - 1];
+                                i--;
+                        }
+                        spans[i] = sp;
+                }
+                nactive = keep;
+
+                int t0, t1;
+                if (batch.trail != NULL && y >= 0 && y < SCREEN_HEIGHT &&
+                    trail_take_row(y, &t0, &t1)) {
+                        Span sp = {
+                                .x0 = (int16_t)(t0 < BORDER ? BORDER : t0),
+                                .x1 = (int16_t)(t1 > SCREEN_WIDTH - 1 - BORDER ?
+                                                SCREEN_WIDTH - 1 - BORDER : t1),
+                                .erase = true,
+                        };
+                        uint i = n++;
+                        while (i > 0 && spans[i - 1].x0 > sp.x0) {
+                                spans[i] = spans[i - 1];
+                                i--;
+                        }
+                        spans[i] = sp;
                 }
 
-                int len = x1 - x0 + 1;
-                if (len <= 0) {
+                if (y < 0 || y >= SCREEN_HEIGHT || n == 0) {
                         continue;
                 }
 
-                set_address_window((uint16_t)x0, (uint16_t)y,
-                                   (uint16_t)x1, (uint16_t)y);
-                start_display_transfer(spanbuf, (size_t)len);
+                uint first = 0;
+                int x0 = spans[0].x0;
+                int x1 = spans[0].x1;
+                for (uint s = 1; s < n; s++) {
+                        if (spans[s].x0 > x1 + SPAN_MERGE_GAP) {
+                                send_run(y, spans, first, s, x0, x1);
+                                first = s;
+                                x0 = spans[s].x0;
+                                x1 = spans[s].x1;
+                        } else if (spans[s].x1 > x1) {
+                                x1 = spans[s].x1;
+                        }
+                }
+                send_run(y, spans, first, n, x0, x1);
+        }
+}
+
+/********** flush_trail_rows ********
+ *
+ * Send the trail rows the sweep did not reach
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      batch_flush has run with trails on
+ *
+ * Notes:
+ *      No ball is on these rows, so each changed range is
+ *      sent as a run of trail and background only
+ ************************/
+static void flush_trail_rows(void)
+{
+        for (int y = BORDER; y < SCREEN_HEIGHT - BORDER; y++) {
+                int x0, x1;
+
+                if (trail_take_row(y, &x0, &x1) == false) {
+                        continue;
+                }
+                if (x0 < BORDER) {
+                        x0 = BORDER;
+                }
+                if (x1 > SCREEN_WIDTH - 1 - BORDER) {
+                        x1 = SCREEN_WIDTH - 1 - BORDER;
+                }
+                send_run(y, NULL, 0, 0, x0, x1);
         }
 }
 
@@ -214,52 +481,102 @@ static void draw_border(uint16_t border565)
  * Initialize bouncing ball animation state
  *
  * Parameters:
- *      Bouncer *b:             pointer to Bouncer structure
- *      int radius:             ball radius (clamped to MAX_R)
- *      int vx, vy:             initial velocity components
- *      uint16_t bg_color:      background color (RGB565)
- *      uint16_t border_color:  border color (RGB565)
- *      uint16_t initial_color: starting ball color (RGB565)
+ *      Bouncer *b:               pointer to Bouncer structure
+ *      uint count:               number of balls (1 to BOUNCER_MAX)
+ *      int radius:               ball radius (clamped to MAX_R, or
+ *                                BOUNCER_MAX_MULTI_R for several)
+ *      const BallParams *params: gravity, restitution, friction
+ *      uint16_t bg_color:        background color (RGB565)
+ *      uint16_t border_color:    border color (RGB565)
+ *      uint16_t initial_color:   first ball's color (RGB565)
+ *      bool trail:               leave fading trails behind the
+ *                                balls
  *
  * Return: none
  *
  * Expects:
- *      b is not NULL
+ *      b and params are not NULL
  *
  * Notes:
- *      Clears screen, draws border, positions ball at center
- *      Pre-computes circle geometry for efficient rendering
+ *      Draws border and balls
+ *      Screen must already be cleared to bg_color
+ *      Starting positions and speeds come from ballphys_init
+ *      and are the same on every run
+ *      Circle geometry comes from the circle.c cache
  ************************/
-void bouncer_init(Bouncer *b, int radius, int vx, int vy, uint16_t bg_color, 
-                  uint16_t border_color, uint16_t initial_color)
+void bouncer_init(Bouncer *b, uint count, int radius,
+                  const BallParams *params, uint16_t bg_color,
+                  uint16_t border_color, uint16_t initial_color,
+                  bool trail)
 {
         if (radius > MAX_R) {
                 radius = MAX_R;
         }
+        if (count > 1 && radius > BOUNCER_MAX_MULTI_R) {
+                radius = BOUNCER_MAX_MULTI_R;
+        }
 
-        b->r = radius;
-        b->vx = vx;
-        b->vy = vy;
+        ballphys_init(&b->w, count, radius, BORDER, BORDER,
+                      SCREEN_WIDTH - 1 - BORDER, SCREEN_HEIGHT - 1 - BORDER,
+                      params);
         b->bg = bg_color;
         b->border = border_color;
-        b->color = initial_color;
-
-        precompute_circle(radius);
+        b->trail = trail;
+        if (trail) {
+                trail_reset();
+        }
 
-        b->cx = SCREEN_WIDTH / 2;
-        b->cy = SCREEN_HEIGHT / 2;
+        uint16_t color = initial_color;
+        for (uint i = 0; i < b->w.count; i++) {
+                b->color[i] = color;
+                circle_blend_lut(b->edge[i], color, bg_color);
+                color = bouncer_next_color(color);
+        }
 
-        fill_screen(bg_color);
         draw_border(border_color);
-        draw_circle_spans(b->cx, b->cy, b->r, b->color);
+
+        b->drawn_r = (int16_t)radius;
+        batch_begin(bg_color, NULL);
+        for (uint i = 0; i < b->w.count; i++) {
+                b->drawn_x[i] = to_pixel(b->w.x[i]);
+                b->drawn_y[i] = to_pixel(b->w.y[i]);
+                batch_add(b->drawn_x[i], b->drawn_y[i], radius, b->color[i],
+                          b->edge[i], false);
+        }
+        batch_flush();
+}
+
+/********** bouncer_prewarm ********
+ *
+ * Pre-compute circle geometry before the page is entered
+ *
+ * Parameters:
+ *      int radius: ball radius (clamped to MAX_R)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Loads the radius into the circle.c cache, so the
+ *      first frame finds it there
+ ************************/
+void bouncer_prewarm(int radius)
+{
+        if (radius > MAX_R) {
+                radius = MAX_R;
+        }
+        circle_table(radius);
 }
 
 /********** bouncer_tick ********
  *
- * Update ball position and appearance for one frame
+ * Update ball positions and appearance for one frame
  *
  * Parameters:
  *      Bouncer *b: pointer to initialized Bouncer structure
+ *      int steps:  physics steps to run before drawing (min 1)
  *
  * Return: none
  *
@@ -268,51 +585,57 @@ void bouncer_init(Bouncer *b, int radius, int vx, int vy, uint16_t bg_color,
  *      bouncer_init has been called on b
  *
  * Notes:
- *      Handles collision detection and velocity reversal
- *      Changes color on corner impacts
- *      Erases old position and draws new position
+ *      Runs several steps when the caller is catching up on
+ *      missed frames, then erases every old position and
+ *      draws every new one in a single batched sweep
+ *      A ball changes color when one step bounces it off two
+ *      walls (a corner)
+ *      With trails, each ball stamps its new position into
+ *      the trail, where it shows once the ball has moved on;
+ *      trails take the first ball's color
  ************************/
-void bouncer_tick(Bouncer *b)
+void bouncer_tick(Bouncer *b, int steps)
 {
-        const int min_x = BORDER + b->r;
-        const int max_x = (SCREEN_WIDTH - 1 - BORDER) - b->r;
-        const int min_y = BORDER + b->r;
-        const int max_y = (SCREEN_HEIGHT - 1 - BORDER) - b->r;
-
-        int oldx = b->cx;
-        int oldy = b->cy;
-
-        b->cx += b->vx;
-        b->cy += b->vy;
-
-        bool hit_v = false;
-        bool hit_h = false;
+        BallWorld *w = &b->w;
 
-        if (b->cx <= min_x) {
-                b->cx = min_x;
-                b->vx = -b->vx;
-                hit_v = true;
+        if (steps < 1) {
+                steps = 1;
         }
-        if (b->cx >= max_x) {
-                b->cx = max_x;
-                b->vx = -b->vx;
-                hit_v = true;
-        }
-        if (b->cy <= min_y) {
-                b->cy = min_y;
-                b->vy = -b->vy;
-                hit_h = true;
-        }
-        if (b->cy >= max_y) {
-                b->cy = max_y;
-                b->vy = -b->vy;
-                hit_h = true;
+        for (int s = 0; s < steps; s++) {
+                ballphys_step(w);
+                for (uint i = 0; i < w->count; i++) {
+                        if (w->hit[i] == (BALLPHYS_HIT_X | BALLPHYS_HIT_Y)) {
+                                b->color[i] = bouncer_next_color(b->color[i]);
+                                circle_blend_lut(b->edge[i], b->color[i],
+                                                 b->bg);
+                        }
+                }
         }
 
-        if (hit_v && hit_h) {
-                b->color = next_corner_color(b->color);
+        const uint16_t *trail_lut = NULL;
+        if (b->trail) {
+                trail_lut = b->edge[0];
+                trail_decay();
         }
 
-        draw_circle_spans(oldx, oldy, b->r, b->bg);
-        draw_circle_spans(b->cx, b->cy, b->r, b->color);
+        batch_begin(b->bg, trail_lut);
+        for (uint i = 0; i < w->count; i++) {
+                batch_add(b->drawn_x[i], b->drawn_y[i], b->drawn_r, 0,
+                          NULL, true);
+        }
+        b->drawn_r = (int16_t)w->r;
+        for (uint i = 0; i < w->count; i++) {
+                b->drawn_x[i] = to_pixel(w->x[i]);
+                b->drawn_y[i] = to_pixel(w->y[i]);
+                batch_add(b->drawn_x[i], b->drawn_y[i], w->r, b->color[i],
+                          b->edge[i], false);
+                if (b->trail) {
+                        trail_stamp(b->drawn_x[i], b->drawn_y[i], w->r,
+                                    circle_table(w->r));
+                }
+        }
+        batch_flush();
+        if (b->trail) {
+                flush_trail_rows();
+        }
 }
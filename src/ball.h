@@ -13,19 +13,59 @@
 #define BALL_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "ballphys.h"
+#include "circle.h"
 
+#define BALL_PAGE_NAME "ball"
+
+#define BOUNCER_MAX BALLPHYS_MAX
+
+/* configure keys for the ball page */
+#define BALL_CFG_COUNT 0
+#define BALL_CFG_PHYS  1
+#define BALL_CFG_TRAIL 2
+
+/* BALL_CFG_PHYS value: three 10-bit fields in thousandths */
+#define BALL_PHYS_PACK(g, e, f) \
+        ((uint32_t)(g) | ((uint32_t)(e) << 10) | ((uint32_t)(f) << 20))
+#define BALL_PHYS_FIELD(v, n)   (((v) >> (10 * (n))) & 0x3ff)
+#define BALL_PHYS_MILLI_MAX     1000
+
+/* balls are kept at least this far apart in the collision grid */
+#define BOUNCER_MAX_MULTI_R 16
+
+/* span batch, row buffers, grid, border buffers */
+#define BOUNCER_SCRATCH_BYTES (2 * BOUNCER_MAX * 20 + 8 +              \
+                               2 * 2 * 320 + 80 + BOUNCER_MAX +      \
+                               2 * (320 + 240))
+
+/*
+ * The physics world plus what drawing needs: drawn_x/drawn_y
+ * are where each ball was last drawn, in whole pixels, and
+ * drawn_r the radius it was drawn with. edge[i] blends
+ * color[i] over bg for the anti-aliased rim. trail turns on
+ * the fading trails of trail.c.
+ */
 typedef struct {
-        int cx, cy;
-        int vx, vy;
-        int r;
-        uint16_t color;
+        BallWorld w;
+        int16_t drawn_x[BOUNCER_MAX];
+        int16_t drawn_y[BOUNCER_MAX];
+        int16_t drawn_r;
+        uint16_t color[BOUNCER_MAX];
+        uint16_t edge[BOUNCER_MAX][CIRCLE_LEVELS];
         uint16_t bg;
         uint16_t border;
+        bool trail;
 } Bouncer;
 
-void bouncer_init(Bouncer *b, int radius, int vx, int vy,
-                  uint16_t bg_color, uint16_t border_color,
-                  uint16_t initial_color);
-void bouncer_tick(Bouncer *b);
+void bouncer_init(Bouncer *b, uint count, int radius,
+                  const BallParams *params, uint16_t bg_color,
+                  uint16_t border_color, uint16_t initial_color,
+                  bool trail);
+void bouncer_tick(Bouncer *b, int steps);
+void bouncer_prewarm(int radius);
+uint16_t bouncer_next_color(uint16_t cur);
 
 #endif
@@ -0,0 +1,536 @@
+/**************************************************************
+ *
+ *                          ballphys.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Ball physics in Q16.16 fixed point. Speeds are not
+ *     limited to whole pixels per step, and everything is
+ *     integer arithmetic with no dependence on wall-clock
+ *     time, so the same start state run for the same number of
+ *     steps gives a bit-identical trajectory on the widget and
+ *     in a host test.
+ *
+ *     Each step is semi-implicit Euler: gravity is added to
+ *     the velocity, then the velocity to the position. Balls
+ *     that collide are separated and bounced; walls come last.
+ *
+ *     A ball that crosses a wall during a step reached it part
+ *     way through; it spends the rest of the step travelling
+ *     back at its reduced speed, so the overshoot is mirrored
+ *     and scaled by the restitution rather than clamped. That
+ *     keeps bounce timing exact at any speed. A bounce slower
+ *     than one step's gravity leaves the ball resting on the
+ *     wall instead of jittering on it.
+ *
+ *     Candidate ball pairs come from a uniform grid of
+ *     BALL_CELL-pixel cells: a ball is only tested against
+ *     balls in its own cell and the four cells after it, so
+ *     the cost grows with the number of balls rather than its
+ *     square.
+ *
+ **************************************************************/
+
+#include "ballphys.h"
+#include "../lib/src/graphics/util.h"
+
+#define BALL_CELL_SHIFT 5
+#define BALL_CELL       (1 << BALL_CELL_SHIFT)
+#define GRID_COLS       ((SCREEN_WIDTH + BALL_CELL - 1) / BALL_CELL)
+#define GRID_ROWS       ((SCREEN_HEIGHT + BALL_CELL - 1) / BALL_CELL)
+#define GRID_NONE       0xff
+
+static uint8_t cell_head[GRID_COLS * GRID_ROWS];
+static uint8_t cell_next[BALLPHYS_MAX];
+
+static inline int32_t fx_mul(int32_t a, int32_t b);
+static int32_t fx_from_milli(uint v);
+static uint32_t isqrt32(uint32_t v);
+static bool wall(int32_t *p, int32_t *v, int32_t *vt, int32_t lo,
+                 int32_t hi, int32_t rest, const BallParams *k);
+static void collide(BallWorld *w, uint i, uint j);
+static void collide_cells(BallWorld *w, uint a, int col, int row);
+static void collisions(BallWorld *w);
+static void walls(BallWorld *w);
+
+/********** fx_mul ********
+ *
+ * Multiply two Q16.16 values
+ *
+ * Parameters:
+ *      int32_t a, b: Q16.16 operands
+ *
+ * Return: a * b in Q16.16, rounded toward minus infinity
+ *
+ * Expects:
+ *      Result fits in 32 bits
+ ************************/
+static inline int32_t fx_mul(int32_t a, int32_t b)
+{
+        return (int32_t)(((int64_t)a * b) >> BALLPHYS_SHIFT);
+}
+
+/********** fx_from_milli ********
+ *
+ * Convert thousandths to Q16.16
+ *
+ * Parameters:
+ *      uint v: value in thousandths
+ *
+ * Return: v / 1000 in Q16.16, rounded to nearest
+ *
+ * Expects:
+ *      v <= 32000
+ ************************/
+static int32_t fx_from_milli(uint v)
+{
+        return (int32_t)(((uint32_t)v * BALLPHYS_ONE + 500) / 1000);
+}
+
+/********** ballphys_params ********
+ *
+ * Fill in physics parameters from integer thousandths
+ *
+ * Parameters:
+ *      BallParams *p:           parameters to set
+ *      uint gravity_milli:      gravity, thousandths of a pixel
+ *                               per step per step
+ *      uint restitution_milli:  bounce speed kept, thousandths
+ *      uint friction_milli:     wall-contact tangential speed
+ *                               kept per step, thousandths
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ *
+ * Notes:
+ *      Restitution and friction are capped at 1000, so
+ *      bounces never add energy
+ *      0, 1000, 1000 is the classic frictionless bouncer
+ ************************/
+void ballphys_params(BallParams *p, uint gravity_milli,
+                     uint restitution_milli, uint friction_milli)
+{
+        if (gravity_milli > 32000) {
+                gravity_milli = 32000;
+        }
+        if (restitution_milli > 1000) {
+                restitution_milli = 1000;
+        }
+        if (friction_milli > 1000) {
+                friction_milli = 1000;
+        }
+
+        p->gravity = fx_from_milli(gravity_milli);
+        p->restitution = fx_from_milli(restitution_milli);
+        p->friction = fx_from_milli(friction_milli);
+}
+
+/********** ballphys_init ********
+ *
+ * Place balls and give them their starting velocities
+ *
+ * Parameters:
+ *      BallWorld *w:             world to initialize
+ *      uint count:               number of balls (1 to
+ *                                BALLPHYS_MAX)
+ *      int r:                    ball radius in pixels
+ *      int x0, y0, x1, y1:       inclusive pixel area the balls
+ *                                must stay inside
+ *      const BallParams *params: physics parameters (copied)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      w and params are not NULL
+ *      The area is wider and taller than 2 * r + 1
+ *      2 * r <= BALL_CELL when count > 1
+ *
+ * Notes:
+ *      One ball starts at the center moving at 2px/step on
+ *      both axes; several start on a lattice around the
+ *      center with speeds from a fixed pseudo-random
+ *      sequence, so every run is the same
+ ************************/
+void ballphys_init(BallWorld *w, uint count, int r,
+                   int x0, int y0, int x1, int y1,
+                   const BallParams *params)
+{
+        if (count < 1) {
+                count = 1;
+        }
+        if (count > BALLPHYS_MAX) {
+                count = BALLPHYS_MAX;
+        }
+
+        w->count = count;
+        w->r = r;
+        w->min_x = (x0 + r) * BALLPHYS_ONE;
+        w->max_x = (x1 - r) * BALLPHYS_ONE;
+        w->min_y = (y0 + r) * BALLPHYS_ONE;
+        w->max_y = (y1 - r) * BALLPHYS_ONE;
+        w->params = *params;
+
+        int pitch = 2 * r + 4;
+        int cols = (x1 - x0 + 1) / pitch;
+        if (cols < 1) {
+                cols = 1;
+        }
+        int rows = ((int)count + cols - 1) / cols;
+        int cx0 = (x0 + x1) / 2;
+        int cy0 = (y0 + y1) / 2;
+        int left = cx0 - ((cols - 1) * pitch) / 2;
+        int top = cy0 - ((rows - 1) * pitch) / 2;
+        uint32_t seed = 0x2545f491u;
+
+        for (uint i = 0; i < count; i++) {
+                int cx = left + (int)(i % (uint)cols) * pitch;
+                int cy = top + (int)(i / (uint)cols) * pitch;
+                int32_t x = cx * BALLPHYS_ONE;
+                int32_t y = cy * BALLPHYS_ONE;
+
+                w->x[i] = x < w->min_x ? w->min_x : x > w->max_x ? w->max_x : x;
+                w->y[i] = y < w->min_y ? w->min_y : y > w->max_y ? w->max_y : y;
+                w->hit[i] = 0;
+                if (count == 1) {
+                        w->vx[i] = 2 * BALLPHYS_ONE;
+                        w->vy[i] = 2 * BALLPHYS_ONE;
+                } else {
+                        seed = seed * 1664525u + 1013904223u;
+                        w->vx[i] = (int32_t)(seed >> 13) - (1 << 18);
+                        seed = seed * 1664525u + 1013904223u;
+                        w->vy[i] = (int32_t)(seed >> 13) - (1 << 18);
+                }
+        }
+}
+
+/********** isqrt32 ********
+ *
+ * Integer square root
+ *
+ * Parameters:
+ *      uint32_t v: value
+ *
+ * Return: floor(sqrt(v))
+ *
+ * Expects:
+ *      none
+ ************************/
+static uint32_t isqrt32(uint32_t v)
+{
+        uint32_t root = 0;
+        uint32_t bit = 1u << 30;
+
+        while (bit > v) {
+                bit >>= 2;
+        }
+        while (bit != 0) {
+                if (v >= root + bit) {
+                        v -= root + bit;
+                        root = (root >> 1) + bit;
+                } else {
+                        root >>= 1;
+                }
+                bit >>= 2;
+        }
+        return root;
+}
+
+/********** wall ********
+ *
+ * Bounce one axis of one ball off the walls at lo and hi
+ *
+ * Parameters:
+ *      int32_t *p:          position on this axis
+ *      int32_t *v:          velocity on this axis
+ *      int32_t *vt:         velocity on the other axis
+ *      int32_t lo, hi:      position limits
+ *      int32_t rest:        bounces at or below this speed
+ *                           come to rest
+ *      const BallParams *k: physics parameters
+ *
+ * Return: true if the ball bounced
+ *
+ * Expects:
+ *      lo <= hi
+ *
+ * Notes:
+ *      The overshoot past the wall is mirrored back, scaled
+ *      by the restitution, as the ball would have travelled
+ *      after reaching the wall mid-step
+ *      A ball beyond the wall but already moving away (pushed
+ *      there by a collision) is only moved back onto it
+ *      Any wall contact applies friction to vt
+ ************************/
+static bool wall(int32_t *p, int32_t *v, int32_t *vt, int32_t lo,
+                 int32_t hi, int32_t rest, const BallParams *k)
+{
+        int32_t at;
+        int32_t over;
+
+        if (*p < lo) {
+                at = lo;
+                over = lo - *p;
+                if (*v > 0) {
+                        *p = lo;
+                        return false;
+                }
+        } else if (*p > hi) {
+                at = hi;
+                over = hi - *p;
+                if (*v < 0) {
+                        *p = hi;
+                        return false;
+                }
+        } else {
+                return false;
+        }
+
+        *v = -fx_mul(*v, k->restitution);
+        *vt = fx_mul(*vt, k->friction);
+
+        if (*v <= rest && *v >= -rest) {
+                *v = 0;
+                *p = at;
+                return false;
+        }
+
+        *p = at + fx_mul(over, k->restitution);
+        if (*p < lo) {
+                *p = lo;
+        } else if (*p > hi) {
+                *p = hi;
+        }
+        return true;
+}
+
+/********** collide ********
+ *
+ * Resolve a possible collision between two balls
+ *
+ * Parameters:
+ *      BallWorld *w: balls
+ *      uint i, j:    ball indices
+ *
+ * Return: none
+ *
+ * Expects:
+ *      i != j, both < w->count
+ *
+ * Notes:
+ *      Positions are compared in Q8 so squared distances fit
+ *      in 32 bits; the impulse is computed in 64 bits at full
+ *      velocity precision and rounded to nearest, so energy
+ *      is not bled away by truncation
+ *      Overlapping balls are pushed apart along the line of
+ *      centers; if they are approaching, the velocity along
+ *      that line is exchanged (equal masses), scaled by
+ *      (1 + restitution) / 2
+ ************************/
+static void collide(BallWorld *w, uint i, uint j)
+{
+        int32_t dx = (w->x[j] - w->x[i]) >> 8;
+        int32_t dy = (w->y[j] - w->y[i]) >> 8;
+        int32_t reach = (2 * w->r) << 8;
+        int32_t d2 = dx * dx + dy * dy;
+
+        if (d2 >= reach * reach || d2 == 0) {
+                return;
+        }
+
+        int32_t d = (int32_t)isqrt32((uint32_t)d2);
+        int32_t push = (reach - d + 1) / 2;
+        int32_t px = dx * push / d;
+        int32_t py = dy * push / d;
+
+        w->x[i] -= px * 256;
+        w->y[i] -= py * 256;
+        w->x[j] += px * 256;
+        w->y[j] += py * 256;
+
+        int64_t dot = (int64_t)(w->vx[j] - w->vx[i]) * dx +
+                      (int64_t)(w->vy[j] - w->vy[i]) * dy;
+
+        if (dot >= 0) {
+                return;
+        }
+
+        int32_t share = (BALLPHYS_ONE + w->params.restitution) / 2;
+        int32_t ix = (int32_t)((dot * dx + (dx < 0 ? d2 : -d2) / 2) / d2);
+        int32_t iy = (int32_t)((dot * dy + (dy < 0 ? d2 : -d2) / 2) / d2);
+
+        ix = fx_mul(ix, share);
+        iy = fx_mul(iy, share);
+
+        w->vx[i] += ix;
+        w->vy[i] += iy;
+        w->vx[j] -= ix;
+        w->vy[j] -= iy;
+}
+
+/********** collide_cells ********
+ *
+ * Test every ball in one grid cell against another cell
+ *
+ * Parameters:
+ *      BallWorld *w: balls
+ *      uint a:       index of the first cell
+ *      int col:      column of the second cell
+ *      int row:      row of the second cell
+ *
+ * Return: none
+ *
+ * Expects:
+ *      cell lists built by collisions
+ *
+ * Notes:
+ *      Out-of-range second cells are ignored
+ ************************/
+static void collide_cells(BallWorld *w, uint a, int col, int row)
+{
+        if (col < 0 || col >= GRID_COLS || row >= GRID_ROWS) {
+                return;
+        }
+
+        uint c = (uint)(row * GRID_COLS + col);
+        for (uint8_t i = cell_head[a]; i != GRID_NONE; i = cell_next[i]) {
+                for (uint8_t j = cell_head[c]; j != GRID_NONE;
+                     j = cell_next[j]) {
+                        collide(w, i, j);
+                }
+        }
+}
+
+/********** collisions ********
+ *
+ * Find and resolve ball-ball collisions
+ *
+ * Parameters:
+ *      BallWorld *w: balls
+ *
+ * Return: none
+ *
+ * Expects:
+ *      2 * w->r <= BALL_CELL
+ *
+ * Notes:
+ *      Balls are binned by center into BALL_CELL cells, so
+ *      touching balls are always in the same or neighbouring
+ *      cells; each cell is paired with itself and its right,
+ *      lower-left, lower and lower-right neighbours, which
+ *      visits every neighbouring pair once
+ *      Balls a step has carried past the border are binned
+ *      into the edge cells; walls pulls them back
+ ************************/
+static void collisions(BallWorld *w)
+{
+        for (uint c = 0; c < GRID_COLS * GRID_ROWS; c++) {
+                cell_head[c] = GRID_NONE;
+        }
+        for (uint i = 0; i < w->count; i++) {
+                int col = (w->x[i] >> BALLPHYS_SHIFT) >> BALL_CELL_SHIFT;
+                int row = (w->y[i] >> BALLPHYS_SHIFT) >> BALL_CELL_SHIFT;
+
+                col = col < 0 ? 0 : col >= GRID_COLS ? GRID_COLS - 1 : col;
+                row = row < 0 ? 0 : row >= GRID_ROWS ? GRID_ROWS - 1 : row;
+
+                uint c = (uint)(row * GRID_COLS + col);
+
+                cell_next[i] = cell_head[c];
+                cell_head[c] = (uint8_t)i;
+        }
+
+        for (int row = 0; row < GRID_ROWS; row++) {
+                for (int col = 0; col < GRID_COLS; col++) {
+                        uint a = (uint)(row * GRID_COLS + col);
+
+                        if (cell_head[a] == GRID_NONE) {
+                                continue;
+                        }
+                        for (uint8_t i = cell_head[a]; i != GRID_NONE;
+                             i = cell_next[i]) {
+                                for (uint8_t j = cell_next[i];
+                                     j != GRID_NONE; j = cell_next[j]) {
+                                        collide(w, i, j);
+                                }
+                        }
+                        collide_cells(w, a, col + 1, row);
+                        collide_cells(w, a, col - 1, row + 1);
+                        collide_cells(w, a, col, row + 1);
+                        collide_cells(w, a, col + 1, row + 1);
+                }
+        }
+}
+
+/********** walls ********
+ *
+ * Bounce every ball off the walls
+ *
+ * Parameters:
+ *      BallWorld *w: balls
+ *
+ * Return: none
+ *
+ * Expects:
+ *      w is not NULL
+ *
+ * Notes:
+ *      Sets each ball's hit bits for the step
+ *      Only vertical bounces can come to rest, since gravity
+ *      only acts on y
+ ************************/
+static void walls(BallWorld *w)
+{
+        const BallParams *k = &w->params;
+        int32_t rest = k->gravity < 0 ? -k->gravity : k->gravity;
+
+        for (uint i = 0; i < w->count; i++) {
+                uint8_t hit = 0;
+
+                if (wall(&w->x[i], &w->vx[i], &w->vy[i], w->min_x,
+                         w->max_x, 0, k)) {
+                        hit |= BALLPHYS_HIT_X;
+                }
+                if (wall(&w->y[i], &w->vy[i], &w->vx[i], w->min_y,
+                         w->max_y, rest, k)) {
+                        hit |= BALLPHYS_HIT_Y;
+                }
+                w->hit[i] = hit;
+        }
+}
+
+/********** ballphys_step ********
+ *
+ * Advance every ball by one fixed timestep
+ *
+ * Parameters:
+ *      BallWorld *w: initialized world
+ *
+ * Return: none
+ *
+ * Expects:
+ *      ballphys_init has been called on w
+ *
+ * Notes:
+ *      Walls are applied last so no ball is left outside
+ *      its area
+ ************************/
+void ballphys_step(BallWorld *w)
+{
+        const int32_t g = w->params.gravity;
+
+        for (uint i = 0; i < w->count; i++) {
+                w->vy[i] += g;
+        }
+        for (uint i = 0; i < w->count; i++) {
+                w->x[i] += w->vx[i];
+        }
+        for (uint i = 0; i < w->count; i++) {
+                w->y[i] += w->vy[i];
+        }
+        if (w->count > 1) {
+                collisions(w);
+        }
+        walls(w);
+}
@@ -0,0 +1,67 @@
+/**************************************************************
+ *
+ *                          ballphys.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the ball physics step: Q16.16 sub-pixel
+ *     motion with gravity, restitution and wall friction, and
+ *     ball-to-ball collisions. Integer only, so a given start
+ *     state and step count always gives the same trajectory.
+ *
+ **************************************************************/
+
+#ifndef BALLPHYS_H
+#define BALLPHYS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define BALLPHYS_MAX 64
+
+#define BALLPHYS_SHIFT 16
+#define BALLPHYS_ONE   (1 << BALLPHYS_SHIFT)
+
+/* hit bits: the ball bounced off a left/right or top/bottom wall */
+#define BALLPHYS_HIT_X 0x01
+#define BALLPHYS_HIT_Y 0x02
+
+/*
+ * All Q16.16. gravity is added to vy every step (+y is down);
+ * restitution is the share of normal speed kept by a bounce,
+ * friction the share of tangential speed kept each step a
+ * ball touches a wall.
+ */
+typedef struct {
+        int32_t gravity;
+        int32_t restitution;
+        int32_t friction;
+} BallParams;
+
+/*
+ * Balls as structure-of-arrays, so each pass walks one array
+ * at a time. Positions are Q16.16 pixels, velocities Q16.16
+ * pixels per step; min/max bound the ball centers.
+ */
+typedef struct {
+        uint count;
+        int r;
+        int32_t min_x, max_x;
+        int32_t min_y, max_y;
+        BallParams params;
+        int32_t x[BALLPHYS_MAX];
+        int32_t y[BALLPHYS_MAX];
+        int32_t vx[BALLPHYS_MAX];
+        int32_t vy[BALLPHYS_MAX];
+        uint8_t hit[BALLPHYS_MAX];
+} BallWorld;
+
+void ballphys_params(BallParams *p, uint gravity_milli,
+                     uint restitution_milli, uint friction_milli);
+void ballphys_init(BallWorld *w, uint count, int r,
+                   int x0, int y0, int x1, int y1,
+                   const BallParams *params);
+void ballphys_step(BallWorld *w);
+
+#endif
@@ -0,0 +1,362 @@
+/**************************************************************
+ *
+ *                         capture.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Screen capture over USB. The panel's SDA line is
+ *     write-only on this wiring and there is no framebuffer,
+ *     so nothing can be read back. Instead the display monitor
+ *     hands every address window and pixel transfer to this
+ *     module while a capture is running, and the render core
+ *     redraws the current page. The host replays the windows
+ *     to rebuild the frame.
+ *
+ *     Pixels are run-length encoded as they pass, into chunks
+ *     of at most CAP_PAYLOAD_MAX bytes:
+ *
+ *        BEGIN  - width u16, height u16, page u8
+ *        WINDOW - x0, y0, x1, y1 u16 (inclusive)
+ *        RUNS   - (count u8, RGB565 u16) triples, filling the
+ *                 window row by row from where the last RUNS
+ *                 chunk stopped; colours are plain RGB565,
+ *                 not the byte-swapped form sent to the panel
+ *        END    - pixel count u32
+ *
+ *     All fields are little-endian, and the bytes of a chunk
+ *     sum to 0 mod 256. Chunks go through an SPSC ring to the
+ *     control core, so no full-frame copy is ever held. Unlike
+ *     telemetry, a capture must not lose data: the render core
+ *     waits for room in the ring, which the control core makes
+ *     by writing to USB or, with no host attached, by
+ *     discarding.
+ *
+ **************************************************************/
+
+#include "capture.h"
+#include "sched.h"
+#include "spsc.h"
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+
+#define CAP_QUEUE_LEN 16
+#define CAP_RUN_BYTES 3
+#define CAP_RUN_MAX   255
+
+static CaptureChunk cap_queue_buf[CAP_QUEUE_LEN];
+static SpscQueue cap_queue;
+
+/* render core only */
+static bool active = false;
+static CaptureChunk runs;
+static uint16_t run_pixel;
+static uint run_len = 0;
+static uint32_t pixels = 0;
+
+static void put_u16(CaptureChunk *c, uint16_t v);
+static void emit(CaptureChunk *c);
+static void flush_run(void);
+static void flush_runs(void);
+
+/********** put_u16 ********
+ *
+ * Append a little-endian 16-bit value to a chunk payload
+ *
+ * Parameters:
+ *      CaptureChunk *c: chunk being built
+ *      uint16_t v:      value
+ *
+ * Return: none
+ *
+ * Expects:
+ *      c->len + 2 <= CAP_PAYLOAD_MAX
+ ************************/
+static void put_u16(CaptureChunk *c, uint16_t v)
+{
+        c->payload[c->len++] = (uint8_t)v;
+        c->payload[c->len++] = (uint8_t)(v >> 8);
+}
+
+/********** emit ********
+ *
+ * Seal a chunk and queue it for the control core
+ *
+ * Parameters:
+ *      CaptureChunk *c: chunk with type, len and payload set
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Spins while the ring is full, waking the control core
+ *      each time round
+ ************************/
+static void emit(CaptureChunk *c)
+{
+        c->sync0 = CAP_SYNC0;
+        c->sync1 = CAP_SYNC1;
+
+        uint8_t sum = (uint8_t)(c->sync0 + c->sync1 + c->type + c->len);
+        for (uint i = 0; i < c->len; i++) {
+                sum += c->payload[i];
+        }
+        c->payload[c->len] = (uint8_t)-sum;
+
+        while (spsc_push(&cap_queue, c) == false) {
+                sched_post(SCHED_CORE_CONTROL, SCHED_EV_SHOT);
+                tight_loop_contents();
+        }
+        sched_post(SCHED_CORE_CONTROL, SCHED_EV_SHOT);
+}
+
+/********** flush_run ********
+ *
+ * Move the current run into the RUNS chunk
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Sends the chunk first if the run would not fit
+ ************************/
+static void flush_run(void)
+{
+        if (run_len == 0) {
+                return;
+        }
+        if (runs.len + CAP_RUN_BYTES > CAP_PAYLOAD_MAX) {
+                emit(&runs);
+                runs.len = 0;
+        }
+        runs.payload[runs.len++] = (uint8_t)run_len;
+        put_u16(&runs, (uint16_t)((run_pixel << 8) | (run_pixel >> 8)));
+        run_len = 0;
+}
+
+/********** flush_runs ********
+ *
+ * Send every pixel encoded so far
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+static void flush_runs(void)
+{
+        flush_run();
+        if (runs.len > 0) {
+                emit(&runs);
+                runs.len = 0;
+        }
+}
+
+/********** capture_init ********
+ *
+ * Set up the chunk queue
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 before the render core starts
+ ************************/
+void capture_init(void)
+{
+        spsc_init(&cap_queue, cap_queue_buf, sizeof(CaptureChunk),
+                  CAP_QUEUE_LEN);
+}
+
+/********** capture_begin ********
+ *
+ * Start recording pixels sent to the panel
+ *
+ * Parameters:
+ *      uint page:       page being captured
+ *      uint16_t width:  panel width in pixels
+ *      uint16_t height: panel height in pixels
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      The caller then redraws the whole screen; pixels sent
+ *      before capture_begin are not part of the capture
+ ************************/
+void capture_begin(uint page, uint16_t width, uint16_t height)
+{
+        CaptureChunk c = { .type = CAP_CHUNK_BEGIN };
+
+        put_u16(&c, width);
+        put_u16(&c, height);
+        c.payload[c.len++] = (uint8_t)page;
+        emit(&c);
+
+        runs.type = CAP_CHUNK_RUNS;
+        runs.len = 0;
+        run_len = 0;
+        pixels = 0;
+        active = true;
+}
+
+/********** capture_end ********
+ *
+ * Finish the capture
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Does nothing if no capture is running
+ ************************/
+void capture_end(void)
+{
+        if (active == false) {
+                return;
+        }
+        flush_runs();
+        active = false;
+
+        CaptureChunk c = { .type = CAP_CHUNK_END };
+        put_u16(&c, (uint16_t)pixels);
+        put_u16(&c, (uint16_t)(pixels >> 16));
+        emit(&c);
+}
+
+/********** capture_active ********
+ *
+ * Check whether a capture is running
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: true between capture_begin and capture_end
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+bool capture_active(void)
+{
+        return active;
+}
+
+/********** capture_window ********
+ *
+ * Record a new address window
+ *
+ * Parameters:
+ *      uint16_t x0, y0, x1, y1: window corners (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from the display monitor on the render core
+ *
+ * Notes:
+ *      Runs never span windows, so pending runs are sent first
+ ************************/
+void capture_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+        if (active == false) {
+                return;
+        }
+        flush_runs();
+
+        CaptureChunk c = { .type = CAP_CHUNK_WINDOW };
+        put_u16(&c, x0);
+        put_u16(&c, y0);
+        put_u16(&c, x1);
+        put_u16(&c, y1);
+        emit(&c);
+}
+
+/********** capture_pixels ********
+ *
+ * Run-length encode pixels about to be sent to the panel
+ *
+ * Parameters:
+ *      const uint16_t *buf: pixels, in transfer order
+ *      size_t len:          number of pixels
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from the display monitor on the render core,
+ *      before the transfer starts
+ *
+ * Notes:
+ *      A run may continue from one transfer into the next
+ *      Transfer buffers hold byte-swapped RGB565; runs are
+ *      compared swapped and stored unswapped
+ ************************/
+void capture_pixels(const uint16_t *buf, size_t len)
+{
+        if (active == false) {
+                return;
+        }
+
+        pixels += (uint32_t)len;
+        for (size_t i = 0; i < len; i++) {
+                uint16_t p = buf[i];
+
+                if (run_len != 0 && p == run_pixel && run_len < CAP_RUN_MAX) {
+                        run_len++;
+                        continue;
+                }
+                flush_run();
+                run_pixel = p;
+                run_len = 1;
+        }
+}
+
+/********** capture_drain ********
+ *
+ * Write queued chunks to USB without blocking
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from the control core loop
+ *
+ * Notes:
+ *      With no host attached, queued chunks are discarded so
+ *      the render core never waits forever
+ ************************/
+void capture_drain(void)
+{
+        CaptureChunk c;
+
+        if (tud_cdc_connected() == false) {
+                while (spsc_pop(&cap_queue, &c)) {
+                }
+                return;
+        }
+
+        while (tud_cdc_write_available() >= sizeof(c) &&
+               spsc_pop(&cap_queue, &c)) {
+                stdio_usb.out_chars((const char *)&c, 4 + c.len + 1);
+        }
+}
@@ -0,0 +1,54 @@
+/**************************************************************
+ *
+ *                         capture.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for screen capture over USB. The render core
+ *     encodes the pixels it sends to the panel as run-length
+ *     chunks; the control core writes them out. See
+ *     tools/screenshot.py.
+ *
+ **************************************************************/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pico/types.h"
+
+#define CAP_SYNC0 0xa5
+#define CAP_SYNC1 0x5c
+
+#define CAP_PAYLOAD_MAX 59
+
+typedef enum {
+        CAP_CHUNK_BEGIN,
+        CAP_CHUNK_WINDOW,
+        CAP_CHUNK_RUNS,
+        CAP_CHUNK_END
+} CaptureChunkType;
+
+/* sync0, sync1, type, len, payload[len], check on the wire */
+typedef struct {
+        uint8_t sync0;
+        uint8_t sync1;
+        uint8_t type;
+        uint8_t len;
+        uint8_t payload[CAP_PAYLOAD_MAX + 1];
+} CaptureChunk;
+
+/* control core */
+void capture_init(void);
+void capture_drain(void);
+
+/* render core */
+void capture_begin(uint page, uint16_t width, uint16_t height);
+void capture_end(void);
+bool capture_active(void);
+void capture_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+void capture_pixels(const uint16_t *buf, size_t len);
+
+#endif
@@ -0,0 +1,361 @@
+/**************************************************************
+ *
+ *                          circle.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Circle geometry cache. A disc of radius r is drawn as
+ *     2r + 1 spans; halfw[dy] is the half-width of the span
+ *     dy rows from the center, the largest x with
+ *     x^2 + dy^2 <= r^2.
+ *
+ *     Tables are built with an integer midpoint walk: x only
+ *     ever decreases as dy grows, and a running error term
+ *     r^2 - x^2 - dy^2 is updated with additions, so a whole
+ *     table costs O(r) instead of the O(r^2) of searching x
+ *     from r on every row.
+ *
+ *     The same error term gives the edge coverage: the true
+ *     edge lies err / (2x + 1) of a pixel past x, close
+ *     enough to the square root for 16 levels. The pixel at
+ *     x is covered by that fraction plus a half, the pixel
+ *     past it by the fraction minus a half. Edge pixels are
+ *     drawn from a 16-entry blend table per color, made once
+ *     whenever the color changes.
+ *
+ *     CIRCLE_CACHE_SLOTS tables are kept, for radii up to
+ *     CIRCLE_MAX_R. A miss replaces the least recently used
+ *     slot, so a few radii in use at once (old and new size
+ *     of a growing ball, several ball sizes) never rebuild.
+ *
+ **************************************************************/
+
+#include "circle.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+#define CIRCLE_BENCH_ITER 100
+
+typedef struct {
+        bool full;
+        int16_t r;
+        uint32_t used;
+        CircleTable t;
+} CircleSlot;
+
+static CircleSlot slots[CIRCLE_CACHE_SLOTS];
+static uint32_t use_clock = 0;
+static uint32_t hits = 0;
+static uint32_t misses = 0;
+
+static void halfw_naive(int r, uint8_t *halfw);
+
+/********** circle_table_compute ********
+ *
+ * Build the half-width and coverage tables of a disc
+ *
+ * Parameters:
+ *      int r:          radius in pixels
+ *      CircleTable *t: first r + 1 entries of each table
+ *                      filled in
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= r <= CIRCLE_MAX_R
+ *
+ * Notes:
+ *      err is r^2 - x^2 - dy^2; stepping from row dy - 1 to
+ *      dy subtracts 2dy - 1, moving x in by one adds 2x - 1
+ *      After the walk 0 <= err < 2x + 1, so frac is 0..15
+ ************************/
+void circle_table_compute(int r, CircleTable *t)
+{
+        int x = r;
+        int err = 0;
+
+        for (int dy = 0; dy <= r; dy++) {
+                if (dy > 0) {
+                        err -= 2 * dy - 1;
+                }
+                while (err < 0) {
+                        err += 2 * x - 1;
+                        x--;
+                }
+
+                int frac = err * CIRCLE_LEVELS / (2 * x + 1);
+                int in = frac + CIRCLE_LEVELS / 2;
+                int out = frac - CIRCLE_LEVELS / 2;
+
+                if (in > CIRCLE_LEVELS - 1) {
+                        in = CIRCLE_LEVELS - 1;
+                }
+                if (out < 0) {
+                        out = 0;
+                }
+                t->halfw[dy] = (uint8_t)x;
+                t->cover[dy] = (uint8_t)((in << 4) | out);
+        }
+}
+
+/********** circle_table ********
+ *
+ * Get the tables for a radius, building them if needed
+ *
+ * Parameters:
+ *      int r: radius in pixels (clamped to 0..CIRCLE_MAX_R)
+ *
+ * Return: tables with r + 1 valid entries
+ *
+ * Expects:
+ *      Called on the render core only
+ *
+ * Notes:
+ *      The tables stay valid until CIRCLE_CACHE_SLOTS other
+ *      radii have been requested
+ ************************/
+const CircleTable *circle_table(int r)
+{
+        CircleSlot *victim = &slots[0];
+
+        if (r < 0) {
+                r = 0;
+        }
+        if (r > CIRCLE_MAX_R) {
+                r = CIRCLE_MAX_R;
+        }
+
+        use_clock++;
+        for (uint i = 0; i < CIRCLE_CACHE_SLOTS; i++) {
+                CircleSlot *s = &slots[i];
+
+                if (s->full && s->r == r) {
+                        s->used = use_clock;
+                        hits++;
+                        return &s->t;
+                }
+                if (s->used < victim->used) {
+                        victim = s;
+                }
+        }
+
+        misses++;
+        circle_table_compute(r, &victim->t);
+        victim->full = true;
+        victim->r = (int16_t)r;
+        victim->used = use_clock;
+        return &victim->t;
+}
+
+/********** circle_blend_lut ********
+ *
+ * Build the edge colors of a disc color over a background
+ *
+ * Parameters:
+ *      uint16_t *lut: CIRCLE_LEVELS entries, filled in
+ *      uint16_t fg:   disc color (RGB565)
+ *      uint16_t bg:   background color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      lut is not NULL
+ *
+ * Notes:
+ *      lut[k] is fg over bg at k/15 coverage, byte-swapped
+ *      for the panel like every other row buffer pixel
+ ************************/
+void circle_blend_lut(uint16_t *lut, uint16_t fg, uint16_t bg)
+{
+        const uint max = CIRCLE_LEVELS - 1;
+
+        for (uint k = 0; k < CIRCLE_LEVELS; k++) {
+                uint r = (((fg >> 11) & 0x1f) * k +
+                          ((bg >> 11) & 0x1f) * (max - k) + max / 2) / max;
+                uint g = (((fg >> 5) & 0x3f) * k +
+                          ((bg >> 5) & 0x3f) * (max - k) + max / 2) / max;
+                uint b = ((fg & 0x1f) * k + (bg & 0x1f) * (max - k) +
+                          max / 2) / max;
+                uint16_t c = (uint16_t)((r << 11) | (g << 5) | b);
+
+                lut[k] = (uint16_t)((c << 8) | (c >> 8));
+        }
+}
+
+/********** circle_row_fill ********
+ *
+ * Paint one row of an anti-aliased disc into a row buffer
+ *
+ * Parameters:
+ *      uint16_t *buf:  row buffer, indexed by screen x
+ *      int x0, x1:     visible part of the row (inclusive)
+ *      int cx:         disc center x
+ *      int hw:         halfw of this row
+ *      uint8_t cover:  cover of this row
+ *      uint16_t pix:   disc color, byte-swapped
+ *      const uint16_t *lut: blend table from circle_blend_lut
+ *
+ * Return: none
+ *
+ * Expects:
+ *      x0..x1 lies within cx - hw - 1..cx + hw + 1 and buf
+ *
+ * Notes:
+ *      Draws the solid middle, then the two pairs of edge
+ *      pixels; level 0 outside pixels are left alone
+ ************************/
+void circle_row_fill(uint16_t *buf, int x0, int x1, int cx, int hw,
+                     uint8_t cover, uint16_t pix, const uint16_t *lut)
+{
+        uint in = cover >> 4;
+        uint out = cover & 0x0f;
+        int a = cx - hw;
+        int b = cx + hw;
+        int s0 = a < x0 ? x0 : a;
+        int s1 = b > x1 ? x1 : b;
+
+        for (int x = s0; x <= s1; x++) {
+                buf[x] = pix;
+        }
+        if (in < CIRCLE_LEVELS - 1) {
+                if (a >= x0) {
+                        buf[a] = lut[in];
+                }
+                if (b <= x1) {
+                        buf[b] = lut[in];
+                }
+        }
+        if (out > 0) {
+                if (a - 1 >= x0) {
+                        buf[a - 1] = lut[out];
+                }
+                if (b + 1 <= x1) {
+                        buf[b + 1] = lut[out];
+                }
+        }
+}
+
+/********** halfw_naive ********
+ *
+ * Build a half-width table by searching every row from r
+ *
+ * Parameters:
+ *      int r:           radius in pixels
+ *      uint8_t *halfw:  r + 1 entries, filled in
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= r <= CIRCLE_MAX_R
+ *
+ * Notes:
+ *      The old O(r^2) method, kept as the benchmark baseline
+ ************************/
+static void halfw_naive(int r, uint8_t *halfw)
+{
+        int rr = r * r;
+
+        for (int dy = 0; dy <= r; dy++) {
+                int x = r;
+                while (x > 0 && (x * x + dy * dy) > rr) {
+                        x--;
+                }
+                halfw[dy] = (uint8_t)x;
+        }
+}
+
+/********** circle_bench ********
+ *
+ * Time table building and disc drawing for sample radii
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      Prints one "CIRCLE" line per radius: ns to build the
+ *      half-widths the old way and the tables with the
+ *      midpoint walk, ns to paint a whole disc into row
+ *      buffers flat and anti-aliased, and whether both
+ *      half-width tables agree; then the cache's hits and
+ *      misses
+ *      Uses its own tables, so it is safe to run on the
+ *      control core while the render core draws
+ ************************/
+void circle_bench(void)
+{
+        static const int radii[] = { 6, 12, 32, 64, CIRCLE_MAX_R };
+        static uint8_t naive_hw[CIRCLE_MAX_R + 1];
+        static CircleTable t;
+        static uint16_t lut[CIRCLE_LEVELS];
+        static uint16_t row[2 * CIRCLE_MAX_R + 3];
+        volatile uint32_t sink = 0;
+
+        circle_blend_lut(lut, 0xF800, 0x0000);
+
+        for (uint k = 0; k < sizeof(radii) / sizeof(radii[0]); k++) {
+                int r = radii[k];
+                const int cx = r + 1;
+
+                uint64_t start = time_us_64();
+                for (uint i = 0; i < CIRCLE_BENCH_ITER; i++) {
+                        halfw_naive(r, naive_hw);
+                        sink += naive_hw[r];
+                }
+                uint64_t naive = time_us_64() - start;
+
+                start = time_us_64();
+                for (uint i = 0; i < CIRCLE_BENCH_ITER; i++) {
+                        circle_table_compute(r, &t);
+                        sink += t.halfw[r];
+                }
+                uint64_t midpoint = time_us_64() - start;
+
+                start = time_us_64();
+                for (uint i = 0; i < CIRCLE_BENCH_ITER; i++) {
+                        for (int dy = -r; dy <= r; dy++) {
+                                int hw = t.halfw[dy < 0 ? -dy : dy];
+                                for (int x = cx - hw; x <= cx + hw; x++) {
+                                        row[x] = 0x00F8;
+                                }
+                        }
+                        sink += row[cx];
+                }
+                uint64_t flat = time_us_64() - start;
+
+                start = time_us_64();
+                for (uint i = 0; i < CIRCLE_BENCH_ITER; i++) {
+                        for (int dy = -r; dy <= r; dy++) {
+                                int ady = dy < 0 ? -dy : dy;
+                                int hw = t.halfw[ady];
+                                circle_row_fill(row, cx - hw - 1, cx + hw + 1,
+                                                cx, hw, t.cover[ady], 0x00F8,
+                                                lut);
+                        }
+                        sink += row[cx];
+                }
+                uint64_t aa = time_us_64() - start;
+
+                bool same = true;
+                for (int dy = 0; dy <= r; dy++) {
+                        same = same && naive_hw[dy] == t.halfw[dy];
+                }
+
+                printf("CIRCLE r=%d naive=%lluns midpoint=%lluns "
+                       "flat=%lluns aa=%lluns %s\n", r,
+                       (unsigned long long)(naive * 1000 / CIRCLE_BENCH_ITER),
+                       (unsigned long long)(midpoint * 1000 /
+                                            CIRCLE_BENCH_ITER),
+                       (unsigned long long)(flat * 1000 / CIRCLE_BENCH_ITER),
+                       (unsigned long long)(aa * 1000 / CIRCLE_BENCH_ITER),
+                       same ? "match" : "MISMATCH");
+        }
+
+        printf("CIRCLE cache hits=%lu misses=%lu\n", (unsigned long)hits,
+               (unsigned long)misses);
+}
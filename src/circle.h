@@ -0,0 +1,45 @@
+/**************************************************************
+ *
+ *                          circle.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the circle geometry cache: per-radius
+ *     half-width and edge coverage tables for drawing filled,
+ *     anti-aliased discs as spans.
+ *
+ **************************************************************/
+
+#ifndef CIRCLE_H
+#define CIRCLE_H
+
+#include <stdint.h>
+#include "pico/types.h"
+
+#define CIRCLE_MAX_R       120
+#define CIRCLE_CACHE_SLOTS 4
+#define CIRCLE_LEVELS      16
+
+/* cache slots plus their radii and use stamps */
+#define CIRCLE_SCRATCH_BYTES (CIRCLE_CACHE_SLOTS * \
+                              (2 * (CIRCLE_MAX_R + 1) + 8))
+
+/*
+ * Row dy of a disc (dy rows from its center) is solid out to
+ * halfw[dy]. cover[dy] holds the edge coverage in levels of
+ * 1/15: the high nibble for the pixels at +-halfw, the low
+ * nibble for the pixels just outside them.
+ */
+typedef struct {
+        uint8_t halfw[CIRCLE_MAX_R + 1];
+        uint8_t cover[CIRCLE_MAX_R + 1];
+} CircleTable;
+
+void circle_table_compute(int r, CircleTable *t);
+const CircleTable *circle_table(int r);
+void circle_blend_lut(uint16_t *lut, uint16_t fg, uint16_t bg);
+void circle_row_fill(uint16_t *buf, int x0, int x1, int cx, int hw,
+                     uint8_t cover, uint16_t pix, const uint16_t *lut);
+void circle_bench(void);
+
+#endif
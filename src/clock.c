@@ -4,43 +4,157 @@
  *
  *     Author:  AJ Romeo
  *
- *     Implementation of real-time clock with USB serial time
- *     synchronization. Manages hardware RTC and provides
- *     timezone-aware time access.
+ *     Implementation of the clock with USB serial time
+ *     synchronization, providing timezone-aware time access.
+ *     The T and Y commands that set it are parsed in cmd.c.
+ *
+ *     Time of day comes from the drift-corrected software
+ *     clock in timesync.c alone. The hardware RTC is not used:
+ *     its 1 Hz divider can only be trimmed in ~21 ppm steps,
+ *     too coarse to steer with, and it loses its time on the
+ *     same resets and dormant sleeps as the software clock,
+ *     so it could not restore it either.
+ *
+ *     Epoch conversion uses Howard Hinnant's days_from_civil
+ *     and civil_from_days algorithms: a fixed number of
+ *     integer operations, no tables, no static state, so it
+ *     is safe on either core without locking and does not
+ *     pull in newlib's gmtime.
  *
  **************************************************************/
 
 #include "clock.h"
+#include "tz.h"
+#include "timesync.h"
 #include "pico/stdlib.h"
-#include "hardware/rtc.h"
-#include <stdio.h>
 #include <stdbool.h>
 #include <time.h>
 
-#define TZ_OFFSET_HOURS (-5)
+#define SECS_PER_DAY 86400
 
-static volatile bool g_time_valid = false;
 
-static void apply_timezone_offset(datetime_t *t, int offset_hours);
+/********** clock_days_from_civil ********
+ *
+ * Convert a proleptic Gregorian date to days since 1970-01-01
+ *
+ * Parameters:
+ *      int y: year
+ *      int m: month, 1-12
+ *      int d: day of month, 1-31
+ *
+ * Return: days since the Unix epoch (negative before 1970)
+ *
+ * Expects:
+ *      m and d in range; y within +/- 5.8 million years
+ *
+ * Notes:
+ *      Counts from March so the leap day is the last day of
+ *      the shifted year; an era is 400 years = 146097 days
+ ************************/
+int32_t clock_days_from_civil(int y, int m, int d)
+{
+        y -= m <= 2;
+
+        int32_t era = (y >= 0 ? y : y - 399) / 400;
+        uint32_t yoe = (uint32_t)(y - era * 400);
+        uint32_t doy = (153 * (uint32_t)(m > 2 ? m - 3 : m + 9) + 2) / 5 +
+                       (uint32_t)d - 1;
+        uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
 
-/********** clock_init ********
+        return era * 146097 + (int32_t)doe - 719468;
+}
+
+/********** clock_civil_from_days ********
  *
- * Initialize the hardware RTC module
+ * Convert days since 1970-01-01 to a proleptic Gregorian date
  *
  * Parameters:
- *      none
+ *      int32_t days: days since the Unix epoch
+ *      int *y:       year
+ *      int *m:       month, 1-12
+ *      int *d:       day of month, 1-31
+ *
+ * Return: none
+ *
+ * Expects:
+ *      y, m and d are not NULL
+ *
+ * Notes:
+ *      Inverse of clock_days_from_civil
+ ************************/
+void clock_civil_from_days(int32_t days, int *y, int *m, int *d)
+{
+        days += 719468;
+
+        int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+        uint32_t doe = (uint32_t)(days - era * 146097);
+        uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        uint32_t mp = (5 * doy + 2) / 153;
+        uint32_t dd = doy - (153 * mp + 2) / 5 + 1;
+        uint32_t mm = mp < 10 ? mp + 3 : mp - 9;
+
+        *y = (int)yoe + (int)era * 400 + (mm <= 2);
+        *m = (int)mm;
+        *d = (int)dd;
+}
+
+/********** clock_epoch_to_datetime ********
+ *
+ * Split a Unix timestamp into date, time and weekday
+ *
+ * Parameters:
+ *      int64_t epoch:   seconds since 1970-01-01 00:00:00
+ *      datetime_t *out: datetime to fill
  *
  * Return: none
  *
  * Expects:
- *      Called once at system startup
+ *      out is not NULL
  *
  * Notes:
- *      Must be called before any other clock functions
+ *      dotw is 0 for Sunday, matching the RTC
+ ************************/
+void clock_epoch_to_datetime(int64_t epoch, datetime_t *out)
+{
+        int64_t days = epoch / SECS_PER_DAY;
+        int64_t secs = epoch % SECS_PER_DAY;
+
+        if (secs < 0) {
+                secs += SECS_PER_DAY;
+                days -= 1;
+        }
+
+        int y, m, d;
+        clock_civil_from_days((int32_t)days, &y, &m, &d);
+
+        out->year = (int16_t)y;
+        out->month = (int8_t)m;
+        out->day = (int8_t)d;
+        /* 1970-01-01 was a Thursday */
+        out->dotw = (int8_t)((days % 7 + 11) % 7);
+        out->hour = (int8_t)(secs / 3600);
+        out->min = (int8_t)(secs / 60 % 60);
+        out->sec = (int8_t)(secs % 60);
+}
+
+/********** clock_datetime_to_epoch ********
+ *
+ * Convert a datetime to a Unix timestamp
+ *
+ * Parameters:
+ *      const datetime_t *t: datetime to convert; dotw ignored
+ *
+ * Return: seconds since 1970-01-01 00:00:00
+ *
+ * Expects:
+ *      t is not NULL and holds a valid date and time
  ************************/
-void clock_init(void)
+int64_t clock_datetime_to_epoch(const datetime_t *t)
 {
-        rtc_init();
+        int64_t days = clock_days_from_civil(t->year, t->month, t->day);
+
+        return days * SECS_PER_DAY + t->hour * 3600 + t->min * 60 + t->sec;
 }
 
 /********** clock_time_valid ********
@@ -56,182 +170,114 @@ void clock_init(void)
  *      none
  *
  * Notes:
- *      Clock is valid after successful call to clock_set_epoch_utc
+ *      Clock is valid once the software clock has been set by
+ *      clock_set_epoch_utc or a sync sample
+ *      Safe on either core
  ************************/
 bool clock_time_valid(void)
 {
-        return g_time_valid;
+        int64_t utc_us;
+
+        return timesync_now(&utc_us);
 }
 
 /********** clock_set_epoch_utc ********
  *
- * Set the RTC using Unix epoch timestamp in UTC
+ * Set the clock from a Unix epoch timestamp in UTC
  *
  * Parameters:
  *      time_t epoch_utc: Unix timestamp (seconds since 1970-01-01)
  *
- * Return: true if successful, false on error
+ * Return: true if set, false if epoch_utc is out of range
  *
  * Expects:
- *      epoch_utc to be a valid Unix timestamp
+ *      Called on core0
  *
  * Notes:
- *      Converts epoch to datetime structure and programs RTC
- *      Marks clock as valid on success
+ *      Accepts CLOCK_EPOCH_MIN < epoch_utc < CLOCK_EPOCH_MAX
+ *      Steps the software clock to the given time
  ************************/
 bool clock_set_epoch_utc(time_t epoch_utc)
 {
-        struct tm *ti = gmtime(&epoch_utc);
-        if (ti == NULL) {
+        if (epoch_utc <= CLOCK_EPOCH_MIN || epoch_utc >= CLOCK_EPOCH_MAX) {
                 return false;
         }
 
-        datetime_t t = {
-                .year  = ti->tm_year + 1900,
-                .month = ti->tm_mon + 1,
-                .day   = ti->tm_mday,
-                .dotw  = ti->tm_wday,
-                .hour  = ti->tm_hour,
-                .min   = ti->tm_min,
-                .sec   = ti->tm_sec
-        };
-
-        rtc_init();
-        if (rtc_set_datetime(&t) == false) {
-                return false;
-        }
-
-        g_time_valid = true;
+        timesync_step((int64_t)epoch_utc * 1000000);
         return true;
 }
 
-/********** apply_timezone_offset ********
+/********** clock_invalidate ********
  *
- * Apply hour-based timezone offset to datetime
+ * Mark the clock as unset
  *
  * Parameters:
- *      datetime_t *t:      datetime to modify in-place
- *      int offset_hours:   timezone offset in hours (e.g., -5 for EST)
+ *      none
  *
  * Return: none
  *
  * Expects:
- *      t is not NULL
+ *      Called on core0
  *
  * Notes:
- *      Handles day wraparound
- *      Does not account for month/year boundaries or DST
- *      Sufficient for display purposes
+ *      For when the local timer has stopped, as in dormant
+ *      mode; local time reads as unavailable until the next
+ *      T command or sync sample
  ************************/
-static void apply_timezone_offset(datetime_t *t, int offset_hours)
+void clock_invalidate(void)
 {
-        int h = (int)t->hour + offset_hours;
-
-        if (h < 0) {
-                h += 24;
-                t->dotw = (t->dotw + 6) % 7;
-                if (t->day > 1) {
-                        t->day -= 1;
-                }
-        } else if (h >= 24) {
-                h -= 24;
-                t->dotw = (t->dotw + 1) % 7;
-                t->day += 1;
-        }
-
-        t->hour = (int8_t)h;
+        timesync_invalidate();
 }
 
-/********** clock_get_local_datetime ********
+/********** clock_sync_sample ********
  *
- * Get current time from RTC with timezone offset applied
+ * Feed one host time sample to the software clock
  *
  * Parameters:
- *      datetime_t *out: pointer to datetime structure to fill
+ *      uint64_t local_us: time_us_64 value reported by a probe
+ *      int64_t host_us:   host UTC microseconds at the middle
+ *                         of that probe's round trip
+ *      uint32_t rtt_us:   probe round-trip time
  *
- * Return: true if successful, false if clock not valid or RTC error
+ * Return: true if the sample was accepted
  *
  * Expects:
- *      out is not NULL
+ *      Called on core0
  *
  * Notes:
- *      Applies TZ_OFFSET_HOURS to UTC time from RTC
+ *      The first accepted sample sets the clock
  ************************/
-bool clock_get_local_datetime(datetime_t *out)
+bool clock_sync_sample(uint64_t local_us, int64_t host_us, uint32_t rtt_us)
 {
-        if (g_time_valid == false) {
-                return false;
-        }
-
-        datetime_t t;
-        if (rtc_get_datetime(&t) == false) {
-                return false;
-        }
-
-        apply_timezone_offset(&t, TZ_OFFSET_HOURS);
-        *out = t;
-        return true;
+        return timesync_sample(local_us, host_us, rtt_us);
 }
 
-/********** usb_time_sync_poll ********
+/********** clock_get_local_datetime ********
  *
- * Poll USB serial for time synchronization commands
+ * Get current local time with timezone offset applied
  *
  * Parameters:
- *      none
+ *      datetime_t *out: pointer to datetime structure to fill
  *
- * Return: none
+ * Return: true if successful, false if the clock is not set
  *
  * Expects:
- *      USB serial initialized with stdio_init_all()
+ *      out is not NULL
  *
  * Notes:
- *      Expected format: "T <epoch>\n" where epoch is Unix timestamp
- *      Responses: "OK", "ERR fmt", "ERR range", "ERR rtc", 
- *                 "ERR overflow"
- *      Should be called regularly from main loop
- *      Validates timestamp range (2023-2100)
+ *      Reads UTC from the software clock; the offset comes
+ *      from the compiled timezone table, so DST changes and
+ *      date rollover are handled
+ *      Safe on either core
  ************************/
-void usb_time_sync_poll(void)
+bool clock_get_local_datetime(datetime_t *out)
 {
-        static char buf[64];
-        static size_t n = 0;
-        int c;
-
-        while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
-                if (c == '\r') {
-                        continue;
-                }
-
-                if (c == '\n') {
-                        buf[n] = '\0';
-                        n = 0;
-
-                        long long epoch = 0;
-                        if (sscanf(buf, "T %lld", &epoch) != 1) {
-                                printf("ERR fmt\n");
-                                continue;
-                        }
-
-                        if (epoch <= 1700000000LL ||
-                            epoch >= 4102444800LL) {
-                                printf("ERR range\n");
-                                continue;
-                        }
-
-                        if (clock_set_epoch_utc((time_t)epoch)) {
-                                printf("OK\n");
-                        } else {
-                                printf("ERR rtc\n");
-                        }
-                        continue;
-                }
-
-                if (n + 1 < sizeof(buf)) {
-                        buf[n++] = (char)c;
-                } else {
-                        n = 0;
-                        printf("ERR overflow\n");
-                }
+        int64_t utc_us;
+        if (timesync_now(&utc_us) == false) {
+                return false;
         }
+
+        int64_t utc = utc_us / 1000000;
+        clock_epoch_to_datetime(utc + tz_offset_at(utc), out);
+        return true;
 }
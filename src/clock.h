@@ -4,9 +4,9 @@
  *
  *     Author:  AJ Romeo
  *
- *     Interface for real-time clock management with USB serial
- *     time synchronization. Provides RTC initialization, time
- *     validation, and timezone-aware datetime retrieval.
+ *     Interface for clock management with USB serial time
+ *     synchronization. Provides time setting and validation,
+ *     and timezone-aware datetime retrieval.
  *
  **************************************************************/
 
@@ -14,13 +14,23 @@
 #define CLOCK_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
-#include "hardware/rtc.h"
+#include "pico/types.h"
+
+/* accepted range for clock_set_epoch_utc (exclusive) */
+#define CLOCK_EPOCH_MIN 1700000000LL
+#define CLOCK_EPOCH_MAX 4102444800LL
 
-void clock_init(void);
-void usb_time_sync_poll(void);
 bool clock_time_valid(void);
 bool clock_set_epoch_utc(time_t epoch_utc);
+void clock_invalidate(void);
+bool clock_sync_sample(uint64_t local_us, int64_t host_us, uint32_t rtt_us);
 bool clock_get_local_datetime(datetime_t *out);
 
+int32_t clock_days_from_civil(int y, int m, int d);
+void clock_civil_from_days(int32_t days, int *y, int *m, int *d);
+void clock_epoch_to_datetime(int64_t epoch, datetime_t *out);
+int64_t clock_datetime_to_epoch(const datetime_t *t);
+
 #endif
@@ -0,0 +1,1307 @@
+/**************************************************************
+ *
+ *                           cmd.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     USB serial command layer. cmd_poll reads whatever the
+ *     CDC driver has buffered in one call per chunk instead of
+ *     a getchar per byte. Each complete line is split into
+ *     tokens that point into the receive buffer (nothing is
+ *     copied), looked up in cmd_table and dispatched.
+ *
+ *     Numbers are parsed by hand and OK/ERR replies are
+ *     written straight to the USB driver, so no printf or
+ *     sscanf runs for the common commands. Reports still use
+ *     printf; they are not time-critical.
+ *
+ *     Adding a command is one cmd_table entry: name, argument
+ *     count range, handler and a line of help.
+ *
+ *     RECT is followed by raw pixel bytes rather than another
+ *     line; while its rectangle is open, input bypasses the
+ *     line buffer and goes to the remote display (remote.c).
+ *
+ **************************************************************/
+
+#include "cmd.h"
+#include "clock.h"
+#include "timesync.h"
+#include "sched.h"
+#include "render.h"
+#include "latency.h"
+#include "monitor.h"
+#include "power.h"
+#include "page.h"
+#include "telemetry.h"
+#include "remote.h"
+#include "split.h"
+#include "life.h"
+#include "plasma.h"
+#include "ball.h"
+#include "circle.h"
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CMD_RX_BUF      256
+#define CMD_REPLY_MAX   48
+#define CMD_BENCH_ITER  1000
+#define CMD_SHOT_MAX_MS 10000
+
+typedef void (*CmdFn)(const CmdLine *cl);
+typedef void (*ReportFn)(void);
+
+typedef struct {
+        const char *name;
+        uint8_t name_len;
+        uint8_t min_args;
+        uint8_t max_args;
+        CmdFn run;
+        ReportFn report;
+        const char *help;
+} CmdDesc;
+
+/* a command with arguments, or a report taking none */
+#define CMD(n, lo, hi, fn, h) { n, sizeof(n) - 1, lo, hi, fn, NULL, h }
+#define REPORT(n, fn, h)      { n, sizeof(n) - 1, 0, 0, NULL, fn, h }
+
+static void cmd_time(const CmdLine *cl);
+static void cmd_sync(const CmdLine *cl);
+static void cmd_page(const CmdLine *cl);
+static void cmd_color(const CmdLine *cl);
+static void cmd_telemetry(const CmdLine *cl);
+static void cmd_shot(const CmdLine *cl);
+static void cmd_rect(const CmdLine *cl);
+static void cmd_balls(const CmdLine *cl);
+static void cmd_phys(const CmdLine *cl);
+static void cmd_trail(const CmdLine *cl);
+static bool ball_configure(uint key, uint32_t value);
+static uint page_lookup(const CmdTok *arg);
+static void cmd_stats(void);
+static bool bench_parse_none(const CmdLine *cl, uint64_t *out);
+static bool bench_parse_time(const CmdLine *cl, uint64_t *out);
+static bool bench_parse_page(const CmdLine *cl, uint64_t *out);
+static bool bench_parse_color(const CmdLine *cl, uint64_t *out);
+static bool bench_parse_sync(const CmdLine *cl, uint64_t *out);
+static void cmd_bench(void);
+static void cmd_help(void);
+
+static const CmdDesc cmd_table[] = {
+        CMD("T",     1, 1, cmd_time,     "T <epoch>: set UTC time"),
+        CMD("Y",     0, 3, cmd_sync,     "Y [<local> <host> <rtt>]: sync"),
+        CMD("PAGE",  1, 1, cmd_page,     "PAGE <n|name>: select page"),
+        CMD("COLOR", 2, 2, cmd_color,    "COLOR <bg> <fg>: RGB565 hex"),
+        CMD("TLM",   1, 1, cmd_telemetry, "TLM <0|1>: binary telemetry"),
+        CMD("SHOT",  0, 1, cmd_shot,     "SHOT [<ms>]: screen capture"),
+        CMD("RECT",  4, 4, cmd_rect,     "RECT <x0> <y0> <x1> <y1>: pixels"),
+        CMD("BALLS", 1, 1, cmd_balls,    "BALLS <n>: balls on the ball page"),
+        CMD("PHYS",  3, 3, cmd_phys,     "PHYS <g> <e> <f>: ball physics"),
+        CMD("TRAIL", 1, 1, cmd_trail,    "TRAIL <0|1>: ball trails"),
+        REPORT("I",     sched_report_idle,   "I: idle time per page"),
+        REPORT("J",     sched_report_timing, "J: tick lateness and jitter"),
+        REPORT("P",     render_report_pages, "P: page budgets and overruns"),
+        REPORT("L",     latency_report,      "L: page switch latency"),
+        REPORT("W",     monitor_report,      "W: watchdog and deadlines"),
+        REPORT("S",     power_report,        "S: power state"),
+        REPORT("C",     timesync_report,     "C: clock drift and slew"),
+        REPORT("R",     remote_report,       "R: remote display"),
+        REPORT("X",     split_report,        "X: work shared across cores"),
+        REPORT("G",     life_report,         "G: life generations per second"),
+        REPORT("F",     plasma_report,       "F: plasma frame and fill rate"),
+        REPORT("STATS", cmd_stats,           "STATS: all reports"),
+        REPORT("BENCH", cmd_bench,           "BENCH: command parse time"),
+        REPORT("CIRCLE", circle_bench,       "CIRCLE: circle span build time"),
+        REPORT("HELP",  cmd_help,            "HELP: this list"),
+};
+
+#define CMD_COUNT (sizeof(cmd_table) / sizeof(cmd_table[0]))
+
+static char rx_buf[CMD_RX_BUF];
+static uint rx_len = 0;
+static bool rx_discard = false;
+
+static bool tokenize(const char *line, uint len, CmdLine *cl);
+static const CmdDesc *find_command(const CmdTok *name);
+static void run_line(const char *line, uint len, uint64_t rx_us);
+static bool tok_equals_ci(const CmdTok *t, const char *s);
+static uint rx_payload(const char *p, uint n);
+static bool rx_direct(void);
+static void payload_commit(uint32_t n);
+static void rx_process(uint from, uint64_t rx_us);
+
+/********** cmd_reply ********
+ *
+ * Send one reply line
+ *
+ * Parameters:
+ *      const char *s: line without newline
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB stdio initialized
+ *
+ * Notes:
+ *      Goes straight to the USB driver, bypassing printf
+ ************************/
+void cmd_reply(const char *s)
+{
+        stdio_usb.out_chars(s, (int)strlen(s));
+        stdio_usb.out_chars("\r\n", 2);
+}
+
+/********** cmd_reply_err ********
+ *
+ * Send an "ERR <what>" reply
+ *
+ * Parameters:
+ *      const char *what: error name
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB stdio initialized
+ ************************/
+void cmd_reply_err(const char *what)
+{
+        stdio_usb.out_chars("ERR ", 4);
+        cmd_reply(what);
+}
+
+/********** cmd_reply_u64 ********
+ *
+ * Send a reply made of a prefix and a decimal number
+ *
+ * Parameters:
+ *      const char *prefix: text before the number
+ *      uint64_t v:         number to print
+ *
+ * Return: none
+ *
+ * Expects:
+ *      strlen(prefix) + 20 < CMD_REPLY_MAX
+ ************************/
+void cmd_reply_u64(const char *prefix, uint64_t v)
+{
+        char buf[CMD_REPLY_MAX];
+        char digits[20];
+        uint n = 0;
+        uint len = (uint)strlen(prefix);
+
+        do {
+                digits[n++] = (char)('0' + v % 10);
+                v /= 10;
+        } while (v != 0);
+
+        memcpy(buf, prefix, len);
+        while (n > 0) {
+                buf[len++] = digits[--n];
+        }
+        buf[len] = '\0';
+        cmd_reply(buf);
+}
+
+/********** cmd_arg_u64 ********
+ *
+ * Parse an unsigned decimal token
+ *
+ * Parameters:
+ *      const CmdTok *t: token
+ *      uint64_t *out:   parsed value
+ *
+ * Return: false on an empty token, a non-digit or overflow
+ *
+ * Expects:
+ *      t and out are not NULL
+ ************************/
+bool cmd_arg_u64(const CmdTok *t, uint64_t *out)
+{
+        uint64_t v = 0;
+
+        if (t->len == 0) {
+                return false;
+        }
+        for (uint i = 0; i < t->len; i++) {
+                uint d = (uint)(t->s[i] - '0');
+                if (d > 9 || v > (UINT64_MAX - d) / 10) {
+                        return false;
+                }
+                v = v * 10 + d;
+        }
+
+        *out = v;
+        return true;
+}
+
+/********** cmd_arg_i64 ********
+ *
+ * Parse a signed decimal token
+ *
+ * Parameters:
+ *      const CmdTok *t: token, optionally starting with '-'
+ *      int64_t *out:    parsed value
+ *
+ * Return: false on a malformed or out-of-range token
+ *
+ * Expects:
+ *      t and out are not NULL
+ ************************/
+bool cmd_arg_i64(const CmdTok *t, int64_t *out)
+{
+        bool neg = t->len > 0 && t->s[0] == '-';
+        CmdTok digits = { t->s + neg, (uint8_t)(t->len - neg) };
+        uint64_t v;
+
+        if (cmd_arg_u64(&digits, &v) == false || v > (uint64_t)INT64_MAX) {
+                return false;
+        }
+
+        *out = neg ? -(int64_t)v : (int64_t)v;
+        return true;
+}
+
+/********** cmd_arg_hex16 ********
+ *
+ * Parse a hexadecimal token of up to four digits
+ *
+ * Parameters:
+ *      const CmdTok *t: token, upper or lower case
+ *      uint16_t *out:   parsed value
+ *
+ * Return: false on a malformed token
+ *
+ * Expects:
+ *      t and out are not NULL
+ ************************/
+bool cmd_arg_hex16(const CmdTok *t, uint16_t *out)
+{
+        uint16_t v = 0;
+
+        if (t->len == 0 || t->len > 4) {
+                return false;
+        }
+        for (uint i = 0; i < t->len; i++) {
+                char c = t->s[i];
+                uint d;
+
+                if (c >= '0' && c <= '9') {
+                        d = (uint)(c - '0');
+                } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                        d = (uint)((c | 0x20) - 'a' + 10);
+                } else {
+                        return false;
+                }
+                v = (uint16_t)((v << 4) | d);
+        }
+
+        *out = v;
+        return true;
+}
+
+/********** tok_equals_ci ********
+ *
+ * Compare a token with a string, ignoring ASCII case
+ *
+ * Parameters:
+ *      const CmdTok *t: token
+ *      const char *s:   NUL-terminated string
+ *
+ * Return: true if equal
+ *
+ * Expects:
+ *      t and s are not NULL
+ ************************/
+static bool tok_equals_ci(const CmdTok *t, const char *s)
+{
+        for (uint i = 0; i < t->len; i++) {
+                if (s[i] == '\0' || (t->s[i] | 0x20) != (s[i] | 0x20)) {
+                        return false;
+                }
+        }
+        return s[t->len] == '\0';
+}
+
+/********** tokenize ********
+ *
+ * Split a line into space-separated tokens
+ *
+ * Parameters:
+ *      const char *line: line without newline, not terminated
+ *      uint len:         line length
+ *      CmdLine *cl:      tokens, pointing into line
+ *
+ * Return: false if there are too many or too long tokens
+ *
+ * Expects:
+ *      line stays valid while cl is used
+ ************************/
+static bool tokenize(const char *line, uint len, CmdLine *cl)
+{
+        uint i = 0;
+
+        cl->argc = 0;
+        while (i < len) {
+                while (i < len && line[i] == ' ') {
+                        i++;
+                }
+                if (i == len) {
+                        break;
+                }
+
+                uint start = i;
+                while (i < len && line[i] != ' ') {
+                        i++;
+                }
+                if (cl->argc == CMD_MAX_ARGS || i - start > UINT8_MAX) {
+                        return false;
+                }
+                cl->argv[cl->argc].s = line + start;
+                cl->argv[cl->argc].len = (uint8_t)(i - start);
+                cl->argc++;
+        }
+        return true;
+}
+
+/********** find_command ********
+ *
+ * Look up a command by name
+ *
+ * Parameters:
+ *      const CmdTok *name: first token of the line
+ *
+ * Return: table entry, or NULL if unknown
+ *
+ * Expects:
+ *      name is not NULL
+ *
+ * Notes:
+ *      Names are case-sensitive; the length is compared first
+ *      so most entries are rejected without touching the text
+ ************************/
+static const CmdDesc *find_command(const CmdTok *name)
+{
+        for (uint i = 0; i < CMD_COUNT; i++) {
+                const CmdDesc *d = &cmd_table[i];
+                if (d->name_len == name->len &&
+                    memcmp(d->name, name->s, name->len) == 0) {
+                        return d;
+                }
+        }
+        return NULL;
+}
+
+/********** run_line ********
+ *
+ * Parse and dispatch one received line
+ *
+ * Parameters:
+ *      const char *line: line in the receive buffer
+ *      uint len:         length without the newline
+ *      uint64_t rx_us:   time_us_64 when the chunk arrived
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      A trailing carriage return is ignored and blank lines
+ *      are skipped silently
+ ************************/
+static void run_line(const char *line, uint len, uint64_t rx_us)
+{
+        CmdLine cl;
+
+        if (len > 0 && line[len - 1] == '\r') {
+                len--;
+        }
+        if (tokenize(line, len, &cl) == false) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        if (cl.argc == 0) {
+                return;
+        }
+        cl.rx_us = rx_us;
+
+        const CmdDesc *d = find_command(&cl.argv[0]);
+        if (d == NULL) {
+                cmd_reply_err("cmd");
+                return;
+        }
+
+        uint nargs = cl.argc - 1u;
+        if (nargs < d->min_args || nargs > d->max_args) {
+                cmd_reply_err("args");
+                return;
+        }
+        if (d->report != NULL) {
+                d->report();
+        } else {
+                d->run(&cl);
+        }
+}
+
+/********** rx_payload ********
+ *
+ * Pass rectangle bytes already in the line buffer on to the
+ * remote display
+ *
+ * Parameters:
+ *      const char *p: bytes following a RECT line
+ *      uint n:        number of bytes
+ *
+ * Return: bytes taken, less than n if the rectangle ends or
+ *         no pixel buffer is free
+ *
+ * Expects:
+ *      remote_pending() != 0
+ *
+ * Notes:
+ *      Only bytes that arrived in the same read as the RECT
+ *      line are copied; the rest go straight to the pixel
+ *      buffers through rx_direct
+ ************************/
+static uint rx_payload(const char *p, uint n)
+{
+        uint taken = 0;
+
+        while (taken < n && remote_pending() != 0) {
+                uint32_t room;
+                uint8_t *dst = remote_rx_space(&room);
+                if (dst == NULL) {
+                        break;
+                }
+                if (room > n - taken) {
+                        room = n - taken;
+                }
+                memcpy(dst, p + taken, room);
+                taken += room;
+                payload_commit(room);
+        }
+        return taken;
+}
+
+/********** rx_direct ********
+ *
+ * Read rectangle bytes from USB straight into a pixel buffer
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: false if nothing was read or no buffer is free
+ *
+ * Expects:
+ *      remote_pending() != 0 and the line buffer is empty
+ ************************/
+static bool rx_direct(void)
+{
+        uint32_t room;
+        uint8_t *dst = remote_rx_space(&room);
+
+        if (dst == NULL) {
+                return false;
+        }
+
+        int n = stdio_usb.in_chars((char *)dst, (int)room);
+        if (n <= 0) {
+                return false;
+        }
+        payload_commit((uint32_t)n);
+        return true;
+}
+
+/********** payload_commit ********
+ *
+ * Account for received rectangle bytes
+ *
+ * Parameters:
+ *      uint32_t n: bytes written at remote_rx_space
+ *
+ * Return: none
+ *
+ * Expects:
+ *      n is within the room remote_rx_space gave
+ *
+ * Notes:
+ *      Replies "OK" once the whole rectangle has arrived
+ ************************/
+static void payload_commit(uint32_t n)
+{
+        remote_rx_commit(n);
+        if (remote_pending() == 0) {
+                cmd_reply("OK");
+        }
+}
+
+/********** rx_process ********
+ *
+ * Dispatch complete lines and rectangle bytes in rx_buf
+ *
+ * Parameters:
+ *      uint from:      first byte not yet checked for a newline
+ *      uint64_t rx_us: time_us_64 when the bytes arrived
+ *
+ * Return: none
+ *
+ * Expects:
+ *      rx_len bytes are valid in rx_buf
+ *
+ * Notes:
+ *      Lines are dispatched in place; bytes after a RECT line
+ *      belong to its rectangle and are not parsed
+ *      What is left (an unfinished line, or rectangle bytes
+ *      with no free buffer) is moved to the front
+ *      A line longer than the buffer is answered with
+ *      "ERR overflow" and dropped up to its newline
+ ************************/
+static void rx_process(uint from, uint64_t rx_us)
+{
+        uint start = 0;
+        uint i = from;
+
+        while (i < rx_len) {
+                if (remote_pending() != 0) {
+                        start += rx_payload(rx_buf + start, rx_len - start);
+                        i = start;
+                        if (remote_pending() != 0) {
+                                break;
+                        }
+                        continue;
+                }
+                if (rx_buf[i] == '\n') {
+                        if (rx_discard) {
+                                rx_discard = false;
+                        } else {
+                                run_line(rx_buf + start, i - start, rx_us);
+                        }
+                        start = i + 1;
+                }
+                i++;
+        }
+
+        rx_len -= start;
+        if (start > 0 && rx_len > 0) {
+                memmove(rx_buf, rx_buf + start, rx_len);
+        }
+
+        if (rx_len == CMD_RX_BUF && remote_pending() == 0) {
+                rx_len = 0;
+                if (rx_discard == false) {
+                        rx_discard = true;
+                        cmd_reply_err("overflow");
+                }
+        }
+}
+
+/********** cmd_poll ********
+ *
+ * Read and dispatch all pending USB serial input
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB serial initialized with stdio_init_all()
+ *
+ * Notes:
+ *      While a RECT is open its pixels are read directly into
+ *      remote display buffers; with none free, reading stops
+ *      and resumes when the render core returns one (it posts
+ *      SCHED_EV_USB), leaving USB flow control to hold off
+ *      the host
+ ************************/
+void cmd_poll(void)
+{
+        while (1) {
+                if (remote_pending() != 0) {
+                        if (rx_len > 0) {
+                                rx_process(0, time_us_64());
+                        } else if (rx_direct() == false) {
+                                break;
+                        }
+                        if (remote_pending() != 0 && rx_len > 0) {
+                                break;
+                        }
+                        continue;
+                }
+
+                uint from = rx_len;
+                int n = stdio_usb.in_chars(rx_buf + rx_len,
+                                           (int)(CMD_RX_BUF - rx_len));
+                if (n <= 0) {
+                        break;
+                }
+                rx_len += (uint)n;
+                rx_process(from, time_us_64());
+                if (remote_pending() != 0 && rx_len > 0) {
+                        break;
+                }
+        }
+}
+
+/********** cmd_time ********
+ *
+ * T <epoch>: step the clock to a Unix time
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, one argument
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      Replies "OK", "ERR fmt" or "ERR range"
+ ************************/
+static void cmd_time(const CmdLine *cl)
+{
+        int64_t epoch;
+
+        if (cmd_arg_i64(&cl->argv[1], &epoch) == false) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        if (clock_set_epoch_utc((time_t)epoch) == false) {
+                cmd_reply_err("range");
+                return;
+        }
+        cmd_reply("OK");
+}
+
+/********** cmd_sync ********
+ *
+ * Y: probe, Y <local_us> <host_us> <rtt_us>: sync sample
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, no or three arguments
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      A probe is answered with "Y <rx_us>", taken when the
+ *      chunk holding it was read
+ *      A sample is answered with a SYNC status line and "OK",
+ *      or with "ERR fmt" / "ERR rtt"
+ *      See tools/timesync.py
+ ************************/
+static void cmd_sync(const CmdLine *cl)
+{
+        uint64_t local_us, rtt_us;
+        int64_t host_us;
+
+        if (cl->argc == 1) {
+                cmd_reply_u64("Y ", cl->rx_us);
+                return;
+        }
+
+        if (cl->argc != 4 ||
+            cmd_arg_u64(&cl->argv[1], &local_us) == false ||
+            cmd_arg_i64(&cl->argv[2], &host_us) == false ||
+            cmd_arg_u64(&cl->argv[3], &rtt_us) == false ||
+            rtt_us > UINT32_MAX) {
+                cmd_reply_err("fmt");
+                return;
+        }
+
+        if (clock_sync_sample(local_us, host_us, (uint32_t)rtt_us) == false) {
+                cmd_reply_err("rtt");
+                return;
+        }
+
+        timesync_report();
+        cmd_reply("OK");
+}
+
+/********** page_lookup ********
+ *
+ * Find a page by index or name
+ *
+ * Parameters:
+ *      const CmdTok *arg: decimal index or page name
+ *
+ * Return: page index, or page_count if there is no such page
+ *
+ * Expects:
+ *      arg is not NULL
+ *
+ * Notes:
+ *      Names match page_table entries, ignoring case
+ ************************/
+static uint page_lookup(const CmdTok *arg)
+{
+        uint64_t n;
+
+        if (cmd_arg_u64(arg, &n)) {
+                return n < page_count ? (uint)n : page_count;
+        }
+        for (uint i = 0; i < page_count; i++) {
+                if (tok_equals_ci(arg, page_table[i]->name)) {
+                        return i;
+                }
+        }
+        return page_count;
+}
+
+/********** cmd_page ********
+ *
+ * PAGE <n|name>: select a page by index or name
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, one argument
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      Names match page_table entries, ignoring case
+ *      Replies "OK", "ERR page" or "ERR busy"
+ ************************/
+static void cmd_page(const CmdLine *cl)
+{
+        uint page = page_lookup(&cl->argv[1]);
+
+        if (page >= page_count) {
+                cmd_reply_err("page");
+                return;
+        }
+        if (render_select_page(page, time_us_32()) == false) {
+                cmd_reply_err("busy");
+                return;
+        }
+        cmd_reply("OK");
+}
+
+/********** cmd_color ********
+ *
+ * COLOR <bg> <fg>: set page colours as RGB565 hex
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, two arguments
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      Replies "OK", "ERR fmt" or "ERR busy"
+ ************************/
+static void cmd_color(const CmdLine *cl)
+{
+        uint16_t bg, fg;
+
+        if (cmd_arg_hex16(&cl->argv[1], &bg) == false ||
+            cmd_arg_hex16(&cl->argv[2], &fg) == false) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        if (render_set_colors(bg, fg) == false) {
+                cmd_reply_err("busy");
+                return;
+        }
+        cmd_reply("OK");
+}
+
+/********** cmd_telemetry ********
+ *
+ * TLM <0|1>: stop or start the binary telemetry stream
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, one argument
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      Replies "OK" or "ERR fmt" before any record is sent;
+ *      records then share the port with text replies
+ *      See tools/telemetry.py
+ ************************/
+static void cmd_telemetry(const CmdLine *cl)
+{
+        uint64_t on;
+
+        if (cmd_arg_u64(&cl->argv[1], &on) == false || on > 1) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        cmd_reply("OK");
+        telemetry_enable(on == 1);
+}
+
+/********** cmd_shot ********
+ *
+ * SHOT [<ms>]: capture the screen
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, optional duration
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      The current page is redrawn into a capture, which then
+ *      follows the page's updates for <ms> more (default 0,
+ *      at most CMD_SHOT_MAX_MS)
+ *      Replies "OK", "ERR fmt", "ERR range" or "ERR busy";
+ *      binary capture chunks follow an "OK", since the
+ *      control core only drains them after this returns
+ *      See tools/screenshot.py
+ ************************/
+static void cmd_shot(const CmdLine *cl)
+{
+        uint64_t ms = 0;
+
+        if (cl->argc == 2 && cmd_arg_u64(&cl->argv[1], &ms) == false) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        if (ms > CMD_SHOT_MAX_MS) {
+                cmd_reply_err("range");
+                return;
+        }
+
+        if (render_capture((uint16_t)ms) == false) {
+                cmd_reply_err("busy");
+                return;
+        }
+        cmd_reply("OK");
+}
+
+/********** cmd_rect ********
+ *
+ * RECT <x0> <y0> <x1> <y1>: receive a rectangle of pixels
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, four arguments
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      Corners are inclusive; (x1-x0+1)*(y1-y0+1) RGB565
+ *      pixels follow as raw big-endian bytes
+ *      Only accepted on the remote page
+ *      Replies "OK" once every pixel has arrived, or at once
+ *      with "ERR fmt", "ERR page" or "ERR range"; after an
+ *      error the host must not send the pixels
+ *      See tools/remote_display.py
+ ************************/
+static void cmd_rect(const CmdLine *cl)
+{
+        uint64_t v[4];
+
+        for (uint i = 0; i < 4; i++) {
+                if (cmd_arg_u64(&cl->argv[i + 1], &v[i]) == false ||
+                    v[i] > UINT16_MAX) {
+                        cmd_reply_err("fmt");
+                        return;
+                }
+        }
+        if (strcmp(page_table[render_selected_page()]->name,
+                   REMOTE_PAGE_NAME) != 0) {
+                cmd_reply_err("page");
+                return;
+        }
+        if (remote_begin((uint16_t)v[0], (uint16_t)v[1], (uint16_t)v[2],
+                         (uint16_t)v[3]) == false) {
+                cmd_reply_err("range");
+        }
+}
+
+/********** cmd_balls ********
+ *
+ * BALLS <n>: set the number of balls on the ball page
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, one argument
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      n is 1 to BOUNCER_MAX; the page restarts with the new
+ *      count if it is showing, otherwise on its next entry
+ *      Replies "OK", "ERR fmt", "ERR range", "ERR page" or
+ *      "ERR busy"
+ ************************/
+static void cmd_balls(const CmdLine *cl)
+{
+        uint64_t n;
+
+        if (cmd_arg_u64(&cl->argv[1], &n) == false) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        if (n < 1 || n > BOUNCER_MAX) {
+                cmd_reply_err("range");
+                return;
+        }
+
+        if (ball_configure(BALL_CFG_COUNT, (uint32_t)n)) {
+                cmd_reply("OK");
+        }
+}
+
+/********** cmd_phys ********
+ *
+ * PHYS <g> <e> <f>: set the ball page's physics
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, three arguments
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      All in thousandths, 0 to BALL_PHYS_MILLI_MAX: gravity
+ *      in pixels per step per step, restitution (bounce speed
+ *      kept) and wall friction (sliding speed kept per step of
+ *      contact); "PHYS 0 1000 1000" is the classic bouncer
+ *      The page restarts with the new physics if it is showing
+ *      Replies "OK", "ERR fmt", "ERR range", "ERR page" or
+ *      "ERR busy"
+ ************************/
+static void cmd_phys(const CmdLine *cl)
+{
+        uint64_t v[3];
+
+        for (uint i = 0; i < 3; i++) {
+                if (cmd_arg_u64(&cl->argv[i + 1], &v[i]) == false) {
+                        cmd_reply_err("fmt");
+                        return;
+                }
+                if (v[i] > BALL_PHYS_MILLI_MAX) {
+                        cmd_reply_err("range");
+                        return;
+                }
+        }
+
+        if (ball_configure(BALL_CFG_PHYS,
+                           BALL_PHYS_PACK(v[0], v[1], v[2]))) {
+                cmd_reply("OK");
+        }
+}
+
+/********** cmd_trail ********
+ *
+ * TRAIL <0|1>: turn the ball page's motion trails off or on
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line, one argument
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from run_line
+ *
+ * Notes:
+ *      The page restarts with the new setting if it is showing
+ *      Replies "OK", "ERR fmt", "ERR range", "ERR page" or
+ *      "ERR busy"
+ ************************/
+static void cmd_trail(const CmdLine *cl)
+{
+        uint64_t on;
+
+        if (cmd_arg_u64(&cl->argv[1], &on) == false) {
+                cmd_reply_err("fmt");
+                return;
+        }
+        if (on > 1) {
+                cmd_reply_err("range");
+                return;
+        }
+
+        if (ball_configure(BALL_CFG_TRAIL, (uint32_t)on)) {
+                cmd_reply("OK");
+        }
+}
+
+/********** ball_configure ********
+ *
+ * Send a setting to the ball page
+ *
+ * Parameters:
+ *      uint key:       BALL_CFG_* key
+ *      uint32_t value: setting value
+ *
+ * Return: true if queued; otherwise "ERR page" or "ERR busy"
+ *         has been replied
+ *
+ * Expects:
+ *      Called from a command handler
+ ************************/
+static bool ball_configure(uint key, uint32_t value)
+{
+        for (uint i = 0; i < page_count; i++) {
+                if (strcmp(page_table[i]->name, BALL_PAGE_NAME) != 0) {
+                        continue;
+                }
+                if (render_configure(i, (uint16_t)key, value) == false) {
+                        cmd_reply_err("busy");
+                        return false;
+                }
+                return true;
+        }
+        cmd_reply_err("page");
+        return false;
+}
+
+/********** cmd_stats ********
+ *
+ * STATS: run every report in turn
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ ************************/
+static void cmd_stats(void)
+{
+        sched_report_idle();
+        sched_report_timing();
+        render_report_pages();
+        latency_report();
+        monitor_report();
+        power_report();
+        timesync_report();
+        remote_report();
+        split_report();
+        life_report();
+        plasma_report();
+}
+
+/********** bench_parse_none ********
+ *
+ * Argument parsing of a command that takes none
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed line
+ *      uint64_t *out:     parsed value, always 0
+ *
+ * Return: true
+ *
+ * Expects:
+ *      cl and out are not NULL
+ ************************/
+static bool bench_parse_none(const CmdLine *cl, uint64_t *out)
+{
+        (void)cl;
+        *out = 0;
+        return true;
+}
+
+/********** bench_parse_time ********
+ *
+ * Argument parsing of T, as cmd_time does it
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed T line
+ *      uint64_t *out:     parsed epoch
+ *
+ * Return: false if cmd_time would reply "ERR fmt"
+ *
+ * Expects:
+ *      cl and out are not NULL
+ ************************/
+static bool bench_parse_time(const CmdLine *cl, uint64_t *out)
+{
+        int64_t epoch;
+
+        if (cl->argc != 2 || cmd_arg_i64(&cl->argv[1], &epoch) == false) {
+                return false;
+        }
+        *out = (uint64_t)epoch;
+        return true;
+}
+
+/********** bench_parse_page ********
+ *
+ * Argument parsing of PAGE, as cmd_page does it
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed PAGE line
+ *      uint64_t *out:     page index
+ *
+ * Return: false if cmd_page would reply "ERR page"
+ *
+ * Expects:
+ *      cl and out are not NULL
+ ************************/
+static bool bench_parse_page(const CmdLine *cl, uint64_t *out)
+{
+        if (cl->argc != 2) {
+                return false;
+        }
+        *out = page_lookup(&cl->argv[1]);
+        return *out < page_count;
+}
+
+/********** bench_parse_color ********
+ *
+ * Argument parsing of COLOR, as cmd_color does it
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed COLOR line
+ *      uint64_t *out:     both colours, bg in the high half
+ *
+ * Return: false if cmd_color would reply "ERR fmt"
+ *
+ * Expects:
+ *      cl and out are not NULL
+ ************************/
+static bool bench_parse_color(const CmdLine *cl, uint64_t *out)
+{
+        uint16_t bg, fg;
+
+        if (cl->argc != 3 ||
+            cmd_arg_hex16(&cl->argv[1], &bg) == false ||
+            cmd_arg_hex16(&cl->argv[2], &fg) == false) {
+                return false;
+        }
+        *out = (uint64_t)bg << 16 | fg;
+        return true;
+}
+
+/********** bench_parse_sync ********
+ *
+ * Argument parsing of a Y sample, as cmd_sync does it
+ *
+ * Parameters:
+ *      const CmdLine *cl: parsed Y line with three arguments
+ *      uint64_t *out:     sum of the parsed values
+ *
+ * Return: false if cmd_sync would reply "ERR fmt"
+ *
+ * Expects:
+ *      cl and out are not NULL
+ ************************/
+static bool bench_parse_sync(const CmdLine *cl, uint64_t *out)
+{
+        uint64_t local_us, rtt_us;
+        int64_t host_us;
+
+        if (cl->argc != 4 ||
+            cmd_arg_u64(&cl->argv[1], &local_us) == false ||
+            cmd_arg_i64(&cl->argv[2], &host_us) == false ||
+            cmd_arg_u64(&cl->argv[3], &rtt_us) == false ||
+            rtt_us > UINT32_MAX) {
+                return false;
+        }
+        *out = local_us + (uint64_t)host_us + rtt_us;
+        return true;
+}
+
+/********** cmd_bench ********
+ *
+ * BENCH: time tokenizing and lookup of sample commands
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      Prints one "BENCH" line per sample with the mean parse
+ *      time in ns (tokenize, table lookup and the argument
+ *      parsing that sample's command does, no dispatch), plus
+ *      the old sscanf parse of a T line for comparison
+ *      A sample whose arguments fail to parse is reported as
+ *      "BENCH ... ERR" instead of a time
+ ************************/
+static void cmd_bench(void)
+{
+        static const struct {
+                const char *line;
+                bool (*parse)(const CmdLine *cl, uint64_t *out);
+        } samples[] = {
+                { "I",                                 bench_parse_none },
+                { "T 1700000123",                      bench_parse_time },
+                { "PAGE Mandelbrot",                   bench_parse_page },
+                { "COLOR 0000 f800",                   bench_parse_color },
+                { "Y 123456789 1700000000123456 850",  bench_parse_sync },
+        };
+        volatile uint64_t sink = 0;
+
+        for (uint s = 0; s < sizeof(samples) / sizeof(samples[0]); s++) {
+                const char *line = samples[s].line;
+                uint len = (uint)strlen(line);
+                CmdLine bl;
+                bool ok = true;
+
+                uint64_t start = time_us_64();
+                for (uint i = 0; i < CMD_BENCH_ITER; i++) {
+                        uint64_t v = 0;
+
+                        ok &= tokenize(line, len, &bl);
+                        const CmdDesc *d = find_command(&bl.argv[0]);
+                        ok &= d != NULL && samples[s].parse(&bl, &v);
+                        sink += v + (uintptr_t)d;
+                }
+                uint64_t took = time_us_64() - start;
+
+                if (ok == false) {
+                        printf("BENCH \"%s\" ERR\n", line);
+                        continue;
+                }
+                printf("BENCH \"%s\" %lluns\n", line,
+                       (unsigned long long)(took * 1000 / CMD_BENCH_ITER));
+        }
+
+        uint64_t start = time_us_64();
+        for (uint i = 0; i < CMD_BENCH_ITER; i++) {
+                long long epoch = 0;
+                sscanf(samples[1].line, "T %lld", &epoch);
+                sink += (uint64_t)epoch;
+        }
+        uint64_t took = time_us_64() - start;
+        printf("BENCH sscanf \"%s\" %lluns\n", samples[1].line,
+               (unsigned long long)(took * 1000 / CMD_BENCH_ITER));
+}
+
+/********** cmd_help ********
+ *
+ * HELP: list commands
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB stdio initialized
+ ************************/
+static void cmd_help(void)
+{
+        for (uint i = 0; i < CMD_COUNT; i++) {
+                cmd_reply(cmd_table[i].help);
+        }
+}
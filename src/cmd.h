@@ -0,0 +1,43 @@
+/**************************************************************
+ *
+ *                           cmd.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the USB serial command layer. Lines are
+ *     read in bulk from the CDC buffer, split into tokens that
+ *     point into the receive buffer, and dispatched through a
+ *     command table.
+ *
+ **************************************************************/
+
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CMD_MAX_ARGS 8
+
+typedef struct {
+        const char *s;
+        uint8_t len;
+} CmdTok;
+
+typedef struct {
+        uint8_t argc;
+        CmdTok argv[CMD_MAX_ARGS];
+        uint64_t rx_us;
+} CmdLine;
+
+void cmd_poll(void);
+
+bool cmd_arg_u64(const CmdTok *t, uint64_t *out);
+bool cmd_arg_i64(const CmdTok *t, int64_t *out);
+bool cmd_arg_hex16(const CmdTok *t, uint16_t *out);
+
+void cmd_reply(const char *s);
+void cmd_reply_err(const char *what);
+void cmd_reply_u64(const char *prefix, uint64_t v);
+
+#endif
@@ -0,0 +1,48 @@
+/**************************************************************
+ *
+ *                          coro.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Stackless coroutines in the protothread style. A
+ *     coroutine is an ordinary function whose body sits
+ *     between CORO_BEGIN and CORO_END; CORO_YIELD returns to
+ *     the caller and the next call resumes after the yield.
+ *
+ *     Locals do not survive a yield, so state that must cross
+ *     one lives in static or caller-owned storage. A switch
+ *     statement may not be used across a yield.
+ *
+ **************************************************************/
+
+#ifndef CORO_H
+#define CORO_H
+
+#include <stdint.h>
+
+typedef enum {
+        CORO_DONE,
+        CORO_RUNNING
+} CoroStatus;
+
+typedef struct {
+        uint16_t line;
+} Coro;
+
+#define CORO_INIT(co)  ((co)->line = 0)
+
+#define CORO_BEGIN(co) switch ((co)->line) { case 0:
+
+#define CORO_YIELD(co)                                  \
+        do {                                            \
+                (co)->line = __LINE__;                  \
+                return CORO_RUNNING;                    \
+                case __LINE__:;                         \
+        } while (0)
+
+#define CORO_END(co)                                    \
+        }                                               \
+        (co)->line = 0;                                 \
+        return CORO_DONE
+
+#endif
@@ -0,0 +1,157 @@
+/**************************************************************
+ *
+ *                         dispmon.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Display monitor. The graphics library is linked with
+ *     --wrap=set_address_window and --wrap=start_display_transfer,
+ *     so every window command and pixel transfer from the
+ *     library or the pages passes through here first and can
+ *     be timestamped or counted without changing the library.
+ *     Calls made inside the driver's own object file are not
+ *     wrapped by the linker and are not seen. While a screen
+ *     capture runs, windows and pixels are also passed on to
+ *     the capture encoder.
+ *
+ *     Idle detection looks for any DMA channel still feeding
+ *     the display SPI data register, then waits for the SPI
+ *     shifter to empty.
+ *
+ **************************************************************/
+
+#include "dispmon.h"
+#include "latency.h"
+#include "capture.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/spi.h"
+
+/* Pico Display Pack wiring used by the ST7789 driver */
+#define DISPLAY_SPI spi0
+
+void __real_set_address_window(uint16_t x0, uint16_t y0,
+                               uint16_t x1, uint16_t y1);
+void __wrap_set_address_window(uint16_t x0, uint16_t y0,
+                               uint16_t x1, uint16_t y1);
+void __real_start_display_transfer(uint16_t *buf, size_t len);
+void __wrap_start_display_transfer(uint16_t *buf, size_t len);
+
+/* pixels handed to the display DMA, render core only */
+static uint32_t pixels_sent = 0;
+
+/********** __wrap_set_address_window ********
+ *
+ * Link-time wrapper around the driver's set_address_window
+ *
+ * Parameters:
+ *      uint16_t x0, y0, x1, y1: window corners (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Linked with -Wl,--wrap=set_address_window
+ *
+ * Notes:
+ *      Marks the first display command of a page switch
+ *      and records the window for a running capture
+ ************************/
+void __wrap_set_address_window(uint16_t x0, uint16_t y0,
+                               uint16_t x1, uint16_t y1)
+{
+        latency_first_command();
+        capture_window(x0, y0, x1, y1);
+        __real_set_address_window(x0, y0, x1, y1);
+}
+
+/********** __wrap_start_display_transfer ********
+ *
+ * Link-time wrapper around the driver's pixel DMA start
+ *
+ * Parameters:
+ *      uint16_t *buf: pixels to send
+ *      size_t len:    number of pixels
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Linked with -Wl,--wrap=start_display_transfer
+ *
+ * Notes:
+ *      Counts pixels for telemetry and encodes them for a
+ *      running capture
+ ************************/
+void __wrap_start_display_transfer(uint16_t *buf, size_t len)
+{
+        pixels_sent += (uint32_t)len;
+        capture_pixels(buf, len);
+        __real_start_display_transfer(buf, len);
+}
+
+/********** dispmon_take_pixels ********
+ *
+ * Pixels sent to the panel since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: pixel count
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+uint32_t dispmon_take_pixels(void)
+{
+        uint32_t n = pixels_sent;
+
+        pixels_sent = 0;
+        return n;
+}
+
+/********** dispmon_busy ********
+ *
+ * Check whether pixel data is still being sent to the panel
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: true while a DMA transfer to the display SPI is
+ *         running or the SPI is still shifting data out
+ *
+ * Expects:
+ *      none
+ ************************/
+bool dispmon_busy(void)
+{
+        uintptr_t dr = (uintptr_t)&spi_get_hw(DISPLAY_SPI)->dr;
+
+        for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+                if (dma_channel_is_claimed(ch) == false) {
+                        continue;
+                }
+                if ((uintptr_t)dma_hw->ch[ch].write_addr == dr &&
+                    dma_channel_is_busy(ch)) {
+                        return true;
+                }
+        }
+        return spi_is_busy(DISPLAY_SPI);
+}
+
+/********** dispmon_wait_idle ********
+ *
+ * Block until all queued pixel data has reached the panel
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+void dispmon_wait_idle(void)
+{
+        while (dispmon_busy()) {
+                tight_loop_contents();
+        }
+}
@@ -0,0 +1,23 @@
+/**************************************************************
+ *
+ *                         dispmon.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the display monitor. Observes commands the
+ *     graphics library sends to the panel, counts pixels sent
+ *     and reports when the display DMA has drained.
+ *
+ **************************************************************/
+
+#ifndef DISPMON_H
+#define DISPMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+uint32_t dispmon_take_pixels(void);
+bool dispmon_busy(void);
+void dispmon_wait_idle(void);
+
+#endif
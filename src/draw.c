@@ -0,0 +1,83 @@
+/**************************************************************
+ *
+ *                          draw.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Incremental drawing helpers. A screen fill is sent in
+ *     bands of rows so a page can yield between bands instead
+ *     of blocking for the whole frame.
+ *
+ **************************************************************/
+
+#include "draw.h"
+#include "../lib/src/ST7789/hardware.h"
+#include "../lib/src/graphics/util.h"
+#include "pico/stdlib.h"
+
+#define FILL_BAND_ROWS 16
+
+static uint16_t fill_row[SCREEN_WIDTH];
+static int fill_y = SCREEN_HEIGHT;
+
+/********** draw_fill_begin ********
+ *
+ * Start filling the whole screen with one color
+ *
+ * Parameters:
+ *      uint16_t color: fill color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Nothing is drawn until draw_fill_step is called
+ ************************/
+void draw_fill_begin(uint16_t color)
+{
+        uint16_t pix = (uint16_t)((color << 8) | (color >> 8));
+
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+                fill_row[x] = pix;
+        }
+        fill_y = 0;
+}
+
+/********** draw_fill_step ********
+ *
+ * Continue the fill until it completes or time runs out
+ *
+ * Parameters:
+ *      absolute_time_t until: stop starting new bands after this
+ *
+ * Return: true when the whole screen has been filled
+ *
+ * Expects:
+ *      draw_fill_begin has been called
+ *
+ * Notes:
+ *      Always sends at least one band of FILL_BAND_ROWS rows
+ ************************/
+bool draw_fill_step(absolute_time_t until)
+{
+        while (fill_y < SCREEN_HEIGHT) {
+                int y1 = fill_y + FILL_BAND_ROWS - 1;
+                if (y1 >= SCREEN_HEIGHT) {
+                        y1 = SCREEN_HEIGHT - 1;
+                }
+
+                set_address_window(0, (uint16_t)fill_y,
+                                   SCREEN_WIDTH - 1, (uint16_t)y1);
+                for (int y = fill_y; y <= y1; y++) {
+                        start_display_transfer(fill_row, SCREEN_WIDTH);
+                }
+                fill_y = y1 + 1;
+
+                if (time_reached(until)) {
+                        break;
+                }
+        }
+        return fill_y >= SCREEN_HEIGHT;
+}
@@ -0,0 +1,22 @@
+/**************************************************************
+ *
+ *                          draw.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for incremental drawing helpers that let page
+ *     code split full-screen work into time-bounded slices.
+ *
+ **************************************************************/
+
+#ifndef DRAW_H
+#define DRAW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+void draw_fill_begin(uint16_t color);
+bool draw_fill_step(absolute_time_t until);
+
+#endif
@@ -0,0 +1,184 @@
+/**************************************************************
+ *
+ *                           fire.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Classic demo fire in the 8-bit indexed framebuffer.
+ *     Each pixel's index is its heat. The bottom row is
+ *     reseeded with random heat every frame; every other
+ *     pixel becomes the average of the three pixels below it
+ *     and the one two rows down, minus FIRE_COOLING, so heat
+ *     rises and fades. The palette runs from black through
+ *     red and yellow to white.
+ *
+ *     Rows are updated top to bottom in place: a row only
+ *     reads the rows below it, which still hold the last
+ *     frame. Rows that were cold with cold rows beneath them
+ *     stay cold and are skipped, and only rows whose heat
+ *     changed are marked for scan-out.
+ *
+ **************************************************************/
+
+#include "fire.h"
+#include "indexed.h"
+#include "../lib/src/graphics/util.h"
+#include <stdbool.h>
+
+#define FIRE_COOLING 2
+#define FIRE_SEED_MIN 0xa0
+
+static bool hot[INDEXED_HEIGHT];
+
+static uint32_t next_rand(Fire *f);
+static void seed_bottom(Fire *f);
+
+/********** next_rand ********
+ *
+ * Advance the fire's random sequence
+ *
+ * Parameters:
+ *      Fire *f: fire state
+ *
+ * Return: 32 pseudo-random bits
+ *
+ * Expects:
+ *      f is not NULL
+ ************************/
+static uint32_t next_rand(Fire *f)
+{
+        f->seed ^= f->seed << 13;
+        f->seed ^= f->seed >> 17;
+        f->seed ^= f->seed << 5;
+        return f->seed;
+}
+
+/********** seed_bottom ********
+ *
+ * Put fresh random heat into the bottom row
+ *
+ * Parameters:
+ *      Fire *f: fire state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      f is not NULL
+ *
+ * Notes:
+ *      Heat is chosen per four pixels, giving wider tongues
+ *      of flame than per-pixel noise
+ ************************/
+static void seed_bottom(Fire *f)
+{
+        uint8_t *row = indexed_row(INDEXED_HEIGHT - 1);
+
+        for (int x = 0; x < INDEXED_WIDTH; x += 4) {
+                uint32_t r = next_rand(f);
+                uint8_t v = (uint8_t)(FIRE_SEED_MIN +
+                                      (r & 0xff) % (256 - FIRE_SEED_MIN));
+
+                if ((r >> 8) % 8 == 0) {
+                        v = 0;
+                }
+                row[x] = v;
+                row[x + 1] = v;
+                row[x + 2] = v;
+                row[x + 3] = v;
+        }
+        hot[INDEXED_HEIGHT - 1] = true;
+        indexed_mark_rows(INDEXED_HEIGHT - 1, INDEXED_HEIGHT - 1);
+}
+
+/********** fire_init ********
+ *
+ * Start the fire from a cold screen
+ *
+ * Parameters:
+ *      Fire *f: fire state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      f is not NULL
+ *      Called on the render core
+ *
+ * Notes:
+ *      Sets the fire palette and clears the index buffer,
+ *      which marks every row for scan-out
+ ************************/
+void fire_init(Fire *f)
+{
+        uint16_t colors[256];
+
+        for (int i = 0; i < 256; i++) {
+                int r = i < 64 ? i * 4 : 255;
+                int g = i < 64 ? 0 : i < 128 ? (i - 64) * 4 : 255;
+                int b = i < 128 ? 0 : i < 192 ? (i - 128) * 4 : 255;
+
+                colors[i] = color565((uint8_t)r, (uint8_t)g, (uint8_t)b);
+        }
+        indexed_set_palette(0, 256, colors);
+        indexed_clear(0);
+
+        for (int y = 0; y < INDEXED_HEIGHT; y++) {
+                hot[y] = false;
+        }
+        f->seed = 0x6d2b79f5u;
+        f->frames = 0;
+}
+
+/********** fire_tick ********
+ *
+ * Advance the fire by one frame
+ *
+ * Parameters:
+ *      Fire *f: fire state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      fire_init has been called on f
+ *
+ * Notes:
+ *      Only updates the index buffer and marks rows; the
+ *      caller sends them with indexed_scanout
+ *      The row above the bottom uses the bottom row in place
+ *      of the missing row two below
+ ************************/
+void fire_tick(Fire *f)
+{
+        for (int y = 0; y < INDEXED_HEIGHT - 1; y++) {
+                int y2 = y + 2 < INDEXED_HEIGHT ? y + 2 : INDEXED_HEIGHT - 1;
+
+                if (!hot[y] && !hot[y + 1] && !hot[y2]) {
+                        continue;
+                }
+
+                uint8_t *dst = indexed_row(y);
+                const uint8_t *b1 = indexed_row(y + 1);
+                const uint8_t *b2 = indexed_row(y2);
+                bool changed = false;
+                bool any = false;
+
+                for (int x = 1; x < INDEXED_WIDTH - 1; x++) {
+                        uint sum = (uint)b1[x - 1] + b1[x] + b1[x + 1] + b2[x];
+                        uint v = sum >> 2;
+
+                        v = v > FIRE_COOLING ? v - FIRE_COOLING : 0;
+                        changed |= dst[x] != v;
+                        any |= v != 0;
+                        dst[x] = (uint8_t)v;
+                }
+                dst[0] = 0;
+                dst[INDEXED_WIDTH - 1] = 0;
+
+                hot[y] = any;
+                if (changed) {
+                        indexed_mark_rows(y, y);
+                }
+        }
+
+        seed_bottom(f);
+        f->frames++;
+}
@@ -0,0 +1,29 @@
+/**************************************************************
+ *
+ *                           fire.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the fire page, drawn in the 8-bit indexed
+ *     framebuffer.
+ *
+ **************************************************************/
+
+#ifndef FIRE_H
+#define FIRE_H
+
+#include <stdint.h>
+#include "pico/types.h"
+
+/* per-row heat flags */
+#define FIRE_SCRATCH_BYTES 240
+
+typedef struct {
+        uint32_t seed;
+        uint32_t frames;
+} Fire;
+
+void fire_init(Fire *f);
+void fire_tick(Fire *f);
+
+#endif
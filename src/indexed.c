@@ -0,0 +1,243 @@
+/**************************************************************
+ *
+ *                         indexed.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     8-bit indexed framebuffer. A full RGB565 frame would
+ *     take 150 KB; one byte per pixel takes half that, so a
+ *     page can keep the whole screen in RAM and redraw only
+ *     what it changes.
+ *
+ *     Pages write palette indices through indexed_row and
+ *     mark the rows they touched. Scan-out walks the marked
+ *     rows top to bottom, opens one address window per run
+ *     of consecutive rows, and expands each row through the
+ *     256-entry palette (stored byte-swapped, four pixels per
+ *     word read) into one of two line buffers, so a row is
+ *     expanded while the previous one is still on the wire.
+ *
+ *     Changing palette entries marks every row, so palette
+ *     animation costs one scan-out and no drawing.
+ *
+ *     Used on the render core only.
+ *
+ **************************************************************/
+
+#include "indexed.h"
+#include "../lib/src/ST7789/hardware.h"
+#include "pico/stdlib.h"
+
+static uint32_t fb[INDEXED_HEIGHT][INDEXED_WIDTH / 4];
+static uint16_t pal[256];
+static bool dirty[INDEXED_HEIGHT];
+static int scan_y = INDEXED_HEIGHT;
+
+static uint16_t line[2][INDEXED_WIDTH];
+static uint line_next = 0;
+static uint32_t rows_taken = 0;
+
+static void expand_row(int y, uint16_t *out);
+
+/********** indexed_row ********
+ *
+ * Get a row of the index buffer for drawing
+ *
+ * Parameters:
+ *      int y: screen row
+ *
+ * Return: INDEXED_WIDTH palette indices, word aligned
+ *
+ * Expects:
+ *      0 <= y < INDEXED_HEIGHT
+ *      The caller marks the row with indexed_mark_rows after
+ *      changing it
+ ************************/
+uint8_t *indexed_row(int y)
+{
+        return (uint8_t *)fb[y];
+}
+
+/********** indexed_clear ********
+ *
+ * Set every pixel to one index
+ *
+ * Parameters:
+ *      uint8_t index: palette index
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Marks every row
+ ************************/
+void indexed_clear(uint8_t index)
+{
+        uint32_t v = index * 0x01010101u;
+
+        for (int y = 0; y < INDEXED_HEIGHT; y++) {
+                for (int w = 0; w < INDEXED_WIDTH / 4; w++) {
+                        fb[y][w] = v;
+                }
+        }
+        indexed_mark_rows(0, INDEXED_HEIGHT - 1);
+}
+
+/********** indexed_set_palette ********
+ *
+ * Replace a range of palette entries
+ *
+ * Parameters:
+ *      uint first:             first entry to set
+ *      uint n:                 number of entries
+ *      const uint16_t *colors: n RGB565 colors
+ *
+ * Return: none
+ *
+ * Expects:
+ *      first + n <= 256
+ *
+ * Notes:
+ *      Marks every row, since any of them may use the entries
+ ************************/
+void indexed_set_palette(uint first, uint n, const uint16_t *colors)
+{
+        for (uint i = 0; i < n; i++) {
+                uint16_t c = colors[i];
+
+                pal[first + i] = (uint16_t)((c << 8) | (c >> 8));
+        }
+        indexed_mark_rows(0, INDEXED_HEIGHT - 1);
+}
+
+/********** indexed_mark_rows ********
+ *
+ * Mark rows for the next scan-out
+ *
+ * Parameters:
+ *      int y0, y1: rows, inclusive; clipped to the screen
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Restarts a scan-out in progress from the top row, so
+ *      rows above its position that were marked again are
+ *      not missed
+ ************************/
+void indexed_mark_rows(int y0, int y1)
+{
+        if (y0 < 0) {
+                y0 = 0;
+        }
+        if (y1 >= INDEXED_HEIGHT) {
+                y1 = INDEXED_HEIGHT - 1;
+        }
+        for (int y = y0; y <= y1; y++) {
+                dirty[y] = true;
+        }
+        if (y0 <= y1) {
+                scan_y = 0;
+        }
+}
+
+/********** expand_row ********
+ *
+ * Turn a row of indices into panel pixels
+ *
+ * Parameters:
+ *      int y:         screen row
+ *      uint16_t *out: INDEXED_WIDTH byte-swapped pixels
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= y < INDEXED_HEIGHT
+ ************************/
+static void expand_row(int y, uint16_t *out)
+{
+        const uint32_t *src = fb[y];
+
+        for (int w = 0; w < INDEXED_WIDTH / 4; w++) {
+                uint32_t v = src[w];
+
+                out[0] = pal[v & 0xff];
+                out[1] = pal[(v >> 8) & 0xff];
+                out[2] = pal[(v >> 16) & 0xff];
+                out[3] = pal[v >> 24];
+                out += 4;
+        }
+}
+
+/********** indexed_scanout ********
+ *
+ * Send marked rows to the panel until done or out of time
+ *
+ * Parameters:
+ *      absolute_time_t until: stop starting new runs after this
+ *
+ * Return: true when no marked rows are left
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Always sends at least one run of consecutive marked
+ *      rows if any are left
+ ************************/
+bool indexed_scanout(absolute_time_t until)
+{
+        while (scan_y < INDEXED_HEIGHT) {
+                if (dirty[scan_y] == false) {
+                        scan_y++;
+                        continue;
+                }
+
+                int y1 = scan_y;
+                while (y1 + 1 < INDEXED_HEIGHT && dirty[y1 + 1]) {
+                        y1++;
+                }
+
+                set_address_window(0, (uint16_t)scan_y, INDEXED_WIDTH - 1,
+                                   (uint16_t)y1);
+                for (int y = scan_y; y <= y1; y++) {
+                        uint16_t *buf = line[line_next];
+
+                        line_next ^= 1;
+                        dirty[y] = false;
+                        expand_row(y, buf);
+                        start_display_transfer(buf, INDEXED_WIDTH);
+                }
+                rows_taken += (uint32_t)(y1 - scan_y + 1);
+                scan_y = y1 + 1;
+
+                if (time_reached(until)) {
+                        break;
+                }
+        }
+        return scan_y >= INDEXED_HEIGHT;
+}
+
+/********** indexed_take_rows ********
+ *
+ * Rows scanned out since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: row count
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+uint32_t indexed_take_rows(void)
+{
+        uint32_t n = rows_taken;
+
+        rows_taken = 0;
+        return n;
+}
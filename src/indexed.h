@@ -0,0 +1,34 @@
+/**************************************************************
+ *
+ *                         indexed.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the 8-bit indexed framebuffer: pages draw
+ *     palette indices into a full-screen buffer and scan-out
+ *     expands changed rows to RGB565 for the panel.
+ *
+ **************************************************************/
+
+#ifndef INDEXED_H
+#define INDEXED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define INDEXED_WIDTH  320
+#define INDEXED_HEIGHT 240
+
+/* index buffer, palette, dirty rows and two line buffers */
+#define INDEXED_BYTES (INDEXED_WIDTH * INDEXED_HEIGHT + 256 * 2 + \
+                       INDEXED_HEIGHT + 2 * INDEXED_WIDTH * 2)
+
+uint8_t *indexed_row(int y);
+void indexed_clear(uint8_t index);
+void indexed_set_palette(uint first, uint n, const uint16_t *colors);
+void indexed_mark_rows(int y0, int y1);
+bool indexed_scanout(absolute_time_t until);
+uint32_t indexed_take_rows(void);
+
+#endif
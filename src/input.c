@@ -0,0 +1,298 @@
+/**************************************************************
+ *
+ *                          input.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interrupt-driven button input. Each button runs a small
+ *     debounce state machine driven by GPIO edge interrupts
+ *     and one-shot alarms:
+ *
+ *        IDLE --fall--> PRESS_WAIT --stable low--> HELD
+ *        HELD --rise--> RELEASE_WAIT --stable high--> IDLE
+ *
+ *     A stable change emits an event stamped with the time of
+ *     the first edge, so debouncing adds no latency to the
+ *     reported timestamp. While HELD the alarm also produces
+ *     long-press and auto-repeat events. Events go through an
+ *     SPSC queue; the control loop only consumes them, so no
+ *     press is missed however long the loop is busy.
+ *
+ **************************************************************/
+
+#include "input.h"
+#include "spsc.h"
+#include "sched.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+
+#define DEBOUNCE_US     5000
+#define LONG_PRESS_US   600000
+#define REPEAT_US       150000
+#define INPUT_QUEUE_LEN 16
+
+typedef enum {
+        BTN_IDLE,
+        BTN_PRESS_WAIT,
+        BTN_HELD,
+        BTN_RELEASE_WAIT
+} ButtonState;
+
+typedef struct {
+        uint pin;
+        ButtonState state;
+        bool long_sent;
+        alarm_id_t alarm;
+        uint32_t edge_us;
+} Button;
+
+static Button buttons[INPUT_MAX_BUTTONS];
+static uint button_count = 0;
+
+static SpscQueue event_queue;
+static ButtonEvent event_buf[INPUT_QUEUE_LEN];
+static volatile uint32_t dropped = 0;
+
+static void emit(uint index, ButtonEventType type, uint32_t edge_us);
+static void arm(Button *b, uint index, uint32_t delay_us);
+static int64_t button_alarm(alarm_id_t id, void *user_data);
+static void button_edge_irq(uint gpio, uint32_t events);
+
+/********** emit ********
+ *
+ * Queue an event for the control loop and wake it
+ *
+ * Parameters:
+ *      uint index:           button index
+ *      ButtonEventType type: event kind
+ *      uint32_t edge_us:     timestamp (time_us_32 domain)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from GPIO or alarm interrupt context on core0
+ *
+ * Notes:
+ *      Events are dropped and counted if the queue is full
+ ************************/
+static void emit(uint index, ButtonEventType type, uint32_t edge_us)
+{
+        ButtonEvent ev = {
+                .button = (uint8_t)index,
+                .type = (uint8_t)type,
+                .reserved = 0,
+                .edge_us = edge_us
+        };
+
+        if (spsc_push(&event_queue, &ev) == false) {
+                dropped++;
+                return;
+        }
+        sched_post(SCHED_CORE_CONTROL, SCHED_EV_BUTTON);
+}
+
+/********** arm ********
+ *
+ * (Re)arm a button's one-shot alarm
+ *
+ * Parameters:
+ *      Button *b:         button state
+ *      uint index:        button index passed to the callback
+ *      uint32_t delay_us: time from now
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Interrupt context on core0
+ ************************/
+static void arm(Button *b, uint index, uint32_t delay_us)
+{
+        if (b->alarm > 0) {
+                cancel_alarm(b->alarm);
+        }
+        b->alarm = add_alarm_in_us(delay_us, button_alarm,
+                                   (void *)(uintptr_t)index, true);
+}
+
+/********** button_alarm ********
+ *
+ * Alarm handler: settle debounce or generate hold events
+ *
+ * Parameters:
+ *      alarm_id_t id:   alarm that fired (unused)
+ *      void *user_data: button index
+ *
+ * Return: microseconds until the alarm should fire again,
+ *         or 0 to stop
+ *
+ * Expects:
+ *      Runs in timer interrupt context on core0
+ *
+ * Notes:
+ *      A level that bounced back during the debounce window
+ *      returns the button to its previous stable state
+ ************************/
+static int64_t button_alarm(alarm_id_t id, void *user_data)
+{
+        (void)id;
+        uint index = (uint)(uintptr_t)user_data;
+        Button *b = &buttons[index];
+        bool down = gpio_get(b->pin) == 0;
+
+        switch (b->state) {
+        case BTN_PRESS_WAIT:
+                if (down == false) {
+                        b->state = BTN_IDLE;
+                        break;
+                }
+                b->state = BTN_HELD;
+                b->long_sent = false;
+                emit(index, BUTTON_EV_PRESS, b->edge_us);
+                return LONG_PRESS_US - DEBOUNCE_US;
+
+        case BTN_HELD:
+                if (down == false) {
+                        break;
+                }
+                emit(index, b->long_sent ? BUTTON_EV_REPEAT :
+                                           BUTTON_EV_LONG,
+                     time_us_32());
+                b->long_sent = true;
+                return REPEAT_US;
+
+        case BTN_RELEASE_WAIT:
+                if (down) {
+                        b->state = BTN_HELD;
+                        break;
+                }
+                b->state = BTN_IDLE;
+                emit(index, BUTTON_EV_RELEASE, b->edge_us);
+                break;
+
+        default:
+                break;
+        }
+
+        b->alarm = 0;
+        return 0;
+}
+
+/********** button_edge_irq ********
+ *
+ * GPIO interrupt handler for button edges
+ *
+ * Parameters:
+ *      uint gpio:       pin that changed
+ *      uint32_t events: GPIO_IRQ_EDGE_* flags
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Runs in GPIO interrupt context on core0
+ *
+ * Notes:
+ *      Only the first edge of a bounce burst starts the
+ *      debounce timer; later edges are ignored until it fires
+ ************************/
+static void button_edge_irq(uint gpio, uint32_t events)
+{
+        uint32_t now = time_us_32();
+
+        for (uint i = 0; i < button_count; i++) {
+                Button *b = &buttons[i];
+                if (b->pin != gpio) {
+                        continue;
+                }
+
+                if (b->state == BTN_IDLE &&
+                    (events & GPIO_IRQ_EDGE_FALL)) {
+                        b->state = BTN_PRESS_WAIT;
+                        b->edge_us = now;
+                        arm(b, i, DEBOUNCE_US);
+                } else if (b->state == BTN_HELD &&
+                           (events & GPIO_IRQ_EDGE_RISE)) {
+                        b->state = BTN_RELEASE_WAIT;
+                        b->edge_us = now;
+                        arm(b, i, DEBOUNCE_US);
+                }
+                return;
+        }
+}
+
+/********** input_init ********
+ *
+ * Configure button pins and their edge interrupts
+ *
+ * Parameters:
+ *      const uint *pins: GPIO numbers, one per button
+ *      uint count:       number of buttons (<= INPUT_MAX_BUTTONS)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 after sched_init
+ *
+ * Notes:
+ *      Buttons are active-low with pull-up resistors
+ *      Event button index is the position in pins
+ ************************/
+void input_init(const uint *pins, uint count)
+{
+        if (count > INPUT_MAX_BUTTONS) {
+                count = INPUT_MAX_BUTTONS;
+        }
+
+        spsc_init(&event_queue, event_buf, sizeof(ButtonEvent),
+                  INPUT_QUEUE_LEN);
+
+        for (uint i = 0; i < count; i++) {
+                buttons[i].pin = pins[i];
+                buttons[i].state = BTN_IDLE;
+                buttons[i].alarm = 0;
+
+                gpio_init(pins[i]);
+                gpio_set_dir(pins[i], GPIO_IN);
+                gpio_pull_up(pins[i]);
+        }
+        button_count = count;
+
+        for (uint i = 0; i < count; i++) {
+                gpio_set_irq_enabled_with_callback(
+                        pins[i], GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE,
+                        true, button_edge_irq);
+        }
+}
+
+/********** input_next ********
+ *
+ * Fetch the next button event
+ *
+ * Parameters:
+ *      ButtonEvent *ev: destination
+ *
+ * Return: true if an event was returned, false if none pending
+ *
+ * Expects:
+ *      Called from core0 thread context only
+ ************************/
+bool input_next(ButtonEvent *ev)
+{
+        return spsc_pop(&event_queue, ev);
+}
+
+/********** input_dropped ********
+ *
+ * Number of events lost to a full queue since boot
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: dropped event count
+ *
+ * Expects:
+ *      none
+ ************************/
+uint32_t input_dropped(void)
+{
+        return dropped;
+}
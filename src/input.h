@@ -0,0 +1,41 @@
+/**************************************************************
+ *
+ *                          input.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for interrupt-driven button input. Edges are
+ *     debounced in interrupt context and delivered to the
+ *     control loop as timestamped press, release, long-press
+ *     and repeat events.
+ *
+ **************************************************************/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define INPUT_MAX_BUTTONS 4
+
+typedef enum {
+        BUTTON_EV_PRESS,
+        BUTTON_EV_RELEASE,
+        BUTTON_EV_LONG,
+        BUTTON_EV_REPEAT
+} ButtonEventType;
+
+typedef struct {
+        uint8_t button;
+        uint8_t type;
+        uint16_t reserved;
+        uint32_t edge_us;
+} ButtonEvent;
+
+void input_init(const uint *pins, uint count);
+bool input_next(ButtonEvent *ev);
+uint32_t input_dropped(void);
+
+#endif
@@ -0,0 +1,313 @@
+/**************************************************************
+ *
+ *                         latency.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Input-to-photon latency instrumentation. A page switch
+ *     is timestamped at four points:
+ *
+ *        edge   - button GPIO edge (from the input queue)
+ *        switch - render core starts handling the switch
+ *        cmd    - first window command sent to the panel
+ *        done   - DMA drained after the page's first frame
+ *
+ *     Each (from, to) transition keeps count, min, max, mean
+ *     per stage and a half-octave histogram for the p99.
+ *     Recording happens on the render core only.
+ *
+ **************************************************************/
+
+#include "latency.h"
+#include "page.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+#define LAT_MAX_PAIRS 16
+#define LAT_BUCKETS   48
+
+typedef struct {
+        bool used;
+        uint8_t from;
+        uint8_t to;
+        uint32_t count;
+        uint32_t min_us;
+        uint32_t max_us;
+        uint64_t sum_us;
+        uint64_t sum_switch_us;
+        uint64_t sum_cmd_us;
+        uint64_t sum_done_us;
+        uint16_t hist[LAT_BUCKETS];
+} LatencyPair;
+
+typedef struct {
+        bool active;
+        bool cmd_seen;
+        uint8_t from;
+        uint8_t to;
+        uint32_t edge_us;
+        uint32_t switch_us;
+        uint32_t cmd_us;
+} PendingSwitch;
+
+static LatencyPair pairs[LAT_MAX_PAIRS];
+static PendingSwitch pending;
+
+static uint lat_bucket(uint32_t us);
+static uint32_t bucket_upper(uint b);
+static LatencyPair *find_pair(uint from, uint to);
+static uint32_t percentile_99(const LatencyPair *p);
+
+/********** lat_bucket ********
+ *
+ * Map a latency to a half-octave histogram bucket
+ *
+ * Parameters:
+ *      uint32_t us: latency in microseconds
+ *
+ * Return: bucket index in [0, LAT_BUCKETS)
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Values below 4 get their own bucket; above that each
+ *      power of two is split in two, so a bucket's upper bound
+ *      overstates the value by at most 50%
+ ************************/
+static uint lat_bucket(uint32_t us)
+{
+        if (us < 4) {
+                return us;
+        }
+
+        uint msb = 31u - (uint)__builtin_clz(us);
+        uint half = (us >> (msb - 1)) & 1u;
+        uint b = 2 * msb + half;
+        return b < LAT_BUCKETS ? b : LAT_BUCKETS - 1;
+}
+
+/********** bucket_upper ********
+ *
+ * Largest latency that falls into a bucket
+ *
+ * Parameters:
+ *      uint b: bucket index
+ *
+ * Return: upper bound in microseconds
+ *
+ * Expects:
+ *      b < LAT_BUCKETS
+ ************************/
+static uint32_t bucket_upper(uint b)
+{
+        if (b < 4) {
+                return b;
+        }
+
+        uint msb = b / 2;
+        uint half = b % 2;
+        return ((3u + half) << (msb - 1)) - 1u;
+}
+
+/********** find_pair ********
+ *
+ * Find or allocate the statistics slot for a transition
+ *
+ * Parameters:
+ *      uint from, to: page indices
+ *
+ * Return: slot, or NULL if all slots are taken
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+static LatencyPair *find_pair(uint from, uint to)
+{
+        for (uint i = 0; i < LAT_MAX_PAIRS; i++) {
+                LatencyPair *p = &pairs[i];
+
+                if (p->used == false) {
+                        p->used = true;
+                        p->from = (uint8_t)from;
+                        p->to = (uint8_t)to;
+                        p->min_us = UINT32_MAX;
+                        return p;
+                }
+                if (p->from == from && p->to == to) {
+                        return p;
+                }
+        }
+        return NULL;
+}
+
+/********** percentile_99 ********
+ *
+ * Estimate the 99th percentile from the histogram
+ *
+ * Parameters:
+ *      const LatencyPair *p: transition statistics
+ *
+ * Return: upper bound of the bucket holding the p99 sample,
+ *         capped at the observed maximum
+ *
+ * Expects:
+ *      p->count > 0
+ ************************/
+static uint32_t percentile_99(const LatencyPair *p)
+{
+        uint32_t rank = (p->count * 99u + 99u) / 100u;
+        uint32_t seen = 0;
+
+        for (uint b = 0; b < LAT_BUCKETS; b++) {
+                seen += p->hist[b];
+                if (seen >= rank) {
+                        uint32_t up = bucket_upper(b);
+                        return up < p->max_us ? up : p->max_us;
+                }
+        }
+        return p->max_us;
+}
+
+/********** latency_begin ********
+ *
+ * Start measuring a page switch
+ *
+ * Parameters:
+ *      uint from:        page being left
+ *      uint to:          page being entered
+ *      uint32_t edge_us: input timestamp (time_us_32 domain)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core as it starts the switch
+ *
+ * Notes:
+ *      A switch still in progress is abandoned
+ ************************/
+void latency_begin(uint from, uint to, uint32_t edge_us)
+{
+        pending.active = true;
+        pending.cmd_seen = false;
+        pending.from = (uint8_t)from;
+        pending.to = (uint8_t)to;
+        pending.edge_us = edge_us;
+        pending.switch_us = time_us_32();
+}
+
+/********** latency_first_command ********
+ *
+ * Note a display command for the switch being measured
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called by the display monitor on every window command
+ *
+ * Notes:
+ *      Only the first command after latency_begin counts
+ ************************/
+void latency_first_command(void)
+{
+        if (pending.active && pending.cmd_seen == false) {
+                pending.cmd_us = time_us_32();
+                pending.cmd_seen = true;
+        }
+}
+
+/********** latency_frame_done ********
+ *
+ * Finish measuring a page switch
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once the new page's first full frame has been
+ *      drawn and the display DMA has drained
+ ************************/
+void latency_frame_done(void)
+{
+        if (pending.active == false) {
+                return;
+        }
+        pending.active = false;
+
+        uint32_t now = time_us_32();
+        if (pending.cmd_seen == false) {
+                pending.cmd_us = now;
+        }
+
+        LatencyPair *p = find_pair(pending.from, pending.to);
+        if (p == NULL) {
+                return;
+        }
+
+        uint32_t total = now - pending.edge_us;
+        p->count++;
+        p->sum_us += total;
+        p->sum_switch_us += pending.switch_us - pending.edge_us;
+        p->sum_cmd_us += pending.cmd_us - pending.switch_us;
+        p->sum_done_us += now - pending.cmd_us;
+        if (total < p->min_us) {
+                p->min_us = total;
+        }
+        if (total > p->max_us) {
+                p->max_us = total;
+        }
+
+        uint b = lat_bucket(total);
+        if (p->hist[b] < UINT16_MAX) {
+                p->hist[b]++;
+        }
+}
+
+/********** latency_report ********
+ *
+ * Print latency statistics for each observed transition
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB serial initialized
+ *
+ * Notes:
+ *      "LAT <from>-><to> n min avg p99 max" by page name, in
+ *      microseconds,
+ *      followed by mean time in each stage: edge->switch,
+ *      switch->first command, first command->frame done
+ *      Ends with "OK"
+ ************************/
+void latency_report(void)
+{
+        for (uint i = 0; i < LAT_MAX_PAIRS && pairs[i].used; i++) {
+                const LatencyPair *p = &pairs[i];
+                if (p->count == 0) {
+                        continue;
+                }
+
+                printf("LAT %s->%s n=%lu min=%lu avg=%lu p99=%lu "
+                       "max=%lu switch=%lu cmd=%lu done=%lu\n",
+                       page_table[p->from]->name,
+                       page_table[p->to]->name,
+                       (unsigned long)p->count,
+                       (unsigned long)p->min_us,
+                       (unsigned long)(p->sum_us / p->count),
+                       (unsigned long)percentile_99(p),
+                       (unsigned long)p->max_us,
+                       (unsigned long)(p->sum_switch_us / p->count),
+                       (unsigned long)(p->sum_cmd_us / p->count),
+                       (unsigned long)(p->sum_done_us / p->count));
+        }
+        printf("OK\n");
+}
@@ -0,0 +1,23 @@
+/**************************************************************
+ *
+ *                         latency.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for input-to-photon latency measurement across
+ *     page switches.
+ *
+ **************************************************************/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "pico/types.h"
+
+void latency_begin(uint from, uint to, uint32_t edge_us);
+void latency_first_command(void);
+void latency_frame_done(void);
+void latency_report(void);
+
+#endif
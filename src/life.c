@@ -0,0 +1,367 @@
+/**************************************************************
+ *
+ *                           life.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Conway's Game of Life, LIFE_COLS x LIFE_ROWS cells at
+ *     2x2 pixels, filling the panel.
+ *
+ *     The grid is one bit per cell, 32 cells per word. A
+ *     generation works on whole words: the eight neighbour
+ *     words (the rows above and below and this row, each
+ *     shifted one cell left and right, carrying the end bit
+ *     in from the next word) are summed by a tree of bitwise
+ *     full adders into a 3-bit count per cell, and the rule
+ *     "3, or 2 and alive" is a few more logic operations. A
+ *     count of 8 wraps to 0, which the rule treats the same.
+ *
+ *     Rows are split across both cores with split_run; each
+ *     half writes its own rows of the next generation and
+ *     flags the rows that differ. Only flagged rows are sent,
+ *     each expanded to a 2-pixel-per-cell scanline and pushed
+ *     twice through push_scanline_swapped_xy from two
+ *     alternating line buffers.
+ *
+ *     The grid is reseeded when nothing changes any more or
+ *     after LIFE_RESEED_GENS generations.
+ *
+ **************************************************************/
+
+#include "life.h"
+#include "split.h"
+#include "pico/stdlib.h"
+#include "../lib/src/graphics/util.h"
+#include <stdio.h>
+
+#define LIFE_RESEED_GENS 3000
+#define LIFE_RATE_US     1000000
+
+static uint8_t row_changed[LIFE_ROWS];
+static uint16_t line[2][2 * LIFE_COLS];
+static uint line_next = 0;
+
+static Life *active;
+
+static uint32_t gens_taken = 0;
+static uint32_t rate_start_us;
+static uint32_t rate_gens = 0;
+static volatile uint32_t gens_total = 0;
+static volatile uint32_t gens_per_sec = 0;
+static volatile uint32_t rows_sent = 0;
+
+static inline uint16_t swap565(uint16_t c);
+static uint32_t next_rand(Life *l);
+static void seed_grid(Life *l);
+static void step_rows(uint begin, uint end, uint part);
+static void push_row(const Life *l, int y);
+
+/********** swap565 ********
+ *
+ * Swap byte order of RGB565 color for display transfer
+ *
+ * Parameters:
+ *      uint16_t c: color in RGB565 format
+ *
+ * Return: byte-swapped RGB565 color
+ *
+ * Expects:
+ *      none
+ ************************/
+static inline uint16_t swap565(uint16_t c)
+{
+        return (uint16_t)((c << 8) | (c >> 8));
+}
+
+/********** next_rand ********
+ *
+ * Advance the grid's random sequence
+ *
+ * Parameters:
+ *      Life *l: game state
+ *
+ * Return: 32 pseudo-random bits
+ *
+ * Expects:
+ *      l is not NULL
+ ************************/
+static uint32_t next_rand(Life *l)
+{
+        l->seed ^= l->seed << 13;
+        l->seed ^= l->seed >> 17;
+        l->seed ^= l->seed << 5;
+        return l->seed;
+}
+
+/********** seed_grid ********
+ *
+ * Fill the grid with random cells, about one in four alive
+ *
+ * Parameters:
+ *      Life *l: game state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      l is not NULL
+ *
+ * Notes:
+ *      Asks for a full redraw on the next tick
+ ************************/
+static void seed_grid(Life *l)
+{
+        for (int y = 0; y < LIFE_ROWS; y++) {
+                for (int w = 0; w < LIFE_WORDS; w++) {
+                        l->cells[l->cur][y][w] = next_rand(l) & next_rand(l);
+                }
+        }
+        l->gen = 0;
+        l->full = true;
+}
+
+/********** life_init ********
+ *
+ * Start a new random game
+ *
+ * Parameters:
+ *      Life *l:           game state
+ *      uint16_t bg_color: dead cell color (RGB565)
+ *      uint16_t fg_color: live cell color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      l is not NULL
+ *
+ * Notes:
+ *      Draws nothing; the first life_tick draws every row
+ ************************/
+void life_init(Life *l, uint16_t bg_color, uint16_t fg_color)
+{
+        l->cur = 0;
+        l->seed = 0x2545f491u;
+        l->bg = bg_color;
+        l->fg = fg_color;
+        seed_grid(l);
+
+        rate_start_us = time_us_32();
+        rate_gens = 0;
+}
+
+/********** step_rows ********
+ *
+ * Compute the next generation of a band of rows
+ *
+ * Parameters:
+ *      uint begin, end: rows [begin, end)
+ *      uint part:       which half (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      active set by life_tick
+ *
+ * Notes:
+ *      Reads only the live generation and writes only its
+ *      own rows of the other one, so both halves can run at
+ *      once
+ *      Per cell the neighbours a..h reduce to s2 s1 s0: two
+ *      full adders and a half adder give three partial sums
+ *      and three carries, a third full adder makes the ones
+ *      bit, and the four carries make the twos and fours
+ ************************/
+static void step_rows(uint begin, uint end, uint part)
+{
+        const uint32_t (*src)[LIFE_WORDS] = active->cells[active->cur];
+        uint32_t (*dst)[LIFE_WORDS] = active->cells[active->cur ^ 1];
+
+        (void)part;
+
+        for (uint y = begin; y < end; y++) {
+                const uint32_t *up = src[(y + LIFE_ROWS - 1) % LIFE_ROWS];
+                const uint32_t *mid = src[y];
+                const uint32_t *dn = src[(y + 1) % LIFE_ROWS];
+                uint32_t diff = 0;
+
+                for (uint w = 0; w < LIFE_WORDS; w++) {
+                        uint wl = (w + LIFE_WORDS - 1) % LIFE_WORDS;
+                        uint wr = (w + 1) % LIFE_WORDS;
+
+                        uint32_t a = (up[w] << 1) | (up[wl] >> 31);
+                        uint32_t b = up[w];
+                        uint32_t c = (up[w] >> 1) | (up[wr] << 31);
+                        uint32_t d = (mid[w] << 1) | (mid[wl] >> 31);
+                        uint32_t e = (mid[w] >> 1) | (mid[wr] << 31);
+                        uint32_t f = (dn[w] << 1) | (dn[wl] >> 31);
+                        uint32_t g = dn[w];
+                        uint32_t h = (dn[w] >> 1) | (dn[wr] << 31);
+
+                        uint32_t abx = a ^ b;
+                        uint32_t sa = abx ^ c;
+                        uint32_t ca = (a & b) | (c & abx);
+                        uint32_t dex = d ^ e;
+                        uint32_t sb = dex ^ f;
+                        uint32_t cb = (d & e) | (f & dex);
+                        uint32_t sc = g ^ h;
+                        uint32_t cc = g & h;
+
+                        uint32_t sabx = sa ^ sb;
+                        uint32_t s0 = sabx ^ sc;
+                        uint32_t cd = (sa & sb) | (sc & sabx);
+
+                        uint32_t cabx = ca ^ cb;
+                        uint32_t t = cabx ^ cc;
+                        uint32_t u = (ca & cb) | (cc & cabx);
+                        uint32_t s1 = t ^ cd;
+                        uint32_t s2 = u ^ (t & cd);
+
+                        uint32_t next = s1 & ~s2 & (s0 | mid[w]);
+
+                        dst[y][w] = next;
+                        diff |= next ^ mid[w];
+                }
+                row_changed[y] = diff != 0;
+        }
+}
+
+/********** push_row ********
+ *
+ * Send one grid row as two panel scanlines
+ *
+ * Parameters:
+ *      const Life *l: game state
+ *      int y:         grid row
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= y < LIFE_ROWS
+ *
+ * Notes:
+ *      The line buffers alternate, so the next row can be
+ *      built while the last one is still being sent
+ ************************/
+static void push_row(const Life *l, int y)
+{
+        const uint32_t *row = l->cells[l->cur][y];
+        uint16_t *buf = line[line_next];
+        uint16_t on = swap565(l->fg);
+        uint16_t off = swap565(l->bg);
+
+        line_next ^= 1;
+        for (uint w = 0; w < LIFE_WORDS; w++) {
+                uint32_t bits = row[w];
+                uint16_t *out = buf + w * 64;
+
+                for (uint i = 0; i < 32; i++) {
+                        uint16_t px = (bits & 1) ? on : off;
+
+                        out[2 * i] = px;
+                        out[2 * i + 1] = px;
+                        bits >>= 1;
+                }
+        }
+
+        push_scanline_swapped_xy(0, (uint16_t)(2 * y), buf, 2 * LIFE_COLS);
+        push_scanline_swapped_xy(0, (uint16_t)(2 * y + 1), buf,
+                                 2 * LIFE_COLS);
+        rows_sent++;
+}
+
+/********** life_tick ********
+ *
+ * Advance one generation and draw the rows that changed
+ *
+ * Parameters:
+ *      Life *l: game state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      life_init has been called on l
+ *      Called on the render core
+ *
+ * Notes:
+ *      After a reseed every row is drawn once, before any
+ *      generation is run
+ ************************/
+void life_tick(Life *l)
+{
+        if (l->full) {
+                l->full = false;
+                for (int y = 0; y < LIFE_ROWS; y++) {
+                        push_row(l, y);
+                }
+                return;
+        }
+
+        active = l;
+        split_run(step_rows, LIFE_ROWS);
+        l->cur ^= 1;
+        l->gen++;
+
+        bool any = false;
+        for (int y = 0; y < LIFE_ROWS; y++) {
+                if (row_changed[y]) {
+                        push_row(l, y);
+                        any = true;
+                }
+        }
+
+        gens_taken++;
+        gens_total++;
+        rate_gens++;
+        uint32_t now = time_us_32();
+        if (now - rate_start_us >= LIFE_RATE_US) {
+                gens_per_sec = (uint32_t)((uint64_t)rate_gens * 1000000u /
+                                          (now - rate_start_us));
+                rate_start_us = now;
+                rate_gens = 0;
+        }
+
+        if (any == false || l->gen >= LIFE_RESEED_GENS) {
+                seed_grid(l);
+        }
+}
+
+/********** life_take_generations ********
+ *
+ * Generations computed since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: generation count
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+uint32_t life_take_generations(void)
+{
+        uint32_t n = gens_taken;
+
+        gens_taken = 0;
+        return n;
+}
+
+/********** life_report ********
+ *
+ * Print the generation rate and redraw volume
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      The rate is over the last full second the page ran
+ ************************/
+void life_report(void)
+{
+        printf("LIFE gens=%lu rate=%lu/s rows=%lu\n",
+               (unsigned long)gens_total, (unsigned long)gens_per_sec,
+               (unsigned long)rows_sent);
+}
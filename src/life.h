@@ -0,0 +1,46 @@
+/**************************************************************
+ *
+ *                           life.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for Conway's Game of Life on a bit-packed
+ *     grid, drawn at 2x2 pixels per cell.
+ *
+ **************************************************************/
+
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define LIFE_COLS  160
+#define LIFE_ROWS  120
+#define LIFE_WORDS (LIFE_COLS / 32)
+
+/* changed-row flags and two line buffers */
+#define LIFE_SCRATCH_BYTES (LIFE_ROWS + 2 * 2 * 2 * LIFE_COLS)
+
+/*
+ * Two generations of one bit per cell; bit i of word w in a
+ * row is cell 32w + i. cur selects the live generation. The
+ * grid wraps at every edge.
+ */
+typedef struct {
+        uint32_t cells[2][LIFE_ROWS][LIFE_WORDS];
+        uint cur;
+        uint32_t gen;
+        uint32_t seed;
+        uint16_t bg;
+        uint16_t fg;
+        bool full;
+} Life;
+
+void life_init(Life *l, uint16_t bg_color, uint16_t fg_color);
+void life_tick(Life *l);
+uint32_t life_take_generations(void);
+void life_report(void);
+
+#endif
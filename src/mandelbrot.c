@@ -26,7 +26,9 @@ typedef int32_t fx;
 #define ZOOM_FACTOR      0.985
 
 static uint16_t pal[256];
+static bool pal_ready = false;
 static uint32_t last_zoom_ms = 0;
+static uint32_t iterations = 0;
 
 static inline fx fx_mul(fx a, fx b);
 static inline fx fx_add(fx a, fx b);
@@ -131,14 +133,19 @@ static inline fx fx_from_double(double d)
  * Return: none
  *
  * Expects:
- *      Called once at initialization
+ *      none
  *
  * Notes:
  *      Creates gradient based on iteration count
  *      Index 0 reserved for black (points in set)
+ *      Palette never changes, so later calls return at once
  ************************/
 static void palette_init(void)
 {
+        if (pal_ready) {
+                return;
+        }
+
         for (int i = 0; i < 256; i++) {
                 uint8_t r = (uint8_t)i;
                 uint8_t g = (uint8_t)((i * 5) ^ (i << 1));
@@ -146,6 +153,7 @@ static void palette_init(void)
                 pal[i] = color565(r, g, b);
         }
         pal[0] = color565(0, 0, 0);
+        pal_ready = true;
 }
 
 /********** pixel_to_complex ********
@@ -227,6 +235,7 @@ static inline bool in_cardioid_or_bulb(fx cr, fx ci)
  * Notes:
  *      Returns black for points in set (max iterations)
  *      Uses cardioid/bulb test for quick rejection
+ *      Adds the iterations run to the telemetry count
  *      Iterates z = z^2 + c until |z|^2 > 4 or max_iter
  ************************/
 static inline uint16_t mandel_color(const MandelAnim *m, int x, int y)
@@ -254,6 +263,7 @@ static inline uint16_t mandel_color(const MandelAnim *m, int x, int y)
                 zi = fx_add(two_zr_zi, ci);
                 it++;
         }
+        iterations += it;
 
         if (it == m->max_iter) {
                 return color565(0, 0, 0);
@@ -346,6 +356,26 @@ void mandelbrot_init(MandelAnim *m)
         last_zoom_ms = to_ms_since_boot(get_absolute_time());
 }
 
+/********** mandelbrot_prewarm ********
+ *
+ * Build the palette before the page is entered
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Moves palette work out of the page switch path
+ ************************/
+void mandelbrot_prewarm(void)
+{
+        palette_init();
+}
+
 /********** mandelbrot_tick ********
  *
  * Render batch of scanlines and handle zoom timing
@@ -400,3 +430,26 @@ void mandelbrot_tick(MandelAnim *m, uint16_t lines_per_tick)
                 }
         }
 }
+
+/********** mandelbrot_take_iterations ********
+ *
+ * Escape-time iterations run since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: iteration count
+ *
+ * Expects:
+ *      Called on the core that renders
+ *
+ * Notes:
+ *      Points rejected by the cardioid/bulb test count as zero
+ ************************/
+uint32_t mandelbrot_take_iterations(void)
+{
+        uint32_t n = iterations;
+
+        iterations = 0;
+        return n;
+}
@@ -15,6 +15,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* palette and one scanline buffer */
+#define MANDEL_SCRATCH_BYTES (256 * 2 + 318 * 2)
+
 typedef struct {
         int32_t cx, cy;
         int32_t scale;
@@ -23,6 +26,8 @@ typedef struct {
 } MandelAnim;
 
 void mandelbrot_init(MandelAnim *m);
+void mandelbrot_prewarm(void);
 void mandelbrot_tick(MandelAnim *m, uint16_t lines_per_tick);
+uint32_t mandelbrot_take_iterations(void);
 
 #endif
@@ -0,0 +1,390 @@
+/**************************************************************
+ *
+ *                         monitor.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Frame deadline monitor. The render core reports every
+ *     page update's duration against the page budget and
+ *     whether it ran into the next tick's deadline. It also
+ *     marks when it is busy, i.e. awake and not back in WFE.
+ *
+ *     The control core feeds the hardware watchdog from its
+ *     own loop, but only while the render core has not been
+ *     busy for longer than MONITOR_HANG_US. A stuck DMA wait
+ *     or a runaway page therefore ends in a watchdog reset
+ *     instead of a frozen screen. A hung control core stops
+ *     feeding on its own.
+ *
+ *     The last overrun or hang is kept in watchdog scratch
+ *     registers 0-3, which survive a watchdog reset:
+ *
+ *        scratch[0] - MONITOR_MAGIC | cause << 8 | page
+ *        scratch[1] - update or busy duration (us)
+ *        scratch[2] - page budget (us)
+ *        scratch[3] - ms since boot when recorded
+ *
+ *     Registers 4-7 are left to the SDK's reboot handling.
+ *
+ **************************************************************/
+
+#include "monitor.h"
+#include "page.h"
+#include "sched.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+#include <stdio.h>
+
+#define MONITOR_WATCHDOG_MS 1000
+#define MONITOR_CHECK_US    100000
+#define MONITOR_HANG_US     500000
+
+#define MONITOR_MAGIC      0x4d4e0000u
+#define MONITOR_MAGIC_MASK 0xffff0000u
+
+#define BUDGET_BUCKETS 8
+
+typedef struct {
+        uint32_t ticks;
+        uint32_t misses;
+        uint32_t budget_hist[BUDGET_BUCKETS];
+} MonitorPage;
+
+typedef struct {
+        bool valid;
+        MonitorCause cause;
+        uint8_t page;
+        uint32_t took_us;
+        uint32_t budget_us;
+        uint32_t at_ms;
+} MonitorRecord;
+
+static MonitorPage pages[SCHED_MAX_PAGES];
+
+static volatile bool render_busy = false;
+static volatile uint32_t busy_since_us = 0;
+static volatile uint8_t busy_page = 0;
+
+static absolute_time_t next_check;
+static bool tripped = false;
+
+static bool reset_by_watchdog = false;
+static MonitorRecord boot_record;
+
+static void record_cause(MonitorCause cause, uint page,
+                         uint32_t took_us, uint32_t budget_us);
+static MonitorRecord read_record(void);
+static void print_record(const char *label, const MonitorRecord *r);
+
+/********** record_cause ********
+ *
+ * Store a deadline problem in the watchdog scratch registers
+ *
+ * Parameters:
+ *      MonitorCause cause: what went wrong
+ *      uint page:          page that was running
+ *      uint32_t took_us:   update or busy duration
+ *      uint32_t budget_us: page budget, 0 if none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      scratch[0] is written last so a reset part-way through
+ *      never leaves a valid tag on stale values
+ ************************/
+static void record_cause(MonitorCause cause, uint page,
+                         uint32_t took_us, uint32_t budget_us)
+{
+        watchdog_hw->scratch[0] = 0;
+        watchdog_hw->scratch[1] = took_us;
+        watchdog_hw->scratch[2] = budget_us;
+        watchdog_hw->scratch[3] = to_ms_since_boot(get_absolute_time());
+        watchdog_hw->scratch[0] = MONITOR_MAGIC |
+                                  ((uint32_t)cause << 8) | (page & 0xff);
+}
+
+/********** read_record ********
+ *
+ * Decode the watchdog scratch registers
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: the stored record; valid is false if none is stored
+ *
+ * Expects:
+ *      none
+ ************************/
+static MonitorRecord read_record(void)
+{
+        MonitorRecord r = { 0 };
+        uint32_t tag = watchdog_hw->scratch[0];
+
+        if ((tag & MONITOR_MAGIC_MASK) != MONITOR_MAGIC) {
+                return r;
+        }
+
+        r.valid = true;
+        r.cause = (MonitorCause)((tag >> 8) & 0xff);
+        r.page = (uint8_t)(tag & 0xff);
+        r.took_us = watchdog_hw->scratch[1];
+        r.budget_us = watchdog_hw->scratch[2];
+        r.at_ms = watchdog_hw->scratch[3];
+        return r;
+}
+
+/********** monitor_init ********
+ *
+ * Pick up the previous boot's record and start the watchdog
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on the control core before render_launch
+ *
+ * Notes:
+ *      The scratch registers are cleared after being copied so
+ *      a later power-on reset does not report an old cause
+ *      The watchdog is paused while a debugger halts the chip
+ ************************/
+void monitor_init(void)
+{
+        reset_by_watchdog = watchdog_caused_reboot();
+        boot_record = read_record();
+        watchdog_hw->scratch[0] = 0;
+
+        render_busy = false;
+        tripped = false;
+        next_check = make_timeout_time_us(MONITOR_CHECK_US);
+
+        watchdog_enable(MONITOR_WATCHDOG_MS, true);
+}
+
+/********** monitor_busy_begin ********
+ *
+ * Mark the render core as awake and working
+ *
+ * Parameters:
+ *      uint page: page the render core is working on
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Called at the top of every loop pass, so long page
+ *      entries that yield between slices keep restarting the
+ *      hang timer
+ ************************/
+void monitor_busy_begin(uint page)
+{
+        busy_page = (uint8_t)page;
+        busy_since_us = time_us_32();
+        __dmb();
+        render_busy = true;
+}
+
+/********** monitor_busy_end ********
+ *
+ * Mark the render core as about to sleep
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core before sched_wait
+ ************************/
+void monitor_busy_end(void)
+{
+        render_busy = false;
+}
+
+/********** monitor_tick ********
+ *
+ * Record one page update
+ *
+ * Parameters:
+ *      uint page:          index into page_table
+ *      uint32_t took_us:   time spent in the update
+ *      uint32_t budget_us: page budget, 0 if none
+ *      bool missed:        the next tick was already due when
+ *                          the update returned
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Durations are bucketed in quarters of the budget, with
+ *      the last bucket holding everything from 175% up
+ *      Overruns also replace the record in the scratch
+ *      registers, so the last one survives a reset
+ ************************/
+void monitor_tick(uint page, uint32_t took_us, uint32_t budget_us,
+                  bool missed)
+{
+        if (page >= SCHED_MAX_PAGES) {
+                return;
+        }
+
+        MonitorPage *p = &pages[page];
+
+        p->ticks++;
+        if (missed) {
+                p->misses++;
+        }
+
+        if (budget_us == 0) {
+                return;
+        }
+
+        uint64_t quarters = (uint64_t)took_us * 4 / budget_us;
+        if (quarters >= BUDGET_BUCKETS) {
+                quarters = BUDGET_BUCKETS - 1;
+        }
+        p->budget_hist[quarters]++;
+
+        if (took_us > budget_us) {
+                record_cause(MONITOR_CAUSE_OVERRUN, page, took_us,
+                             budget_us);
+        }
+}
+
+/********** monitor_deadline ********
+ *
+ * Latest time the control core may sleep until
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: time of the next health check
+ *
+ * Expects:
+ *      monitor_init has been called
+ ************************/
+absolute_time_t monitor_deadline(void)
+{
+        return next_check;
+}
+
+/********** monitor_poll ********
+ *
+ * Check render core health and feed the watchdog
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the control core after every wake-up
+ *
+ * Notes:
+ *      Once a hang is seen the watchdog is never fed again,
+ *      even if the render core recovers; a reset is cheaper
+ *      than trusting a core that stalled for half a second
+ ************************/
+void monitor_poll(void)
+{
+        if (tripped) {
+                return;
+        }
+
+        if (render_busy) {
+                __dmb();
+                uint32_t busy_us = time_us_32() - busy_since_us;
+
+                if (busy_us > MONITOR_HANG_US) {
+                        record_cause(MONITOR_CAUSE_HANG, busy_page,
+                                     busy_us, 0);
+                        tripped = true;
+                        return;
+                }
+        }
+
+        watchdog_update();
+
+        if (time_reached(next_check)) {
+                next_check = make_timeout_time_us(MONITOR_CHECK_US);
+        }
+}
+
+/********** print_record ********
+ *
+ * Print one deadline record
+ *
+ * Parameters:
+ *      const char *label:     line prefix
+ *      const MonitorRecord *r: record to print
+ *
+ * Return: none
+ *
+ * Expects:
+ *      r is not NULL
+ ************************/
+static void print_record(const char *label, const MonitorRecord *r)
+{
+        if (!r->valid) {
+                printf("%s none\n", label);
+                return;
+        }
+
+        const char *name = r->page < page_count ?
+                           page_table[r->page]->name : "?";
+
+        printf("%s %s page=%s took=%lu budget=%lu at=%lums\n", label,
+               r->cause == MONITOR_CAUSE_HANG ? "hang" : "overrun",
+               name, (unsigned long)r->took_us,
+               (unsigned long)r->budget_us, (unsigned long)r->at_ms);
+}
+
+/********** monitor_report ********
+ *
+ * Print reset cause and per-page deadline statistics
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      boot= is the record found when this boot started, last=
+ *      the one currently held in the scratch registers
+ *      budget= lists update counts per quarter of the page
+ *      budget: <25% <50% <75% <100% <125% <150% <175% rest
+ ************************/
+void monitor_report(void)
+{
+        MonitorRecord now = read_record();
+
+        printf("WDT reset=%s\n", reset_by_watchdog ? "watchdog" : "power");
+        print_record("WDT boot", &boot_record);
+        print_record("WDT last", &now);
+
+        for (uint i = 0; i < page_count && i < SCHED_MAX_PAGES; i++) {
+                const MonitorPage *p = &pages[i];
+
+                printf("WDT %s ticks=%lu misses=%lu budget=",
+                       page_table[i]->name, (unsigned long)p->ticks,
+                       (unsigned long)p->misses);
+                for (uint b = 0; b < BUDGET_BUCKETS; b++) {
+                        printf("%s%lu", b == 0 ? "" : ",",
+                               (unsigned long)p->budget_hist[b]);
+                }
+                printf("\n");
+        }
+}
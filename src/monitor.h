@@ -0,0 +1,34 @@
+/**************************************************************
+ *
+ *                         monitor.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the frame deadline monitor and hardware
+ *     watchdog.
+ *
+ **************************************************************/
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+typedef enum {
+        MONITOR_CAUSE_NONE,
+        MONITOR_CAUSE_OVERRUN,
+        MONITOR_CAUSE_HANG
+} MonitorCause;
+
+void monitor_init(void);
+void monitor_busy_begin(uint page);
+void monitor_busy_end(void);
+void monitor_tick(uint page, uint32_t took_us, uint32_t budget_us,
+                  bool missed);
+absolute_time_t monitor_deadline(void);
+void monitor_poll(void);
+void monitor_report(void);
+
+#endif
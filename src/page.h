@@ -0,0 +1,63 @@
+/**************************************************************
+ *
+ *                          page.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Page descriptor interface. Each display page describes
+ *     itself with a PageDesc (entry points, update period, time
+ *     budget and memory needs); the render core drives pages
+ *     only through the descriptors in page_table, so adding a
+ *     page does not touch scheduling or input code.
+ *
+ *     enter is a coroutine (see coro.h): it is resumed with a
+ *     deadline for the current slice and should yield once
+ *     the deadline passes, returning CORO_DONE when the page's
+ *     first frame is complete.
+ *
+ *     work, if set, returns the page's own measure of work
+ *     done since it was last called (Mandelbrot iterations,
+ *     ball physics steps) for telemetry.
+ *
+ *     configure, if set, applies a page-specific setting sent
+ *     from the control core (a key the page defines and a
+ *     value, such as the ball count) and returns false if it
+ *     is not accepted; the render core re-enters the page if
+ *     it is showing.
+ *
+ **************************************************************/
+
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "sched.h"
+#include "coro.h"
+
+typedef struct {
+        uint16_t bg;
+        uint16_t fg;
+} PageColors;
+
+typedef struct {
+        const char *name;
+        CoroStatus (*enter)(Coro *co, const PageColors *colors,
+                            absolute_time_t until);
+        void (*update)(uint steps, absolute_time_t until);
+        void (*exit)(void);
+        void (*prewarm)(const PageColors *colors);
+        uint32_t (*work)(void);
+        bool (*configure)(uint key, uint32_t value);
+        uint32_t period_us;
+        TickPolicy policy;
+        uint8_t max_steps;
+        uint32_t budget_us;
+        uint32_t mem_bytes;
+} PageDesc;
+
+extern const PageDesc *const page_table[];
+extern const uint page_count;
+
+#endif
@@ -0,0 +1,936 @@
+/**************************************************************
+ *
+ *                          pages.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Page descriptors for the clock, quote, ball, Mandelbrot,
+ *     sparks, life, plasma, fire and remote displays, and the
+ *     page table the render core iterates. To add a page,
+ *     write its descriptor and append it to page_table; the
+ *     table holds at most SCHED_MAX_PAGES entries, checked at
+ *     compile time. Buttons select the first four entries
+ *     (clock, quote, ball, Mandelbrot) directly; holding A or
+ *     B steps through all of them.
+ *
+ **************************************************************/
+
+#include "page.h"
+#include "../lib/src/graphics/util.h"
+#include "../lib/src/graphics/text.h"
+#include "../lib/src/graphics/shapes.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+#include "mandelbrot.h"
+#include "ball.h"
+#include "circle.h"
+#include "trail.h"
+#include "clock.h"
+#include "quote.h"
+#include "draw.h"
+#include "remote.h"
+#include "particles.h"
+#include "life.h"
+#include "plasma.h"
+#include "fire.h"
+#include "indexed.h"
+
+#define CLOCK_UPDATE_INTERVAL_US 1000000
+#define ANIM_UPDATE_INTERVAL_US  16667
+#define BALL_MAX_CATCH_UP        4
+#define BALL_RADIUS              12
+#define BALLS_RADIUS             6
+
+#define CLOCK_BUDGET_US          8000
+#define QUOTE_BUDGET_US          0
+#define BALL_BUDGET_US           4000
+#define MANDEL_BUDGET_US         12000
+#define MANDEL_MAX_LINES         32
+#define SPARKS_MAX_CATCH_UP      2
+#define SPARKS_BUDGET_US         8000
+#define LIFE_BUDGET_US           12000
+#define PLASMA_BUDGET_US         12000
+#define PLASMA_MAX_LINES         120
+#define FIRE_BUDGET_US           12000
+
+static PageColors page_colors;
+static MandelAnim mandel_state;
+static Bouncer ball_state;
+static Particles sparks_state;
+static uint32_t sparks_steps = 0;
+static Life life_state;
+static Plasma plasma_state;
+static Fire fire_state;
+static bool fire_pending = false;
+static int32_t next_quote = -1;
+static uint32_t ball_steps = 0;
+static uint ball_count = 1;
+static bool ball_trail = false;
+static BallParams ball_params = {
+        .gravity = 0,
+        .restitution = BALLPHYS_ONE,
+        .friction = BALLPHYS_ONE,
+};
+
+static void draw_border_frame(const PageColors *colors);
+static void draw_clock_display(const datetime_t *t, uint16_t txt,
+                                uint16_t bg);
+static CoroStatus page_clock_enter(Coro *co, const PageColors *colors,
+                                   absolute_time_t until);
+static void page_clock_update(uint steps, absolute_time_t until);
+static CoroStatus page_quote_enter(Coro *co, const PageColors *colors,
+                                   absolute_time_t until);
+static void page_quote_prewarm(const PageColors *colors);
+static CoroStatus page_ball_enter(Coro *co, const PageColors *colors,
+                                  absolute_time_t until);
+static void page_ball_update(uint steps, absolute_time_t until);
+static void page_ball_prewarm(const PageColors *colors);
+static uint32_t page_ball_work(void);
+static bool page_ball_configure(uint key, uint32_t value);
+static CoroStatus page_mandelbrot_enter(Coro *co, const PageColors *colors,
+                                        absolute_time_t until);
+static void page_mandelbrot_update(uint steps, absolute_time_t until);
+static void page_mandelbrot_prewarm(const PageColors *colors);
+static CoroStatus page_sparks_enter(Coro *co, const PageColors *colors,
+                                    absolute_time_t until);
+static void page_sparks_update(uint steps, absolute_time_t until);
+static uint32_t page_sparks_work(void);
+static CoroStatus page_life_enter(Coro *co, const PageColors *colors,
+                                  absolute_time_t until);
+static void page_life_update(uint steps, absolute_time_t until);
+static CoroStatus page_plasma_enter(Coro *co, const PageColors *colors,
+                                    absolute_time_t until);
+static void page_plasma_update(uint steps, absolute_time_t until);
+static void page_plasma_prewarm(const PageColors *colors);
+static CoroStatus page_fire_enter(Coro *co, const PageColors *colors,
+                                  absolute_time_t until);
+static void page_fire_update(uint steps, absolute_time_t until);
+static CoroStatus page_remote_enter(Coro *co, const PageColors *colors,
+                                    absolute_time_t until);
+
+/********** draw_clock_display ********
+ *
+ * Render date and time at fixed positions
+ *
+ * Parameters:
+ *      const datetime_t *t: datetime to display
+ *      uint16_t txt:        text color (RGB565)
+ *      uint16_t bg:         background color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      t is not NULL
+ *
+ * Notes:
+ *      Date format: "Day MM/DD/YYYY"
+ *      Time format: "HH:MM:SS"
+ ************************/
+static void draw_clock_display(const datetime_t *t, uint16_t txt, uint16_t bg)
+{
+        static const char *days[] = {
+                "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+        };
+
+        char date_str[20];
+        snprintf(date_str, sizeof(date_str),
+                 "%s %02d/%02d/%04d",
+                 days[t->dotw], t->month, t->day, t->year);
+
+        char time_str[9];
+        snprintf(time_str, sizeof(time_str),
+                 "%02d:%02d:%02d", t->hour, t->min, t->sec);
+
+        draw_text_center_bg(135, 16, txt, bg, date_str);
+        draw_text_center_bg(85, 32, txt, bg, time_str);
+}
+
+/********** draw_border_frame ********
+ *
+ * Draw the rounded page border
+ *
+ * Parameters:
+ *      const PageColors *colors: page colors
+ *
+ * Return: none
+ *
+ * Expects:
+ *      colors is not NULL
+ *      Screen already cleared to colors->bg
+ ************************/
+static void draw_border_frame(const PageColors *colors)
+{
+        draw_rounded_rec(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 4,
+                         colors->fg);
+}
+
+/********** page_clock_enter ********
+ *
+ * Initialize clock display page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the first frame is drawn
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      Clears screen in bands, yielding between slices, then
+ *      displays initial time if available
+ ************************/
+static CoroStatus page_clock_enter(Coro *co, const PageColors *colors,
+                                   absolute_time_t until)
+{
+        datetime_t t;
+
+        CORO_BEGIN(co);
+        page_colors = *colors;
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+        draw_border_frame(colors);
+
+        if (clock_get_local_datetime(&t)) {
+                draw_clock_display(&t, colors->fg, colors->bg);
+        }
+        CORO_END(co);
+}
+
+/********** page_clock_update ********
+ *
+ * Update clock display with current time
+ *
+ * Parameters:
+ *      uint steps:            ticks due (unused)
+ *      absolute_time_t until: budget end (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_clock_enter has been called
+ *
+ * Notes:
+ *      Called once per second to refresh display
+ ************************/
+static void page_clock_update(uint steps, absolute_time_t until)
+{
+        (void)steps;
+        (void)until;
+
+        datetime_t t;
+        if (clock_get_local_datetime(&t)) {
+                draw_clock_display(&t, page_colors.fg, page_colors.bg);
+        }
+}
+
+/********** page_quote_enter ********
+ *
+ * Initialize quote display page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the quote is drawn
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      Displays randomly selected quote from collection
+ *      Uses the quote chosen by prewarm when there is one
+ *      Yields between screen-clear bands; the quote text
+ *      itself is drawn in one call
+ ************************/
+static CoroStatus page_quote_enter(Coro *co, const PageColors *colors,
+                                   absolute_time_t until)
+{
+        CORO_BEGIN(co);
+        page_colors = *colors;
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+        draw_border_frame(colors);
+        CORO_YIELD(co);
+
+        if (next_quote < 0) {
+                page_quote_prewarm(colors);
+        }
+        draw_quote_centered(quotes[next_quote], colors->fg);
+        next_quote = -1;
+        CORO_END(co);
+}
+
+/********** page_quote_prewarm ********
+ *
+ * Pick the next quote ahead of time
+ *
+ * Parameters:
+ *      const PageColors *colors: page colors (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void page_quote_prewarm(const PageColors *colors)
+{
+        (void)colors;
+        next_quote = (int32_t)(get_rand_32() % QUOTE_COUNT);
+}
+
+/********** page_ball_enter ********
+ *
+ * Initialize bouncing ball animation page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the first frame is drawn
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      A single ball starts at center with radius 12,
+ *      velocity 2px/tick; several balls use radius 6
+ *      Clears screen in bands before placing the balls
+ ************************/
+static CoroStatus page_ball_enter(Coro *co, const PageColors *colors,
+                                  absolute_time_t until)
+{
+        CORO_BEGIN(co);
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+
+        bouncer_init(&ball_state, ball_count,
+                     ball_count == 1 ? BALL_RADIUS : BALLS_RADIUS,
+                     &ball_params, colors->bg, colors->fg,
+                     color565(0, 255, 255), ball_trail);
+        CORO_END(co);
+}
+
+/********** page_ball_update ********
+ *
+ * Update ball animation for one frame
+ *
+ * Parameters:
+ *      uint steps:            physics steps to advance
+ *      absolute_time_t until: budget end (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_ball_enter has been called
+ *
+ * Notes:
+ *      Called at ANIM_UPDATE_INTERVAL_US (~60 FPS)
+ *      steps > 1 when the ticker is catching up after a late
+ *      frame, keeping ball speed independent of frame rate
+ ************************/
+static void page_ball_update(uint steps, absolute_time_t until)
+{
+        (void)until;
+        bouncer_tick(&ball_state, (int)steps);
+        ball_steps += steps;
+}
+
+/********** page_ball_prewarm ********
+ *
+ * Precompute circle geometry for the ball radius
+ *
+ * Parameters:
+ *      const PageColors *colors: page colors (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void page_ball_prewarm(const PageColors *colors)
+{
+        (void)colors;
+        bouncer_prewarm(ball_count == 1 ? BALL_RADIUS : BALLS_RADIUS);
+}
+
+/********** page_ball_work ********
+ *
+ * Physics steps run since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: step count
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+static uint32_t page_ball_work(void)
+{
+        uint32_t n = ball_steps;
+
+        ball_steps = 0;
+        return n;
+}
+
+/********** page_ball_configure ********
+ *
+ * Set the number of balls, the physics parameters or trails
+ *
+ * Parameters:
+ *      uint key:       BALL_CFG_COUNT, BALL_CFG_PHYS or
+ *                      BALL_CFG_TRAIL
+ *      uint32_t value: balls, 1 to BOUNCER_MAX; gravity,
+ *                      restitution and friction packed with
+ *                      BALL_PHYS_PACK; or 0/1 for trails
+ *
+ * Return: true if the setting was applied
+ *
+ * Expects:
+ *      Called on the render core, which re-enters the page
+ *      if it is showing
+ *
+ * Notes:
+ *      Re-entering restarts the simulation from its fixed
+ *      starting state, so a setting always gives the same
+ *      trajectory
+ ************************/
+static bool page_ball_configure(uint key, uint32_t value)
+{
+        switch (key) {
+        case BALL_CFG_COUNT:
+                if (value < 1 || value > BOUNCER_MAX) {
+                        return false;
+                }
+                ball_count = value;
+                return true;
+        case BALL_CFG_PHYS:
+                ballphys_params(&ball_params, BALL_PHYS_FIELD(value, 0),
+                                BALL_PHYS_FIELD(value, 1),
+                                BALL_PHYS_FIELD(value, 2));
+                return true;
+        case BALL_CFG_TRAIL:
+                ball_trail = value != 0;
+                return true;
+        default:
+                return false;
+        }
+}
+
+/********** page_mandelbrot_enter ********
+ *
+ * Initialize Mandelbrot fractal animation page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the frame is cleared
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      Starts at interesting zoom location with progressive
+ *      rendering
+ ************************/
+static CoroStatus page_mandelbrot_enter(Coro *co, const PageColors *colors,
+                                        absolute_time_t until)
+{
+        CORO_BEGIN(co);
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+        draw_border_frame(colors);
+
+        mandelbrot_init(&mandel_state);
+        CORO_END(co);
+}
+
+/********** page_mandelbrot_update ********
+ *
+ * Update Mandelbrot animation by rendering scanlines
+ *
+ * Parameters:
+ *      uint steps:            ticks due (unused)
+ *      absolute_time_t until: end of this update's time budget
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_mandelbrot_enter has been called
+ *
+ * Notes:
+ *      Renders scanlines until the budget runs out, at least
+ *      one and at most MANDEL_MAX_LINES per update
+ ************************/
+static void page_mandelbrot_update(uint steps, absolute_time_t until)
+{
+        (void)steps;
+
+        uint lines = 0;
+        do {
+                mandelbrot_tick(&mandel_state, 1);
+                lines++;
+        } while (lines < MANDEL_MAX_LINES && !time_reached(until));
+}
+
+/********** page_mandelbrot_prewarm ********
+ *
+ * Build the Mandelbrot palette ahead of time
+ *
+ * Parameters:
+ *      const PageColors *colors: page colors (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void page_mandelbrot_prewarm(const PageColors *colors)
+{
+        (void)colors;
+        mandelbrot_prewarm();
+}
+
+static const PageDesc page_clock = {
+        .name      = "clock",
+        .enter     = page_clock_enter,
+        .update    = page_clock_update,
+        .period_us = CLOCK_UPDATE_INTERVAL_US,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = CLOCK_BUDGET_US,
+        .mem_bytes = 0,
+};
+
+static const PageDesc page_quote = {
+        .name      = "quote",
+        .enter     = page_quote_enter,
+        .prewarm   = page_quote_prewarm,
+        .period_us = 0,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = QUOTE_BUDGET_US,
+        .mem_bytes = 0,
+};
+
+static const PageDesc page_ball = {
+        .name      = BALL_PAGE_NAME,
+        .enter     = page_ball_enter,
+        .update    = page_ball_update,
+        .prewarm   = page_ball_prewarm,
+        .work      = page_ball_work,
+        .configure = page_ball_configure,
+        .period_us = ANIM_UPDATE_INTERVAL_US,
+        .policy    = TICK_CATCH_UP,
+        .max_steps = BALL_MAX_CATCH_UP,
+        .budget_us = BALL_BUDGET_US,
+        .mem_bytes = sizeof(Bouncer) + BOUNCER_SCRATCH_BYTES +
+                     CIRCLE_SCRATCH_BYTES + TRAIL_SCRATCH_BYTES,
+};
+
+/********** page_sparks_enter ********
+ *
+ * Initialize the fireworks particle page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the screen is cleared
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      The first burst appears on the first update
+ ************************/
+static CoroStatus page_sparks_enter(Coro *co, const PageColors *colors,
+                                    absolute_time_t until)
+{
+        CORO_BEGIN(co);
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+
+        particles_init(&sparks_state, colors->bg, colors->fg);
+        CORO_END(co);
+}
+
+/********** page_sparks_update ********
+ *
+ * Update the particles for one frame
+ *
+ * Parameters:
+ *      uint steps:            physics steps to advance
+ *      absolute_time_t until: budget end (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_sparks_enter has been called
+ *
+ * Notes:
+ *      The physics is shared with the control core; see
+ *      split.c
+ ************************/
+static void page_sparks_update(uint steps, absolute_time_t until)
+{
+        (void)until;
+        particles_tick(&sparks_state, (int)steps);
+        sparks_steps += sparks_state.live * steps;
+}
+
+/********** page_sparks_work ********
+ *
+ * Particle steps run since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: live particles times steps, summed over updates
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+static uint32_t page_sparks_work(void)
+{
+        uint32_t n = sparks_steps;
+
+        sparks_steps = 0;
+        return n;
+}
+
+/********** page_life_enter ********
+ *
+ * Initialize the Game of Life page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the screen is cleared
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      The random starting grid is drawn by the first update
+ ************************/
+static CoroStatus page_life_enter(Coro *co, const PageColors *colors,
+                                  absolute_time_t until)
+{
+        CORO_BEGIN(co);
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+
+        life_init(&life_state, colors->bg, colors->fg);
+        CORO_END(co);
+}
+
+/********** page_life_update ********
+ *
+ * Run one generation
+ *
+ * Parameters:
+ *      uint steps:            ticks due (unused, one generation
+ *                             per update)
+ *      absolute_time_t until: budget end (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_life_enter has been called
+ ************************/
+static void page_life_update(uint steps, absolute_time_t until)
+{
+        (void)steps;
+        (void)until;
+        life_tick(&life_state);
+}
+
+/********** page_plasma_enter ********
+ *
+ * Initialize the plasma page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors (unused)
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the first sample rows are drawn
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      The plasma covers the whole screen, so nothing is
+ *      cleared first; rows are drawn in slices until one
+ *      slice's worth is on screen
+ ************************/
+static CoroStatus page_plasma_enter(Coro *co, const PageColors *colors,
+                                    absolute_time_t until)
+{
+        (void)colors;
+        CORO_BEGIN(co);
+
+        plasma_init(&plasma_state);
+        do {
+                plasma_tick(&plasma_state);
+        } while (!time_reached(until));
+        CORO_END(co);
+}
+
+/********** page_plasma_update ********
+ *
+ * Render plasma rows until the budget runs out
+ *
+ * Parameters:
+ *      uint steps:            ticks due (unused)
+ *      absolute_time_t until: end of this update's time budget
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_plasma_enter has been called
+ *
+ * Notes:
+ *      At least one and at most PLASMA_MAX_LINES sample rows
+ *      (one frame) per update
+ ************************/
+static void page_plasma_update(uint steps, absolute_time_t until)
+{
+        (void)steps;
+
+        uint lines = 0;
+        do {
+                plasma_tick(&plasma_state);
+                lines++;
+        } while (lines < PLASMA_MAX_LINES && !time_reached(until));
+}
+
+/********** page_plasma_prewarm ********
+ *
+ * Build the plasma tables ahead of time
+ *
+ * Parameters:
+ *      const PageColors *colors: page colors (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void page_plasma_prewarm(const PageColors *colors)
+{
+        (void)colors;
+        plasma_prewarm();
+}
+
+/********** page_fire_enter ********
+ *
+ * Initialize the fire page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors (unused)
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the cleared frame is on screen
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Clearing the index buffer marks every row, so the
+ *      first scan-out doubles as the screen clear
+ ************************/
+static CoroStatus page_fire_enter(Coro *co, const PageColors *colors,
+                                  absolute_time_t until)
+{
+        (void)colors;
+        CORO_BEGIN(co);
+
+        fire_init(&fire_state);
+        while (indexed_scanout(until) == false) {
+                CORO_YIELD(co);
+        }
+        fire_pending = false;
+        CORO_END(co);
+}
+
+/********** page_fire_update ********
+ *
+ * Advance the fire and send the rows it changed
+ *
+ * Parameters:
+ *      uint steps:            ticks due (unused)
+ *      absolute_time_t until: end of this update's time budget
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page_fire_enter has been called
+ *
+ * Notes:
+ *      A frame whose scan-out ran out of time is finished
+ *      before the next one is computed, so a frame is never
+ *      half replaced
+ ************************/
+static void page_fire_update(uint steps, absolute_time_t until)
+{
+        (void)steps;
+
+        if (fire_pending == false) {
+                fire_tick(&fire_state);
+        }
+        fire_pending = !indexed_scanout(until);
+}
+
+/********** page_remote_enter ********
+ *
+ * Initialize the remote display page
+ *
+ * Parameters:
+ *      Coro *co:                 enter coroutine state
+ *      const PageColors *colors: page colors
+ *      absolute_time_t until:    end of the current slice
+ *
+ * Return: CORO_DONE once the placeholder is drawn
+ *
+ * Expects:
+ *      colors is not NULL
+ *
+ * Notes:
+ *      Shows a label until the host sends its first RECT;
+ *      the page has no update, so the render core leaves the
+ *      screen to remote.c
+ ************************/
+static CoroStatus page_remote_enter(Coro *co, const PageColors *colors,
+                                    absolute_time_t until)
+{
+        CORO_BEGIN(co);
+
+        draw_fill_begin(colors->bg);
+        while (draw_fill_step(until) == false) {
+                CORO_YIELD(co);
+        }
+        draw_text_center_bg(SCREEN_HEIGHT / 2 - 8, 16, colors->fg,
+                            colors->bg, "USB display");
+        CORO_END(co);
+}
+
+static const PageDesc page_mandelbrot = {
+        .name      = "mandelbrot",
+        .enter     = page_mandelbrot_enter,
+        .update    = page_mandelbrot_update,
+        .prewarm   = page_mandelbrot_prewarm,
+        .work      = mandelbrot_take_iterations,
+        .period_us = ANIM_UPDATE_INTERVAL_US,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = MANDEL_BUDGET_US,
+        .mem_bytes = sizeof(MandelAnim) + MANDEL_SCRATCH_BYTES,
+};
+
+static const PageDesc page_sparks = {
+        .name      = "sparks",
+        .enter     = page_sparks_enter,
+        .update    = page_sparks_update,
+        .work      = page_sparks_work,
+        .period_us = ANIM_UPDATE_INTERVAL_US,
+        .policy    = TICK_CATCH_UP,
+        .max_steps = SPARKS_MAX_CATCH_UP,
+        .budget_us = SPARKS_BUDGET_US,
+        .mem_bytes = sizeof(Particles) + PARTICLE_SCRATCH_BYTES,
+};
+
+static const PageDesc page_life = {
+        .name      = "life",
+        .enter     = page_life_enter,
+        .update    = page_life_update,
+        .work      = life_take_generations,
+        .period_us = ANIM_UPDATE_INTERVAL_US,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = LIFE_BUDGET_US,
+        .mem_bytes = sizeof(Life) + LIFE_SCRATCH_BYTES,
+};
+
+static const PageDesc page_plasma = {
+        .name      = "plasma",
+        .enter     = page_plasma_enter,
+        .update    = page_plasma_update,
+        .prewarm   = page_plasma_prewarm,
+        .work      = plasma_take_pixels,
+        .period_us = ANIM_UPDATE_INTERVAL_US,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = PLASMA_BUDGET_US,
+        .mem_bytes = sizeof(Plasma) + PLASMA_SCRATCH_BYTES,
+};
+
+static const PageDesc page_fire = {
+        .name      = "fire",
+        .enter     = page_fire_enter,
+        .update    = page_fire_update,
+        .work      = indexed_take_rows,
+        .period_us = ANIM_UPDATE_INTERVAL_US,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = FIRE_BUDGET_US,
+        .mem_bytes = sizeof(Fire) + FIRE_SCRATCH_BYTES + INDEXED_BYTES,
+};
+
+static const PageDesc page_remote = {
+        .name      = REMOTE_PAGE_NAME,
+        .enter     = page_remote_enter,
+        .period_us = 0,
+        .policy    = TICK_SKIP,
+        .max_steps = 1,
+        .budget_us = 0,
+        .mem_bytes = REMOTE_POOL_BYTES,
+};
+
+const PageDesc *const page_table[] = {
+        &page_clock,
+        &page_quote,
+        &page_ball,
+        &page_mandelbrot,
+        &page_sparks,
+        &page_life,
+        &page_plasma,
+        &page_fire,
+        &page_remote,
+};
+
+const uint page_count = sizeof(page_table) / sizeof(page_table[0]);
+
+_Static_assert(sizeof(page_table) / sizeof(page_table[0]) <= SCHED_MAX_PAGES,
+               "page_table is larger than SCHED_MAX_PAGES");
@@ -0,0 +1,536 @@
+/**************************************************************
+ *
+ *                         particles.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Fireworks: bursts of up to PARTICLE_MAX single-pixel
+ *     sparks that fall under gravity, slow with drag and fade
+ *     toward the background as they age. Each burst takes the
+ *     next color of the ball page's corner cycle.
+ *
+ *     Particles are stored as structure-of-arrays in fixed
+ *     point. The physics step is split across both cores with
+ *     split_run: the render core updates the first half of the
+ *     arrays while the control core updates the second.
+ *
+ *     Nothing is redrawn that did not change. Each frame's
+ *     plotted pixels are counting-sorted by row into a frame
+ *     list of (color, x) entries, the two halves again filling
+ *     disjoint parts of it in parallel. The previous frame's
+ *     list is exactly the set of pixels to erase, so erasing
+ *     needs no per-particle history and dead particles vanish
+ *     on their own.
+ *
+ *     Rows are then visited top to bottom. A row that appears
+ *     in either list is built once in a row buffer, erased
+ *     pixels as background and new ones in color, and its
+ *     touched pixels are sent as runs, merging gaps of up to
+ *     PARTICLE_MERGE_GAP pixels into one transfer. A bitmap
+ *     per row buffer records which pixels were touched, so
+ *     restoring the buffer to background for its next row
+ *     costs only those pixels.
+ *
+ **************************************************************/
+
+#include "particles.h"
+#include "split.h"
+#include "ball.h"
+#include "../lib/src/ST7789/hardware.h"
+#include "../lib/src/graphics/util.h"
+
+#define PARTICLE_BURST      256
+#define PARTICLE_MERGE_GAP  16
+#define PARTICLE_GRAVITY    6      /* Q8.8 px/step^2 */
+#define PARTICLE_DRAG_SHIFT 6      /* v -= v/64 per step */
+#define PARTICLE_SPEED      640    /* Q8.8, burst radius in px/step */
+#define PARTICLE_AGE        3      /* life lost per step */
+#define PARTICLE_HUES       8
+#define PARTICLE_FADES      16
+#define BURST_GAP_MIN       10
+#define BURST_GAP_RANGE     16
+
+#define ROW_WORDS ((SCREEN_WIDTH + 31) / 32)
+
+static uint16_t fade[PARTICLE_HUES][PARTICLE_FADES];
+
+static uint32_t frame_list[2][PARTICLE_MAX];
+static uint16_t row_start[2][SCREEN_HEIGHT + 1];
+static uint cur_list = 0;
+
+static uint16_t row_count[2][SCREEN_HEIGHT];
+static uint live_count[2];
+static bool counting;
+
+static uint16_t rowbuf[2][SCREEN_WIDTH];
+static uint32_t rowbits[2][ROW_WORDS];
+static uint rowbuf_next = 0;
+
+static Particles *active;
+
+static inline uint16_t swap565(uint16_t c);
+static uint16_t blend565(uint16_t fg, uint16_t bg, uint level);
+static uint32_t next_rand(Particles *p);
+static void spawn_burst(Particles *p);
+static void step_part(uint begin, uint end, uint part);
+static void place_part(uint begin, uint end, uint part);
+static void build_list(void);
+static void send_runs(int y, uint16_t *buf, const uint32_t *bits);
+static void flush_rows(uint16_t bg);
+
+/********** swap565 ********
+ *
+ * Swap byte order of RGB565 color for display transfer
+ *
+ * Parameters:
+ *      uint16_t c: color in RGB565 format
+ *
+ * Return: byte-swapped RGB565 color
+ *
+ * Expects:
+ *      none
+ ************************/
+static inline uint16_t swap565(uint16_t c)
+{
+        return (uint16_t)((c << 8) | (c >> 8));
+}
+
+/********** blend565 ********
+ *
+ * Mix two RGB565 colors
+ *
+ * Parameters:
+ *      uint16_t fg:  color at full level
+ *      uint16_t bg:  color at level 0
+ *      uint level:   0 to PARTICLE_FADES - 1
+ *
+ * Return: blended RGB565 color
+ *
+ * Expects:
+ *      none
+ ************************/
+static uint16_t blend565(uint16_t fg, uint16_t bg, uint level)
+{
+        uint a = level + 1;
+        uint b = PARTICLE_FADES - a;
+        uint r = (((fg >> 11) & 0x1f) * a + ((bg >> 11) & 0x1f) * b) /
+                 PARTICLE_FADES;
+        uint g = (((fg >> 5) & 0x3f) * a + ((bg >> 5) & 0x3f) * b) /
+                 PARTICLE_FADES;
+        uint bl = ((fg & 0x1f) * a + (bg & 0x1f) * b) / PARTICLE_FADES;
+
+        return (uint16_t)((r << 11) | (g << 5) | bl);
+}
+
+/********** next_rand ********
+ *
+ * Advance the particle system's random sequence
+ *
+ * Parameters:
+ *      Particles *p: particle system
+ *
+ * Return: 16 pseudo-random bits
+ *
+ * Expects:
+ *      p is not NULL
+ *
+ * Notes:
+ *      A fixed LCG, so every run of the page is the same
+ ************************/
+static uint32_t next_rand(Particles *p)
+{
+        p->seed = p->seed * 1664525u + 1013904223u;
+        return p->seed >> 16;
+}
+
+/********** particles_init ********
+ *
+ * Reset the particle system
+ *
+ * Parameters:
+ *      Particles *p:         particle system
+ *      uint16_t bg_color:    background color (RGB565)
+ *      uint16_t first_color: first burst's color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ *      Screen already cleared to bg_color
+ *
+ * Notes:
+ *      Builds a fade table per burst color; later bursts
+ *      follow bouncer_next_color from first_color
+ ************************/
+void particles_init(Particles *p, uint16_t bg_color, uint16_t first_color)
+{
+        uint16_t color = first_color;
+        uint16_t bg = swap565(bg_color);
+
+        for (uint h = 0; h < PARTICLE_HUES; h++) {
+                for (uint l = 0; l < PARTICLE_FADES; l++) {
+                        fade[h][l] = swap565(blend565(color, bg_color, l));
+                }
+                color = bouncer_next_color(color);
+        }
+
+        for (uint i = 0; i < PARTICLE_MAX; i++) {
+                p->life[i] = 0;
+        }
+        p->next_slot = 0;
+        p->live = 0;
+        p->seed = 0x9e3779b9u;
+        p->bg = bg_color;
+        p->next_hue = 0;
+        p->burst_wait = 0;
+
+        for (uint k = 0; k < 2; k++) {
+                for (int x = 0; x < SCREEN_WIDTH; x++) {
+                        rowbuf[k][x] = bg;
+                }
+                for (uint w = 0; w < ROW_WORDS; w++) {
+                        rowbits[k][w] = 0;
+                }
+                for (int y = 0; y <= SCREEN_HEIGHT; y++) {
+                        row_start[k][y] = 0;
+                }
+        }
+}
+
+/********** spawn_burst ********
+ *
+ * Start a burst of PARTICLE_BURST sparks
+ *
+ * Parameters:
+ *      Particles *p: particle system
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ *
+ * Notes:
+ *      Slots are reused round-robin, so a full system
+ *      replaces its oldest sparks
+ *      Velocities are uniform over a disc, giving a round
+ *      burst
+ ************************/
+static void spawn_burst(Particles *p)
+{
+        int cx = 40 + (int)(next_rand(p) % (SCREEN_WIDTH - 80));
+        int cy = 30 + (int)(next_rand(p) % (SCREEN_HEIGHT / 2));
+        uint8_t hue = p->next_hue;
+
+        p->next_hue = (uint8_t)((hue + 1) % PARTICLE_HUES);
+
+        for (uint n = 0; n < PARTICLE_BURST; n++) {
+                int32_t vx, vy;
+                uint i = p->next_slot;
+
+                do {
+                        vx = (int32_t)(next_rand(p) % (2 * PARTICLE_SPEED + 1)) -
+                             PARTICLE_SPEED;
+                        vy = (int32_t)(next_rand(p) % (2 * PARTICLE_SPEED + 1)) -
+                             PARTICLE_SPEED;
+                } while (vx * vx + vy * vy > PARTICLE_SPEED * PARTICLE_SPEED);
+
+                p->x[i] = cx << 16;
+                p->y[i] = cy << 16;
+                p->vx[i] = (int16_t)vx;
+                p->vy[i] = (int16_t)vy;
+                p->life[i] = (uint8_t)(192 + next_rand(p) % 64);
+                p->hue[i] = hue;
+                p->next_slot = (i + 1) % PARTICLE_MAX;
+        }
+}
+
+/********** step_part ********
+ *
+ * Advance one half of the particles by a step
+ *
+ * Parameters:
+ *      uint begin, end: particle range
+ *      uint part:       0 or 1, which half
+ *
+ * Return: none
+ *
+ * Expects:
+ *      active set by particles_tick
+ *
+ * Notes:
+ *      On the frame's last step (counting), also counts the
+ *      half's visible particles per row into row_count[part]
+ *      Sparks that leave the sides or bottom die; above the
+ *      top they live on but are not drawn
+ ************************/
+static void step_part(uint begin, uint end, uint part)
+{
+        Particles *p = active;
+        uint16_t *count = row_count[part];
+        uint live = 0;
+
+        if (counting) {
+                for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                        count[y] = 0;
+                }
+        }
+
+        for (uint i = begin; i < end; i++) {
+                if (p->life[i] == 0) {
+                        continue;
+                }
+
+                int32_t vx = p->vx[i];
+                int32_t vy = p->vy[i] + PARTICLE_GRAVITY;
+
+                vx -= vx >> PARTICLE_DRAG_SHIFT;
+                vy -= vy >> PARTICLE_DRAG_SHIFT;
+                p->vx[i] = (int16_t)vx;
+                p->vy[i] = (int16_t)vy;
+                p->x[i] += vx * 256;
+                p->y[i] += vy * 256;
+
+                int x = p->x[i] >> 16;
+                int y = p->y[i] >> 16;
+
+                if (p->life[i] <= PARTICLE_AGE || x < 0 ||
+                    x >= SCREEN_WIDTH || y >= SCREEN_HEIGHT) {
+                        p->life[i] = 0;
+                        continue;
+                }
+                p->life[i] -= PARTICLE_AGE;
+                live++;
+
+                if (counting && y >= 0) {
+                        count[y]++;
+                }
+        }
+        live_count[part] = live;
+}
+
+/********** place_part ********
+ *
+ * Write one half's visible particles into the frame list
+ *
+ * Parameters:
+ *      uint begin, end: particle range
+ *      uint part:       0 or 1, which half
+ *
+ * Return: none
+ *
+ * Expects:
+ *      row_count[part] holds the half's write position for
+ *      each row, set by build_list
+ ************************/
+static void place_part(uint begin, uint end, uint part)
+{
+        const Particles *p = active;
+        uint16_t *pos = row_count[part];
+        uint32_t *list = frame_list[cur_list];
+
+        for (uint i = begin; i < end; i++) {
+                if (p->life[i] == 0) {
+                        continue;
+                }
+
+                int y = p->y[i] >> 16;
+                if (y < 0) {
+                        continue;
+                }
+
+                uint x = (uint)(p->x[i] >> 16);
+                uint16_t c = fade[p->hue[i]][p->life[i] >> 4];
+
+                list[pos[y]++] = ((uint32_t)c << 16) | x;
+        }
+}
+
+/********** build_list ********
+ *
+ * Counting-sort this frame's visible particles by row
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      row_count filled by the last step_part pass
+ *
+ * Notes:
+ *      Turns the two halves' counts into row starts, then
+ *      each half's counts into its own write positions, so
+ *      place_part can run on both cores at once
+ ************************/
+static void build_list(void)
+{
+        uint16_t *start = row_start[cur_list];
+        uint n = 0;
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                uint a = row_count[0][y];
+                uint b = row_count[1][y];
+
+                start[y] = (uint16_t)n;
+                row_count[0][y] = (uint16_t)n;
+                row_count[1][y] = (uint16_t)(n + a);
+                n += a + b;
+        }
+        start[SCREEN_HEIGHT] = (uint16_t)n;
+
+        split_run(place_part, PARTICLE_MAX);
+}
+
+/********** send_runs ********
+ *
+ * Send a row's touched pixels as merged runs
+ *
+ * Parameters:
+ *      int y:                screen row
+ *      uint16_t *buf:        row buffer
+ *      const uint32_t *bits: touched pixels of buf
+ *
+ * Return: none
+ *
+ * Expects:
+ *      At least one bit set
+ *
+ * Notes:
+ *      Untouched pixels inside a run are background in buf
+ *      and on screen, so sending them is harmless
+ ************************/
+static void send_runs(int y, uint16_t *buf, const uint32_t *bits)
+{
+        int x0 = -1;
+        int x1 = -1;
+
+        for (uint w = 0; w < ROW_WORDS; w++) {
+                uint32_t word = bits[w];
+
+                while (word != 0) {
+                        int x = (int)(w * 32) + __builtin_ctz(word);
+
+                        word &= word - 1;
+                        if (x0 >= 0 && x - x1 - 1 > PARTICLE_MERGE_GAP) {
+                                set_address_window((uint16_t)x0, (uint16_t)y,
+                                                   (uint16_t)x1, (uint16_t)y);
+                                start_display_transfer(buf + x0,
+                                                       (size_t)(x1 - x0 + 1));
+                                x0 = -1;
+                        }
+                        if (x0 < 0) {
+                                x0 = x;
+                        }
+                        x1 = x;
+                }
+        }
+
+        set_address_window((uint16_t)x0, (uint16_t)y, (uint16_t)x1,
+                           (uint16_t)y);
+        start_display_transfer(buf + x0, (size_t)(x1 - x0 + 1));
+}
+
+/********** flush_rows ********
+ *
+ * Erase last frame's pixels and draw this frame's
+ *
+ * Parameters:
+ *      uint16_t bg: background color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      build_list has filled frame_list[cur_list]
+ *
+ * Notes:
+ *      The two row buffers alternate between rows that send
+ *      anything; the driver starts a transfer only once the
+ *      previous one has finished, so a buffer is free again
+ *      by the time the row after next is built in it
+ ************************/
+static void flush_rows(uint16_t bg)
+{
+        const uint16_t bg_px = swap565(bg);
+        const uint32_t *old = frame_list[cur_list ^ 1];
+        const uint16_t *old_start = row_start[cur_list ^ 1];
+        const uint32_t *now = frame_list[cur_list];
+        const uint16_t *now_start = row_start[cur_list];
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                uint e0 = old_start[y], e1 = old_start[y + 1];
+                uint d0 = now_start[y], d1 = now_start[y + 1];
+
+                if (e0 == e1 && d0 == d1) {
+                        continue;
+                }
+
+                uint16_t *buf = rowbuf[rowbuf_next];
+                uint32_t *bits = rowbits[rowbuf_next];
+                rowbuf_next ^= 1;
+
+                for (uint w = 0; w < ROW_WORDS; w++) {
+                        uint32_t word = bits[w];
+
+                        while (word != 0) {
+                                buf[w * 32 + (uint)__builtin_ctz(word)] = bg_px;
+                                word &= word - 1;
+                        }
+                        bits[w] = 0;
+                }
+
+                for (uint k = e0; k < e1; k++) {
+                        uint x = old[k] & 0xffff;
+                        bits[x >> 5] |= 1u << (x & 31);
+                }
+                for (uint k = d0; k < d1; k++) {
+                        uint x = now[k] & 0xffff;
+                        buf[x] = (uint16_t)(now[k] >> 16);
+                        bits[x >> 5] |= 1u << (x & 31);
+                }
+
+                send_runs(y, buf, bits);
+        }
+}
+
+/********** particles_tick ********
+ *
+ * Update and draw the particle system for one frame
+ *
+ * Parameters:
+ *      Particles *p: particle system
+ *      int steps:    physics steps to run before drawing (min 1)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      particles_init has been called on p
+ *      Called on the render core
+ *
+ * Notes:
+ *      A new burst starts every BURST_GAP_MIN to
+ *      BURST_GAP_MIN + BURST_GAP_RANGE - 1 frames
+ *      p->live holds the number of sparks after the update
+ ************************/
+void particles_tick(Particles *p, int steps)
+{
+        if (steps < 1) {
+                steps = 1;
+        }
+        if (p->burst_wait == 0) {
+                spawn_burst(p);
+                p->burst_wait = (uint8_t)(BURST_GAP_MIN +
+                                          next_rand(p) % BURST_GAP_RANGE);
+        }
+        p->burst_wait--;
+
+        active = p;
+        for (int s = 0; s < steps; s++) {
+                counting = s == steps - 1;
+                split_run(step_part, PARTICLE_MAX);
+        }
+        p->live = live_count[0] + live_count[1];
+
+        cur_list ^= 1;
+        build_list();
+        flush_rows(p->bg);
+}
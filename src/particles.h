@@ -0,0 +1,49 @@
+/**************************************************************
+ *
+ *                         particles.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the particle system behind the sparks
+ *     page: fireworks bursts of single-pixel particles.
+ *
+ **************************************************************/
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdint.h>
+#include "pico/types.h"
+
+#define PARTICLE_MAX 2048
+
+/* frame lists, row starts and counts, row buffers, fade table */
+#define PARTICLE_SCRATCH_BYTES (2 * PARTICLE_MAX * 4 + 2 * 2 * 241 + \
+                                2 * 2 * 240 + 2 * 2 * 320 + 2 * 40 + \
+                                8 * 16 * 2)
+
+/*
+ * Particles as structure-of-arrays. x and y are Q16.16
+ * pixels, vx and vy Q8.8 pixels per step; life counts down
+ * to 0, which marks a free slot. hue picks the burst color.
+ */
+typedef struct {
+        int32_t x[PARTICLE_MAX];
+        int32_t y[PARTICLE_MAX];
+        int16_t vx[PARTICLE_MAX];
+        int16_t vy[PARTICLE_MAX];
+        uint8_t life[PARTICLE_MAX];
+        uint8_t hue[PARTICLE_MAX];
+        uint next_slot;
+        uint live;
+        uint32_t seed;
+        uint16_t bg;
+        uint8_t next_hue;
+        uint8_t burst_wait;
+} Particles;
+
+void particles_init(Particles *p, uint16_t bg_color,
+                    uint16_t first_color);
+void particles_tick(Particles *p, int steps);
+
+#endif
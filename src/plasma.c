@@ -0,0 +1,324 @@
+/**************************************************************
+ *
+ *                          plasma.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Demoscene plasma. Each sample is the sum of three
+ *     sines, one along x, one along a diagonal and one along
+ *     y, looked up in a 256-entry table and mapped through a
+ *     256-color palette whose offset rotates every frame.
+ *
+ *     The two per-pixel phases are stepped by the RP2040
+ *     interpolators: each has its phase in ACCUM0 with the
+ *     step in BASE0 added raw on every pop, and its shift and
+ *     mask turn the phase into a byte index that BASE2 (the
+ *     sine table) turns into an address. One pop of the full
+ *     result per interpolator gives both table addresses and
+ *     advances both phases. The y term is constant per row.
+ *
+ *     Samples are 2x2 pixels: each sample row is expanded
+ *     into a 320-pixel line and pushed twice through
+ *     push_scanline_swapped_xy, alternating between two line
+ *     buffers so one is built while the other is sent.
+ *
+ *     The page doubles as a display stack benchmark: plasma
+ *     arithmetic is cheap and fixed, so the time spent in
+ *     building lines against the time spent pushing them
+ *     shows how close the SPI link is to saturated.
+ *
+ **************************************************************/
+
+#include "plasma.h"
+#include "pico/stdlib.h"
+#include "hardware/interp.h"
+#include "../lib/src/graphics/util.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define PLASMA_COLS 160
+#define PLASMA_ROWS 120
+
+/* phases are Q8.8 table positions */
+#define PHASE_SHIFT 8
+#define STEP_X      (3 * 256)
+#define STEP_DIAG_X (2 * 256 + 128)
+#define STEP_DIAG_Y (1 * 256 + 192)
+#define STEP_Y      (4 * 256)
+#define SPEED_X     (3 * 256)
+#define SPEED_DIAG  (5 * 256)
+#define SPEED_Y     (2 * 256)
+#define PALETTE_SPEED 2
+
+#define PLASMA_RATE_US 1000000
+
+static uint8_t sine[256];
+static uint16_t pal[256];
+static bool tables_ready = false;
+
+static uint16_t line[2][2 * PLASMA_COLS];
+static uint line_next = 0;
+
+static uint32_t pixels_taken = 0;
+static uint32_t rate_start_us;
+static uint32_t rate_frames = 0;
+static uint32_t rate_pixels = 0;
+static uint32_t rate_build_us = 0;
+static uint32_t rate_push_us = 0;
+static volatile uint32_t frames_per_sec = 0;
+static volatile uint32_t pixels_per_sec = 0;
+static volatile uint32_t build_pct = 0;
+static volatile uint32_t push_pct = 0;
+
+static void tables_init(void);
+static void interp_setup(void);
+
+/********** tables_init ********
+ *
+ * Build the sine table and the palette
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Sine values are 0 to 84, so three of them sum to at
+ *      most 252
+ *      The palette is three phase-shifted sine ramps, so it
+ *      wraps smoothly as its offset rotates; it is stored
+ *      byte-swapped for the panel
+ *      Tables never change, so later calls return at once
+ ************************/
+static void tables_init(void)
+{
+        if (tables_ready) {
+                return;
+        }
+
+        for (int i = 0; i < 256; i++) {
+                double s = sin((double)i * (2.0 * M_PI / 256.0));
+
+                sine[i] = (uint8_t)(42.0 + 42.0 * s + 0.5);
+        }
+        for (int i = 0; i < 256; i++) {
+                double a = (double)i * (2.0 * M_PI / 256.0);
+                uint8_t r = (uint8_t)(128.0 + 127.0 * sin(a));
+                uint8_t g = (uint8_t)(128.0 + 127.0 * sin(a + M_PI * 2 / 3));
+                uint8_t b = (uint8_t)(128.0 + 127.0 * sin(a + M_PI * 4 / 3));
+                uint16_t c = color565(r, g, b);
+
+                pal[i] = (uint16_t)((c << 8) | (c >> 8));
+        }
+        tables_ready = true;
+}
+
+/********** interp_setup ********
+ *
+ * Configure both interpolators as sine table steppers
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the core that renders, since each core has
+ *      its own interpolators
+ *
+ * Notes:
+ *      Lane 0 adds BASE0 to the raw phase on every pop and
+ *      feeds bits PHASE_SHIFT..PHASE_SHIFT + 7 of it into the
+ *      full result; lane 1 stays at 0
+ *      Leaves ACCUM0 of each interpolator to the caller
+ ************************/
+static void interp_setup(void)
+{
+        interp_config cfg = interp_default_config();
+
+        interp_config_set_add_raw(&cfg, true);
+        interp_config_set_shift(&cfg, PHASE_SHIFT);
+        interp_config_set_mask(&cfg, 0, 7);
+        interp_set_config(interp0, 0, &cfg);
+        interp_set_config(interp1, 0, &cfg);
+
+        cfg = interp_default_config();
+        interp_set_config(interp0, 1, &cfg);
+        interp_set_config(interp1, 1, &cfg);
+
+        interp0->accum[1] = 0;
+        interp0->base[1] = 0;
+        interp0->base[2] = (uintptr_t)sine;
+        interp0->base[0] = STEP_X;
+        interp1->accum[1] = 0;
+        interp1->base[1] = 0;
+        interp1->base[2] = (uintptr_t)sine;
+        interp1->base[0] = STEP_DIAG_X;
+}
+
+/********** plasma_init ********
+ *
+ * Start the plasma from its first frame
+ *
+ * Parameters:
+ *      Plasma *p: plasma state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ ************************/
+void plasma_init(Plasma *p)
+{
+        tables_init();
+        p->t = 0;
+        p->y_next = 0;
+
+        rate_start_us = time_us_32();
+        rate_frames = 0;
+        rate_pixels = 0;
+        rate_build_us = 0;
+        rate_push_us = 0;
+}
+
+/********** plasma_prewarm ********
+ *
+ * Build the tables before the page is entered
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+void plasma_prewarm(void)
+{
+        tables_init();
+}
+
+/********** plasma_tick ********
+ *
+ * Render and send one sample row
+ *
+ * Parameters:
+ *      Plasma *p: plasma state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      plasma_init has been called on p
+ *      Called on the render core
+ *
+ * Notes:
+ *      The interpolators are configured afresh for every row,
+ *      so other render core code may use them in between
+ *      Advances t after the last row of a frame
+ ************************/
+void plasma_tick(Plasma *p)
+{
+        uint32_t t0 = time_us_32();
+        int y = p->y_next;
+        uint32_t t = p->t;
+        uint16_t *buf = line[line_next];
+        uint8_t row = sine[(((uint32_t)y * STEP_Y + t * SPEED_Y) >>
+                            PHASE_SHIFT) & 0xff];
+        uint8_t shift = (uint8_t)(t * PALETTE_SPEED);
+
+        line_next ^= 1;
+
+        interp_setup();
+        interp0->accum[0] = t * SPEED_X;
+        interp1->accum[0] = (uint32_t)y * STEP_DIAG_Y + t * SPEED_DIAG;
+
+        for (int x = 0; x < PLASMA_COLS; x++) {
+                const uint8_t *a = (const uint8_t *)(uintptr_t)interp0->pop[2];
+                const uint8_t *b = (const uint8_t *)(uintptr_t)interp1->pop[2];
+                uint16_t px = pal[(uint8_t)(*a + *b + row + shift)];
+
+                buf[2 * x] = px;
+                buf[2 * x + 1] = px;
+        }
+
+        uint32_t t1 = time_us_32();
+        push_scanline_swapped_xy(0, (uint16_t)(2 * y), buf, 2 * PLASMA_COLS);
+        push_scanline_swapped_xy(0, (uint16_t)(2 * y + 1), buf,
+                                 2 * PLASMA_COLS);
+        uint32_t t2 = time_us_32();
+
+        pixels_taken += 4 * PLASMA_COLS;
+        rate_pixels += 4 * PLASMA_COLS;
+        rate_build_us += t1 - t0;
+        rate_push_us += t2 - t1;
+
+        if (++p->y_next >= PLASMA_ROWS) {
+                p->y_next = 0;
+                p->t++;
+                rate_frames++;
+        }
+
+        uint32_t span = t2 - rate_start_us;
+        if (span >= PLASMA_RATE_US) {
+                frames_per_sec = (uint32_t)((uint64_t)rate_frames * 1000000u /
+                                            span);
+                pixels_per_sec = (uint32_t)((uint64_t)rate_pixels * 1000000u /
+                                            span);
+                build_pct = (uint32_t)((uint64_t)rate_build_us * 100u / span);
+                push_pct = (uint32_t)((uint64_t)rate_push_us * 100u / span);
+                rate_start_us = t2;
+                rate_frames = 0;
+                rate_pixels = 0;
+                rate_build_us = 0;
+                rate_push_us = 0;
+        }
+}
+
+/********** plasma_take_pixels ********
+ *
+ * Pixels sent since the last call
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: pixel count
+ *
+ * Expects:
+ *      Called on the render core
+ ************************/
+uint32_t plasma_take_pixels(void)
+{
+        uint32_t n = pixels_taken;
+
+        pixels_taken = 0;
+        return n;
+}
+
+/********** plasma_report ********
+ *
+ * Print the plasma frame rate, fill rate and time split
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      Figures are over the last full second the page ran;
+ *      build and push are percentages of wall time, the rest
+ *      is time between updates
+ ************************/
+void plasma_report(void)
+{
+        printf("PLASMA fps=%lu fill=%lukpx/s build=%lu%% push=%lu%%\n",
+               (unsigned long)frames_per_sec,
+               (unsigned long)(pixels_per_sec / 1000),
+               (unsigned long)build_pct, (unsigned long)push_pct);
+}
@@ -0,0 +1,36 @@
+/**************************************************************
+ *
+ *                          plasma.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the plasma page: a classic demoscene
+ *     plasma from sine and palette tables, drawn at 2x2.
+ *
+ **************************************************************/
+
+#ifndef PLASMA_H
+#define PLASMA_H
+
+#include <stdint.h>
+#include "pico/types.h"
+
+/* sine table, palette and two line buffers */
+#define PLASMA_SCRATCH_BYTES (256 + 256 * 2 + 2 * 320 * 2)
+
+/*
+ * t advances once per finished frame and drives every phase
+ * and the palette rotation; y_next is the next sample row.
+ */
+typedef struct {
+        uint32_t t;
+        uint16_t y_next;
+} Plasma;
+
+void plasma_init(Plasma *p);
+void plasma_prewarm(void);
+void plasma_tick(Plasma *p);
+uint32_t plasma_take_pixels(void);
+void plasma_report(void);
+
+#endif
@@ -0,0 +1,574 @@
+/**************************************************************
+ *
+ *                          power.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Inactivity power policy. With no button or USB input the
+ *     widget steps through three states:
+ *
+ *        active - backlight full, pages update normally
+ *        dim    - after POWER_DIM_MS, backlight dimmed
+ *        sleep  - after POWER_SLEEP_MS, backlight off, panel in
+ *                 SLPIN and the render core stops updating
+ *
+ *     In sleep both cores set SLEEPDEEP, so when both are in
+ *     WFE the chip gates every clock not listed in
+ *     SLEEP_CLOCKS_EN0/1. The timer, GPIO and USB clocks stay
+ *     on: buttons, USB input and scheduler alarms still wake
+ *     the chip and the timer keeps time.
+ *
+ *     Dormant mode (POWER_DORMANT) stops the crystal and PLLs
+ *     as well and only a button edge wakes the chip. It is off
+ *     by default: USB drops off the bus and the timer stops
+ *     while dormant, so the clock is marked unset on wake and
+ *     needs a new T or sync afterwards. There is no timed
+ *     wake: the RTC would need a clock that runs while the
+ *     crystal is stopped, and the board has none.
+ *
+ *     The panel keeps its frame memory while asleep, so waking
+ *     only needs SLPOUT, one page update and the backlight.
+ *     The time from the waking input to that frame is
+ *     reported as the wake latency.
+ *
+ **************************************************************/
+
+#include "power.h"
+#include "render.h"
+#include "clock.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "hardware/spi.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/scb.h"
+#include <stdio.h>
+
+#ifndef POWER_DORMANT
+#define POWER_DORMANT 0
+#endif
+
+#if POWER_DORMANT
+#include "hardware/xosc.h"
+#include "hardware/pll.h"
+#endif
+
+#define POWER_DIM_MS   30000
+#define POWER_SLEEP_MS 120000
+
+/* Pico Display Pack wiring used by the ST7789 driver */
+#define PANEL_SPI     spi0
+#define PANEL_DC_PIN  16
+#define PANEL_CS_PIN  17
+#define PANEL_BL_PIN  20
+
+#define ST7789_SLPIN  0x10
+#define ST7789_SLPOUT 0x11
+
+/* ST7789 needs 5 ms after SLPIN/SLPOUT before the next command */
+#define PANEL_SLEEP_DELAY_US 5000
+
+#define BL_WRAP 255
+#define BL_FULL 255
+#define BL_DIM  40
+
+/*
+ * Rough supply current per state in tenths of a mA for a Pico
+ * and Display Pack on USB; measure and adjust for real figures
+ */
+#define POWER_MA10_ACTIVE 450
+#define POWER_MA10_DIM    300
+#define POWER_MA10_SLEEP  110
+
+#define SLEEP_CLOCKS_EN0 (CLOCKS_SLEEP_EN0_CLK_SYS_BUSCTRL_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_BUSFABRIC_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_CLOCKS_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_PLL_SYS_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_PLL_USB_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_RESETS_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_SIO_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_SRAM0_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_SRAM1_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_SRAM2_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_SRAM3_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_PROC0_BITS | \
+                          CLOCKS_SLEEP_EN0_CLK_SYS_PROC1_BITS)
+
+#define SLEEP_CLOCKS_EN1 (CLOCKS_SLEEP_EN1_CLK_SYS_SRAM4_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_SYS_SRAM5_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_SYS_TIMER_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_SYS_USBCTRL_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_USB_USBCTRL_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_SYS_WATCHDOG_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_SYS_XIP_BITS | \
+                          CLOCKS_SLEEP_EN1_CLK_SYS_XOSC_BITS)
+
+typedef struct {
+        uint32_t count;
+        uint32_t last_us;
+        uint32_t max_us;
+        uint64_t sum_us;
+        uint32_t panel_us;
+} WakeStats;
+
+static const char *const state_names[POWER_STATES] = {
+        "active", "dim", "sleep"
+};
+
+static const uint16_t state_ma10[POWER_STATES] = {
+        POWER_MA10_ACTIVE, POWER_MA10_DIM, POWER_MA10_SLEEP
+};
+
+static PowerState state = POWER_ACTIVE;
+static absolute_time_t last_activity;
+static absolute_time_t state_since;
+static uint64_t state_us[POWER_STATES];
+static uint32_t saved_sleep_en0;
+static uint32_t saved_sleep_en1;
+
+static const uint *wake_pins;
+static uint wake_pin_count;
+
+static volatile bool panel_asleep = false;
+static uint32_t panel_wake_start_us;
+static WakeStats wakes;
+
+static void set_state(PowerState next, uint32_t edge_us);
+static void set_deep_sleep(bool on);
+static void panel_command(uint8_t cmd);
+#if POWER_DORMANT
+static void enter_dormant(void);
+#endif
+
+/********** set_deep_sleep ********
+ *
+ * Choose whether WFE on the calling core counts as deep sleep
+ *
+ * Parameters:
+ *      bool on: true to set SLEEPDEEP
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      SCB is per core, so each core sets its own bit
+ *      Clocks are only gated while both cores are asleep
+ ************************/
+static void set_deep_sleep(bool on)
+{
+        if (on) {
+                scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+        } else {
+                scb_hw->scr &= ~M0PLUS_SCR_SLEEPDEEP_BITS;
+        }
+}
+
+/********** set_state ********
+ *
+ * Move to a new power state and tell the render core
+ *
+ * Parameters:
+ *      PowerState next:  state to enter
+ *      uint32_t edge_us: time_us_32 of the waking input, or 0
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the control core
+ *
+ * Notes:
+ *      Sleep-mode clock gating is configured only while in
+ *      POWER_SLEEP; the normal sleep enables are restored on
+ *      the way out
+ ************************/
+static void set_state(PowerState next, uint32_t edge_us)
+{
+        absolute_time_t now = get_absolute_time();
+
+        state_us[state] += (uint64_t)absolute_time_diff_us(state_since, now);
+        state_since = now;
+
+        if (next == POWER_SLEEP && state != POWER_SLEEP) {
+                saved_sleep_en0 = clocks_hw->sleep_en0;
+                saved_sleep_en1 = clocks_hw->sleep_en1;
+                clocks_hw->sleep_en0 = SLEEP_CLOCKS_EN0;
+                clocks_hw->sleep_en1 = SLEEP_CLOCKS_EN1;
+                set_deep_sleep(true);
+        } else if (next != POWER_SLEEP && state == POWER_SLEEP) {
+                set_deep_sleep(false);
+                clocks_hw->sleep_en0 = saved_sleep_en0;
+                clocks_hw->sleep_en1 = saved_sleep_en1;
+        }
+
+        state = next;
+        render_set_power(next, edge_us);
+}
+
+/********** power_init ********
+ *
+ * Start the inactivity timers
+ *
+ * Parameters:
+ *      const uint *pins: button pins (active low)
+ *      uint count:       number of pins
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on the control core
+ *      pins stays valid for the program's lifetime
+ *
+ * Notes:
+ *      The pins are only used as dormant wake sources; in
+ *      normal sleep the input module's edge IRQs wake the chip
+ ************************/
+void power_init(const uint *pins, uint count)
+{
+        wake_pins = pins;
+        wake_pin_count = count;
+
+        state = POWER_ACTIVE;
+        last_activity = get_absolute_time();
+        state_since = last_activity;
+}
+
+/********** power_activity ********
+ *
+ * Note user input and wake the display if needed
+ *
+ * Parameters:
+ *      uint32_t edge_us: time_us_32 of the input
+ *
+ * Return: true if the display was asleep, so the caller can
+ *         swallow the input that woke it
+ *
+ * Expects:
+ *      power_init has been called
+ ************************/
+bool power_activity(uint32_t edge_us)
+{
+        PowerState old = state;
+
+        last_activity = get_absolute_time();
+        if (old != POWER_ACTIVE) {
+                set_state(POWER_ACTIVE, edge_us);
+        }
+        return old == POWER_SLEEP;
+}
+
+/********** power_deadline ********
+ *
+ * Time of the next inactivity transition
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: deadline, or at_the_end_of_time while asleep
+ *
+ * Expects:
+ *      power_init has been called
+ ************************/
+absolute_time_t power_deadline(void)
+{
+        switch (state) {
+        case POWER_ACTIVE:
+                return delayed_by_ms(last_activity, POWER_DIM_MS);
+        case POWER_DIM:
+                return delayed_by_ms(last_activity, POWER_SLEEP_MS);
+        default:
+                return at_the_end_of_time;
+        }
+}
+
+/********** power_poll ********
+ *
+ * Apply the inactivity timeouts
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the control core after every wake-up
+ *
+ * Notes:
+ *      With POWER_DORMANT, goes dormant once the render core
+ *      has put the panel to sleep, and treats the return as
+ *      a wake-up input
+ ************************/
+void power_poll(void)
+{
+        if (state != POWER_SLEEP && time_reached(power_deadline())) {
+                set_state(state == POWER_ACTIVE ? POWER_DIM : POWER_SLEEP,
+                          0);
+        }
+
+#if POWER_DORMANT
+        if (state == POWER_SLEEP && panel_asleep) {
+                enter_dormant();
+                power_activity(time_us_32());
+        }
+#endif
+}
+
+#if POWER_DORMANT
+/********** enter_dormant ********
+ *
+ * Stop all clocks until a button is pressed
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none (after wake-up)
+ *
+ * Expects:
+ *      Called on the control core with the render core idle
+ *      in WFE
+ *
+ * Notes:
+ *      Runs the system from the crystal and stops the PLLs
+ *      before the crystal itself goes dormant; clocks_init
+ *      brings the normal clock tree back afterwards
+ *      The timer does not advance while dormant, so the
+ *      clock is marked unset on wake
+ ************************/
+static void enter_dormant(void)
+{
+        for (uint i = 0; i < wake_pin_count; i++) {
+                gpio_set_dormant_irq_enabled(wake_pins[i],
+                                             GPIO_IRQ_EDGE_FALL, true);
+        }
+
+        clock_configure(clk_ref, CLOCKS_CLK_REF_CTRL_SRC_VALUE_XOSC_CLKSRC,
+                        0, XOSC_KHZ * KHZ, XOSC_KHZ * KHZ);
+        clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF,
+                        0, XOSC_KHZ * KHZ, XOSC_KHZ * KHZ);
+        clock_stop(clk_usb);
+        clock_stop(clk_adc);
+        clock_stop(clk_rtc);
+        pll_deinit(pll_sys);
+        pll_deinit(pll_usb);
+
+        xosc_dormant();
+
+        for (uint i = 0; i < wake_pin_count; i++) {
+                gpio_acknowledge_irq(wake_pins[i], GPIO_IRQ_EDGE_FALL);
+                gpio_set_dormant_irq_enabled(wake_pins[i],
+                                             GPIO_IRQ_EDGE_FALL, false);
+        }
+
+        clocks_init();
+        clock_invalidate();
+}
+#endif
+
+/********** power_report ********
+ *
+ * Print power state, time per state and wake latency
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      avg= is the time-weighted mean of the POWER_MA10_*
+ *      estimates, not a measurement
+ *      wake= latency runs from the waking input to the end of
+ *      the first frame; panel= is the SLPOUT part of the last
+ ************************/
+void power_report(void)
+{
+        absolute_time_t now = get_absolute_time();
+        uint64_t total_us = 0;
+        uint64_t charge = 0;
+
+        printf("PWR state=%s dim_after=%ums sleep_after=%ums\n",
+               state_names[state], POWER_DIM_MS, POWER_SLEEP_MS);
+
+        for (uint i = 0; i < POWER_STATES; i++) {
+                uint64_t us = state_us[i];
+                if (i == (uint)state) {
+                        us += (uint64_t)absolute_time_diff_us(state_since,
+                                                              now);
+                }
+                total_us += us;
+                charge += us * state_ma10[i];
+                printf("PWR %s %llus\n", state_names[i],
+                       (unsigned long long)(us / 1000000));
+        }
+
+        uint32_t avg10 = total_us ? (uint32_t)(charge / total_us) : 0;
+        printf("PWR avg=%lu.%lumA (est)\n", (unsigned long)(avg10 / 10),
+               (unsigned long)(avg10 % 10));
+
+        uint32_t mean = wakes.count ?
+                        (uint32_t)(wakes.sum_us / wakes.count) : 0;
+        printf("PWR wakes=%lu last=%lu avg=%lu max=%lu panel=%lu\n",
+               (unsigned long)wakes.count, (unsigned long)wakes.last_us,
+               (unsigned long)mean, (unsigned long)wakes.max_us,
+               (unsigned long)wakes.panel_us);
+}
+
+/********** power_backlight_init ********
+ *
+ * Take over the backlight pin with PWM at full brightness
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core after the display driver's
+ *      pin setup
+ ************************/
+void power_backlight_init(void)
+{
+        uint slice = pwm_gpio_to_slice_num(PANEL_BL_PIN);
+
+        gpio_set_function(PANEL_BL_PIN, GPIO_FUNC_PWM);
+        pwm_set_wrap(slice, BL_WRAP);
+        pwm_set_gpio_level(PANEL_BL_PIN, BL_FULL);
+        pwm_set_enabled(slice, true);
+}
+
+/********** power_backlight ********
+ *
+ * Set the backlight for a power state
+ *
+ * Parameters:
+ *      PowerState s: state to show
+ *
+ * Return: none
+ *
+ * Expects:
+ *      power_backlight_init has been called
+ ************************/
+void power_backlight(PowerState s)
+{
+        uint16_t level = BL_FULL;
+
+        if (s == POWER_DIM) {
+                level = BL_DIM;
+        } else if (s == POWER_SLEEP) {
+                level = 0;
+        }
+        pwm_set_gpio_level(PANEL_BL_PIN, level);
+}
+
+/********** panel_command ********
+ *
+ * Send a single-byte command to the panel
+ *
+ * Parameters:
+ *      uint8_t cmd: ST7789 command
+ *
+ * Return: none
+ *
+ * Expects:
+ *      No display DMA in flight
+ *
+ * Notes:
+ *      Restores the driver's DC and CS levels afterwards
+ ************************/
+static void panel_command(uint8_t cmd)
+{
+        bool dc = gpio_get_out_level(PANEL_DC_PIN);
+        bool cs = gpio_get_out_level(PANEL_CS_PIN);
+
+        gpio_put(PANEL_CS_PIN, 0);
+        gpio_put(PANEL_DC_PIN, 0);
+        spi_write_blocking(PANEL_SPI, &cmd, 1);
+        gpio_put(PANEL_DC_PIN, dc);
+        gpio_put(PANEL_CS_PIN, cs);
+}
+
+/********** power_panel_sleep ********
+ *
+ * Turn off the backlight and put the panel to sleep
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core with display DMA drained
+ ************************/
+void power_panel_sleep(void)
+{
+        power_backlight(POWER_SLEEP);
+        panel_command(ST7789_SLPIN);
+        sleep_us(PANEL_SLEEP_DELAY_US);
+
+        panel_asleep = true;
+        set_deep_sleep(true);
+}
+
+/********** power_panel_wake ********
+ *
+ * Take the panel out of sleep, leaving the backlight off
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core after power_panel_sleep
+ *
+ * Notes:
+ *      The caller draws a frame and then sets the backlight,
+ *      so the stale frame is never lit
+ ************************/
+void power_panel_wake(void)
+{
+        panel_wake_start_us = time_us_32();
+        set_deep_sleep(false);
+        panel_asleep = false;
+
+        panel_command(ST7789_SLPOUT);
+        sleep_us(PANEL_SLEEP_DELAY_US);
+        wakes.panel_us = time_us_32() - panel_wake_start_us;
+}
+
+/********** power_wake_done ********
+ *
+ * Record the end of the first frame after a wake-up
+ *
+ * Parameters:
+ *      uint32_t edge_us: time_us_32 of the waking input
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core with display DMA drained
+ *
+ * Notes:
+ *      Wake-ups without an input time are not counted
+ ************************/
+void power_wake_done(uint32_t edge_us)
+{
+        if (edge_us == 0) {
+                return;
+        }
+
+        uint32_t us = time_us_32() - edge_us;
+
+        wakes.count++;
+        wakes.last_us = us;
+        wakes.sum_us += us;
+        if (us > wakes.max_us) {
+                wakes.max_us = us;
+        }
+}
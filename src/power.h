@@ -0,0 +1,41 @@
+/**************************************************************
+ *
+ *                          power.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the inactivity power policy. The control
+ *     core decides when to dim and sleep; the render core
+ *     drives the backlight and panel.
+ *
+ **************************************************************/
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+typedef enum {
+        POWER_ACTIVE,
+        POWER_DIM,
+        POWER_SLEEP,
+        POWER_STATES
+} PowerState;
+
+/* control core */
+void power_init(const uint *wake_pins, uint count);
+bool power_activity(uint32_t edge_us);
+absolute_time_t power_deadline(void);
+void power_poll(void);
+void power_report(void);
+
+/* render core */
+void power_backlight_init(void);
+void power_backlight(PowerState state);
+void power_panel_sleep(void);
+void power_panel_wake(void);
+void power_wake_done(uint32_t edge_us);
+
+#endif
@@ -0,0 +1,340 @@
+/**************************************************************
+ *
+ *                          remote.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Remote display mode. With the remote page selected, the
+ *     host sends "RECT x0 y0 x1 y1" followed by the rectangle's
+ *     RGB565 pixels as raw big-endian bytes, row by row. That
+ *     is the byte order the panel takes, so buffers go to the
+ *     DMA as received.
+ *
+ *     The command layer reads those bytes from the CDC driver
+ *     directly into one of REMOTE_BUFS pixel buffers; the
+ *     buffer is then handed to the render core, which points
+ *     the display DMA at it and returns it once the transfer
+ *     is done. Pixels are never copied between the USB driver
+ *     and the DMA source. A rectangle larger than one buffer
+ *     is split across several, only the first setting the
+ *     address window.
+ *
+ *     When every buffer is in use, the control core stops
+ *     reading USB. The host is then held off by USB flow
+ *     control, so the stream runs as fast as the panel and the
+ *     bus allow and nothing is dropped. A returned buffer wakes
+ *     the control core to carry on.
+ *
+ *     Buffers move between the cores through two SPSC queues
+ *     holding buffer indices: ready (control to render) and
+ *     free (render to control).
+ *
+ **************************************************************/
+
+#include "remote.h"
+#include "sched.h"
+#include "spsc.h"
+#include "dispmon.h"
+#include "../lib/src/ST7789/hardware.h"
+#include "../lib/src/graphics/util.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+
+#define REMOTE_BUF_BYTES (REMOTE_BUF_PIXELS * 2)
+
+typedef struct {
+        uint16_t x0, y0, x1, y1;
+        bool window;
+        uint16_t len;
+        uint16_t px[REMOTE_BUF_PIXELS];
+} RemoteBuf;
+
+static RemoteBuf pool[REMOTE_BUFS];
+
+static uint8_t ready_buf[REMOTE_BUFS];
+static uint8_t free_buf[REMOTE_BUFS];
+static SpscQueue ready_queue;
+static SpscQueue free_queue;
+
+/* control core */
+static int fill = -1;
+static uint32_t fill_bytes;
+static uint32_t pending = 0;
+static bool need_window;
+static uint16_t rect_x0, rect_y0, rect_x1, rect_y1;
+static uint32_t rects = 0;
+static uint64_t bytes_total = 0;
+static uint32_t stalls = 0;
+
+/* render core */
+static int inflight = -1;
+
+static void submit(void);
+static void release(uint buf);
+
+/********** remote_init ********
+ *
+ * Set up the buffer queues with every buffer free
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 before the render core starts
+ ************************/
+void remote_init(void)
+{
+        spsc_init(&ready_queue, ready_buf, 1, REMOTE_BUFS);
+        spsc_init(&free_queue, free_buf, 1, REMOTE_BUFS);
+
+        for (uint8_t i = 0; i < REMOTE_BUFS; i++) {
+                spsc_push(&free_queue, &i);
+        }
+}
+
+/********** remote_begin ********
+ *
+ * Start receiving a rectangle
+ *
+ * Parameters:
+ *      uint16_t x0, y0, x1, y1: rectangle corners (inclusive)
+ *
+ * Return: false if the rectangle is off screen or a previous
+ *         one is still being received
+ *
+ * Expects:
+ *      Called on core0
+ ************************/
+bool remote_begin(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+        if (pending != 0 || x0 > x1 || y0 > y1 ||
+            x1 >= SCREEN_WIDTH || y1 >= SCREEN_HEIGHT) {
+                return false;
+        }
+
+        rect_x0 = x0;
+        rect_y0 = y0;
+        rect_x1 = x1;
+        rect_y1 = y1;
+        pending = (uint32_t)(x1 - x0 + 1) * (uint32_t)(y1 - y0 + 1) * 2;
+        need_window = true;
+        rects++;
+        return true;
+}
+
+/********** remote_pending ********
+ *
+ * Pixel bytes still expected for the current rectangle
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: byte count, 0 when no rectangle is open
+ *
+ * Expects:
+ *      Called on core0
+ ************************/
+uint32_t remote_pending(void)
+{
+        return pending;
+}
+
+/********** remote_rx_space ********
+ *
+ * Find where the next pixel bytes should be received
+ *
+ * Parameters:
+ *      uint32_t *room: set to the bytes that may be written
+ *
+ * Return: pointer into a pixel buffer, or NULL if no
+ *         rectangle is open or every buffer is in use
+ *
+ * Expects:
+ *      Called on core0; room is not NULL
+ *
+ * Notes:
+ *      room never runs past the end of the rectangle, so
+ *      bytes after it are left for the command parser
+ ************************/
+uint8_t *remote_rx_space(uint32_t *room)
+{
+        if (pending == 0) {
+                return NULL;
+        }
+
+        if (fill < 0) {
+                uint8_t i;
+
+                if (spsc_pop(&free_queue, &i) == false) {
+                        stalls++;
+                        return NULL;
+                }
+                fill = i;
+                fill_bytes = 0;
+
+                RemoteBuf *b = &pool[fill];
+                b->window = need_window;
+                b->x0 = rect_x0;
+                b->y0 = rect_y0;
+                b->x1 = rect_x1;
+                b->y1 = rect_y1;
+                need_window = false;
+        }
+
+        *room = REMOTE_BUF_BYTES - fill_bytes;
+        if (*room > pending) {
+                *room = pending;
+        }
+        return (uint8_t *)pool[fill].px + fill_bytes;
+}
+
+/********** remote_rx_commit ********
+ *
+ * Account for bytes written at remote_rx_space
+ *
+ * Parameters:
+ *      uint32_t n: bytes written, at most the room given
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on core0 after a successful remote_rx_space
+ *
+ * Notes:
+ *      A full buffer, or the end of the rectangle, sends the
+ *      buffer to the render core
+ ************************/
+void remote_rx_commit(uint32_t n)
+{
+        fill_bytes += n;
+        pending -= n;
+        bytes_total += n;
+
+        if (fill_bytes == REMOTE_BUF_BYTES || pending == 0) {
+                submit();
+        }
+}
+
+/********** submit ********
+ *
+ * Hand the buffer being filled to the render core
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      fill >= 0 and fill_bytes is even
+ *
+ * Notes:
+ *      The ready queue holds every buffer, so the push
+ *      cannot fail
+ ************************/
+static void submit(void)
+{
+        uint8_t i = (uint8_t)fill;
+
+        pool[fill].len = (uint16_t)(fill_bytes / 2);
+        spsc_push(&ready_queue, &i);
+        fill = -1;
+        sched_post(SCHED_CORE_RENDER, SCHED_EV_RENDER);
+}
+
+/********** release ********
+ *
+ * Return a buffer to the control core
+ *
+ * Parameters:
+ *      uint buf: buffer index
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core once the buffer's DMA is done
+ *
+ * Notes:
+ *      Wakes the control core with SCHED_EV_USB, since it
+ *      may have stopped reading for want of a buffer
+ ************************/
+static void release(uint buf)
+{
+        uint8_t i = (uint8_t)buf;
+
+        spsc_push(&free_queue, &i);
+        sched_post(SCHED_CORE_CONTROL, SCHED_EV_USB);
+}
+
+/********** remote_render ********
+ *
+ * Send every ready buffer to the panel
+ *
+ * Parameters:
+ *      bool visible: false while the panel sleeps; buffers
+ *                    are then returned without drawing
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core after draining messages
+ *
+ * Notes:
+ *      Each buffer is released once the next one can start,
+ *      so transfers run back to back; the last is waited
+ *      for before returning
+ ************************/
+void remote_render(bool visible)
+{
+        uint8_t i;
+
+        while (spsc_pop(&ready_queue, &i)) {
+                RemoteBuf *b = &pool[i];
+
+                if (visible == false) {
+                        release(i);
+                        continue;
+                }
+
+                dispmon_wait_idle();
+                if (inflight >= 0) {
+                        release((uint)inflight);
+                }
+                if (b->window) {
+                        set_address_window(b->x0, b->y0, b->x1, b->y1);
+                }
+                start_display_transfer(b->px, b->len);
+                inflight = i;
+        }
+
+        if (inflight >= 0) {
+                dispmon_wait_idle();
+                release((uint)inflight);
+                inflight = -1;
+        }
+}
+
+/********** remote_report ********
+ *
+ * Print remote display counters
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      stalls= counts reads put off because every buffer was
+ *      queued or on the wire
+ ************************/
+void remote_report(void)
+{
+        printf("REMOTE rects=%lu bytes=%llu stalls=%lu free=%lu\n",
+               (unsigned long)rects, (unsigned long long)bytes_total,
+               (unsigned long)stalls,
+               (unsigned long)spsc_count(&free_queue));
+}
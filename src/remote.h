@@ -0,0 +1,37 @@
+/**************************************************************
+ *
+ *                          remote.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for remote display mode. The control core
+ *     reads pixel rectangles from USB straight into a pool of
+ *     DMA buffers; the render core sends each buffer to the
+ *     panel and hands it back. See tools/remote_display.py.
+ *
+ **************************************************************/
+
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define REMOTE_PAGE_NAME  "remote"
+#define REMOTE_BUFS       4
+#define REMOTE_BUF_PIXELS 2048
+#define REMOTE_POOL_BYTES (REMOTE_BUFS * REMOTE_BUF_PIXELS * 2)
+
+/* control core */
+void remote_init(void);
+bool remote_begin(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+uint32_t remote_pending(void);
+uint8_t *remote_rx_space(uint32_t *room);
+void remote_rx_commit(uint32_t n);
+void remote_report(void);
+
+/* render core */
+void remote_render(bool visible);
+
+#endif
@@ -0,0 +1,825 @@
+/**************************************************************
+ *
+ *                          render.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Render core. Runs on core1 and owns the display: it
+ *     initializes the panel, enters pages, and runs their
+ *     updates on fixed-timestep tickers. Commands from the
+ *     control core arrive through an SPSC queue, so a long
+ *     Mandelbrot batch never delays USB or button handling on
+ *     core0, and serial parsing never stalls rendering.
+ *
+ *     Pages are driven only through their PageDesc. Updates
+ *     are timed against each page's budget, and spare time
+ *     before the next deadline is used to pre-warm the page
+ *     most likely to be selected next.
+ *
+ *     Entering a page runs its enter coroutine in slices of
+ *     PAGE_SLICE_US, checking the message queue between
+ *     slices, so a new page request is never stuck behind a
+ *     full-screen draw.
+ *
+ **************************************************************/
+
+#include "render.h"
+#include "page.h"
+#include "../lib/src/ST7789/hardware.h"
+#include "../lib/src/graphics/util.h"
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "sched.h"
+#include "spsc.h"
+#include "dispmon.h"
+#include "latency.h"
+#include "monitor.h"
+#include "power.h"
+#include "telemetry.h"
+#include "capture.h"
+#include "remote.h"
+#include "split.h"
+
+#define RENDER_QUEUE_LEN     8
+#define PREWARM_MIN_SLACK_US 2000
+#define PAGE_SLICE_US        2000
+
+typedef enum {
+        RENDER_MSG_PAGE,
+        RENDER_MSG_POWER,
+        RENDER_MSG_COLORS,
+        RENDER_MSG_CAPTURE,
+        RENDER_MSG_CONFIG
+} RenderMsgType;
+
+typedef struct {
+        uint8_t type;
+        uint8_t page;
+        uint16_t arg;
+        uint32_t stamp_us;
+} RenderMsg;
+
+typedef struct {
+        uint32_t updates;
+        uint32_t overruns;
+        uint32_t max_update_us;
+        uint32_t last_enter_us;
+        uint16_t last_enter_slices;
+        bool entered_warm;
+} PageStats;
+
+static PageColors colors;
+static uint current_page = 0;
+static bool page_active = false;
+static bool panel_asleep = false;
+
+static bool entering = false;
+static Coro enter_co;
+static absolute_time_t enter_start;
+static uint16_t enter_slices;
+
+static uint16_t capture_tail_ms;
+static absolute_time_t capture_end_at;
+
+static Ticker page_tickers[SCHED_MAX_PAGES];
+static PageStats page_stats[SCHED_MAX_PAGES];
+static bool prewarmed[SCHED_MAX_PAGES];
+static uint16_t transitions[SCHED_MAX_PAGES][SCHED_MAX_PAGES];
+
+static SpscQueue render_queue;
+static RenderMsg render_queue_buf[RENDER_QUEUE_LEN];
+
+/* last page requested by core0, only touched on core0 */
+static uint selected_page = 0;
+
+static void switch_page(uint page);
+static void enter_page(uint page);
+static void resume_enter(void);
+static void handle_display_updates(void);
+static uint likely_next_page(void);
+static void prewarm_next_page(void);
+static void set_power(PowerState state, uint32_t edge_us);
+static void handle_message(const RenderMsg *msg);
+static void widget_init(void);
+static void render_core_main(void);
+
+/********** switch_page ********
+ *
+ * Make page current for display updates and idle accounting
+ *
+ * Parameters:
+ *      uint page: index into page_table
+ *
+ * Return: none
+ *
+ * Expects:
+ *      page < page_count
+ *
+ * Notes:
+ *      Restarts the page's ticker so its first update is due
+ *      one period after entry
+ ************************/
+static void switch_page(uint page)
+{
+        const PageDesc *desc = page_table[page];
+
+        current_page = page;
+        sched_set_page(page, desc->name);
+        ticker_start(&page_tickers[page], desc->name, desc->period_us,
+                     desc->policy, desc->max_steps);
+}
+
+/********** enter_page ********
+ *
+ * Leave the current page and start entering another
+ *
+ * Parameters:
+ *      uint page: index into page_table
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      Records the transition for next-page prediction
+ *      The enter coroutine runs from resume_enter; a page
+ *      whose enter is still in progress is simply abandoned
+ *      Out-of-range pages are ignored
+ *      A running screen capture ends here; a new page would
+ *      only be drawn over it
+ ************************/
+static void enter_page(uint page)
+{
+        if (page >= page_count) {
+                return;
+        }
+        capture_end();
+
+        if (page_active) {
+                const PageDesc *old = page_table[current_page];
+                if (old->exit != NULL) {
+                        old->exit();
+                }
+                if (page != current_page &&
+                    transitions[current_page][page] < UINT16_MAX) {
+                        transitions[current_page][page]++;
+                }
+        }
+
+        page_active = false;
+        entering = true;
+        CORO_INIT(&enter_co);
+        enter_start = get_absolute_time();
+        enter_slices = 0;
+
+        switch_page(page);
+}
+
+/********** resume_enter ********
+ *
+ * Run one slice of the current page's enter coroutine
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      entering is true
+ *
+ * Notes:
+ *      When the coroutine finishes, the ticker is restarted
+ *      so updates are timed from the end of the first frame,
+ *      and the switch latency measurement is closed once the
+ *      display DMA has drained
+ *      The entry is recorded for telemetry with its slice
+ *      count as the work
+ *      A screen capture ends with the entry, or for pages
+ *      with updates, capture_tail_ms later
+ ************************/
+static void resume_enter(void)
+{
+        const PageDesc *desc = page_table[current_page];
+        absolute_time_t until = make_timeout_time_us(PAGE_SLICE_US);
+
+        enter_slices++;
+        if (desc->enter(&enter_co, &colors, until) != CORO_DONE) {
+                return;
+        }
+
+        PageStats *st = &page_stats[current_page];
+
+        entering = false;
+        page_active = true;
+        switch_page(current_page);
+
+        st->entered_warm = prewarmed[current_page];
+        st->last_enter_us = (uint32_t)absolute_time_diff_us(
+                enter_start, get_absolute_time());
+        st->last_enter_slices = enter_slices;
+        prewarmed[current_page] = false;
+
+        dispmon_wait_idle();
+        latency_frame_done();
+        telemetry_record(TLM_REC_ENTER, current_page,
+                         (uint32_t)to_us_since_boot(enter_start),
+                         st->last_enter_us, enter_slices, 0);
+
+        if (capture_active()) {
+                capture_end_at = make_timeout_time_ms(capture_tail_ms);
+                if (capture_tail_ms == 0 || desc->update == NULL) {
+                        capture_end();
+                }
+        }
+}
+
+/********** handle_display_updates ********
+ *
+ * Run the current page's update if its ticker is due
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      A page has been entered
+ *
+ * Notes:
+ *      The update is given a deadline at the end of the page's
+ *      time budget, capped at PAGE_SLICE_US; pages with
+ *      adjustable work (Mandelbrot) stop there, and any update
+ *      that runs past the budget is counted as an overrun
+ *      Every update is also reported to the deadline monitor,
+ *      flagged as a miss if the next tick is already due, and
+ *      recorded for the telemetry stream
+ ************************/
+static void handle_display_updates(void)
+{
+        const PageDesc *desc = page_table[current_page];
+        PageStats *st = &page_stats[current_page];
+
+        if (desc->update == NULL) {
+                return;
+        }
+
+        uint steps = ticker_poll(&page_tickers[current_page]);
+        if (steps == 0) {
+                return;
+        }
+
+        uint32_t slice = desc->budget_us;
+        if (slice == 0 || slice > PAGE_SLICE_US) {
+                slice = PAGE_SLICE_US;
+        }
+
+        absolute_time_t start = get_absolute_time();
+        desc->update(steps, delayed_by_us(start, slice));
+
+        uint32_t took = (uint32_t)absolute_time_diff_us(
+                start, get_absolute_time());
+        st->updates++;
+        if (took > st->max_update_us) {
+                st->max_update_us = took;
+        }
+        uint8_t flags = 0;
+        if (desc->budget_us != 0 && took > desc->budget_us) {
+                st->overruns++;
+                flags |= TLM_FLAG_OVERRUN;
+        }
+
+        bool missed = time_reached(
+                ticker_deadline(&page_tickers[current_page]));
+        monitor_tick(current_page, took, desc->budget_us, missed);
+        if (missed) {
+                flags |= TLM_FLAG_MISSED;
+        }
+        telemetry_record(TLM_REC_TICK, current_page,
+                         (uint32_t)to_us_since_boot(start), took,
+                         desc->work != NULL ? desc->work() : 0, flags);
+
+        if (capture_active() && time_reached(capture_end_at)) {
+                capture_end();
+        }
+}
+
+/********** likely_next_page ********
+ *
+ * Predict which page will be selected next
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: index into page_table
+ *
+ * Expects:
+ *      page_count > 1
+ *
+ * Notes:
+ *      Picks the most frequent transition out of the current
+ *      page; with no history, guesses the following page
+ ************************/
+static uint likely_next_page(void)
+{
+        uint best = (current_page + 1) % page_count;
+        uint16_t best_count = 0;
+
+        for (uint i = 0; i < page_count; i++) {
+                if (i != current_page &&
+                    transitions[current_page][i] > best_count) {
+                        best = i;
+                        best_count = transitions[current_page][i];
+                }
+        }
+        return best;
+}
+
+/********** prewarm_next_page ********
+ *
+ * Use idle time to prepare the likely next page
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core between updates
+ *
+ * Notes:
+ *      Only runs with no queued messages and at least
+ *      PREWARM_MIN_SLACK_US before the current page's next
+ *      deadline; each page is pre-warmed once per visit
+ ************************/
+static void prewarm_next_page(void)
+{
+        uint next = likely_next_page();
+        const PageDesc *desc = page_table[next];
+
+        if (desc->prewarm == NULL || prewarmed[next]) {
+                return;
+        }
+        if (spsc_count(&render_queue) != 0) {
+                return;
+        }
+
+        absolute_time_t deadline =
+                ticker_deadline(&page_tickers[current_page]);
+        if (absolute_time_diff_us(get_absolute_time(), deadline) <
+            PREWARM_MIN_SLACK_US) {
+                return;
+        }
+
+        desc->prewarm(&colors);
+        prewarmed[next] = true;
+}
+
+/********** set_power ********
+ *
+ * Apply a power state from the control core
+ *
+ * Parameters:
+ *      PowerState state: new state
+ *      uint32_t edge_us: time_us_32 of the waking input, or 0
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core
+ *
+ * Notes:
+ *      On wake, the current page gets one update before the
+ *      backlight comes on, so the first lit frame is current;
+ *      its ticker restarts from there
+ ************************/
+static void set_power(PowerState state, uint32_t edge_us)
+{
+        if (state == POWER_SLEEP) {
+                if (panel_asleep == false) {
+                        dispmon_wait_idle();
+                        power_panel_sleep();
+                        panel_asleep = true;
+                }
+                return;
+        }
+
+        if (panel_asleep) {
+                const PageDesc *desc = page_table[current_page];
+
+                power_panel_wake();
+                panel_asleep = false;
+
+                if (page_active && desc->update != NULL) {
+                        desc->update(1, make_timeout_time_us(PAGE_SLICE_US));
+                        switch_page(current_page);
+                }
+                dispmon_wait_idle();
+                power_wake_done(edge_us);
+        }
+
+        power_backlight(state);
+}
+
+/********** handle_message ********
+ *
+ * Apply one message from the control core
+ *
+ * Parameters:
+ *      const RenderMsg *msg: message popped from render_queue
+ *
+ * Return: none
+ *
+ * Expects:
+ *      msg is not NULL
+ *
+ * Notes:
+ *      Unknown pages are ignored
+ *      A colour change re-enters the current page to redraw it
+ *      A capture also re-enters it, so the whole screen passes
+ *      through the capture encoder; it is ignored while the
+ *      panel sleeps
+ *      A page setting re-enters the page if it is showing,
+ *      so the new value takes effect at once
+ *      Page switches are measured from the input timestamp to
+ *      the end of the new page's first frame, which is when
+ *      its enter coroutine finishes
+ ************************/
+static void handle_message(const RenderMsg *msg)
+{
+        switch (msg->type) {
+        case RENDER_MSG_PAGE:
+                if (msg->page >= page_count) {
+                        break;
+                }
+                latency_begin(current_page, msg->page, msg->stamp_us);
+                enter_page(msg->page);
+                break;
+        case RENDER_MSG_POWER:
+                if (msg->arg < POWER_STATES) {
+                        set_power((PowerState)msg->arg, msg->stamp_us);
+                }
+                break;
+        case RENDER_MSG_COLORS:
+                colors.bg = msg->arg;
+                colors.fg = (uint16_t)msg->stamp_us;
+                enter_page(current_page);
+                break;
+        case RENDER_MSG_CAPTURE:
+                if (panel_asleep) {
+                        break;
+                }
+                enter_page(current_page);
+                capture_tail_ms = msg->arg;
+                capture_begin(current_page, SCREEN_WIDTH, SCREEN_HEIGHT);
+                break;
+        case RENDER_MSG_CONFIG:
+                if (msg->page >= page_count ||
+                    page_table[msg->page]->configure == NULL) {
+                        break;
+                }
+                if (page_table[msg->page]->configure(msg->arg, msg->stamp_us) &&
+                    msg->page == current_page) {
+                        enter_page(current_page);
+                }
+                break;
+        default:
+                break;
+        }
+}
+
+/********** widget_init ********
+ *
+ * Initialize display hardware and show the default page
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      colors set by render_launch
+ *      Called on the render core
+ *
+ * Notes:
+ *      Starts entering the first table entry (clock)
+ ************************/
+static void widget_init(void)
+{
+        display_spi_init();
+        display_dma_init();
+        gpio_pin_init();
+        st7789_init();
+        power_backlight_init();
+
+        enter_page(0);
+}
+
+/********** render_core_main ********
+ *
+ * Entry point and main loop of the render core
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none (never returns)
+ *
+ * Expects:
+ *      Launched on core1 by render_launch
+ *
+ * Notes:
+ *      While a page is being entered, runs one enter slice per
+ *      pass without sleeping
+ *      Otherwise sleeps in WFE until a message arrives or the
+ *      current page's ticker is due
+ *      Drains all queued messages and remote display buffers
+ *      before each slice or update
+ *      Reports busy/asleep to the deadline monitor, so a pass
+ *      that never returns to WFE trips the watchdog
+ *      While the panel sleeps, only messages wake the core
+ *      and no page work is done
+ ************************/
+static void render_core_main(void)
+{
+        RenderMsg msg;
+
+        sched_init_core();
+        monitor_busy_begin(0);
+        widget_init();
+
+        while (1) {
+                if (panel_asleep) {
+                        monitor_busy_end();
+                        sched_wait(SCHED_EV_RENDER, at_the_end_of_time);
+                } else if (entering == false) {
+                        monitor_busy_end();
+                        sched_wait(SCHED_EV_RENDER, ticker_deadline(
+                                &page_tickers[current_page]));
+                }
+                monitor_busy_begin(current_page);
+
+                while (spsc_pop(&render_queue, &msg)) {
+                        handle_message(&msg);
+                }
+                remote_render(panel_asleep == false);
+
+                if (panel_asleep) {
+                        continue;
+                }
+                if (entering) {
+                        resume_enter();
+                } else {
+                        handle_display_updates();
+                        prewarm_next_page();
+                }
+        }
+}
+
+/********** render_launch ********
+ *
+ * Start the render core
+ *
+ * Parameters:
+ *      uint16_t bg:   background color (RGB565)
+ *      uint16_t text: text/border color (RGB565)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 after sched_init
+ *      page_count <= SCHED_MAX_PAGES (checked in pages.c)
+ *
+ * Notes:
+ *      Display hardware is initialized on core1 so its
+ *      interrupts, if any, are serviced by the render core
+ ************************/
+void render_launch(uint16_t bg, uint16_t text)
+{
+        colors.bg = bg;
+        colors.fg = text;
+
+        spsc_init(&render_queue, render_queue_buf, sizeof(RenderMsg),
+                  RENDER_QUEUE_LEN);
+        telemetry_init();
+        capture_init();
+        remote_init();
+        split_init();
+        multicore_launch_core1(render_core_main);
+}
+
+/********** render_select_page ********
+ *
+ * Ask the render core to switch pages
+ *
+ * Parameters:
+ *      uint page:        index into page_table
+ *      uint32_t edge_us: time_us_32 when the request was made,
+ *                        used for input-to-photon latency
+ *
+ * Return: true if queued, false if out of range or the queue
+ *         is full
+ *
+ * Expects:
+ *      Called from core0 thread context only (single producer)
+ ************************/
+bool render_select_page(uint page, uint32_t edge_us)
+{
+        RenderMsg msg = {
+                .type = RENDER_MSG_PAGE,
+                .page = (uint8_t)page,
+                .arg = 0,
+                .stamp_us = edge_us
+        };
+
+        if (page >= page_count) {
+                return false;
+        }
+        if (spsc_push(&render_queue, &msg) == false) {
+                return false;
+        }
+        selected_page = page;
+        sched_post(SCHED_CORE_RENDER, SCHED_EV_RENDER);
+        return true;
+}
+
+/********** render_selected_page ********
+ *
+ * Last page successfully requested with render_select_page
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: index into page_table
+ *
+ * Expects:
+ *      Called from core0 only
+ ************************/
+uint render_selected_page(void)
+{
+        return selected_page;
+}
+
+/********** render_set_colors ********
+ *
+ * Ask the render core to change the page colours
+ *
+ * Parameters:
+ *      uint16_t bg:   RGB565 background
+ *      uint16_t text: RGB565 text and border colour
+ *
+ * Return: true if queued, false if the queue is full
+ *
+ * Expects:
+ *      Called from core0 thread context only (single producer)
+ ************************/
+bool render_set_colors(uint16_t bg, uint16_t text)
+{
+        RenderMsg msg = {
+                .type = RENDER_MSG_COLORS,
+                .page = 0,
+                .arg = bg,
+                .stamp_us = text
+        };
+
+        if (spsc_push(&render_queue, &msg) == false) {
+                return false;
+        }
+        sched_post(SCHED_CORE_RENDER, SCHED_EV_RENDER);
+        return true;
+}
+
+/********** render_set_power ********
+ *
+ * Ask the render core to apply a power state
+ *
+ * Parameters:
+ *      uint state:       PowerState to apply
+ *      uint32_t edge_us: time_us_32 of the waking input, or 0,
+ *                        used for wake latency
+ *
+ * Return: true if queued, false if the queue is full
+ *
+ * Expects:
+ *      Called from core0 thread context only (single producer)
+ ************************/
+bool render_set_power(uint state, uint32_t edge_us)
+{
+        RenderMsg msg = {
+                .type = RENDER_MSG_POWER,
+                .page = 0,
+                .arg = (uint16_t)state,
+                .stamp_us = edge_us
+        };
+
+        if (spsc_push(&render_queue, &msg) == false) {
+                return false;
+        }
+        sched_post(SCHED_CORE_RENDER, SCHED_EV_RENDER);
+        return true;
+}
+
+/********** render_capture ********
+ *
+ * Ask the render core to redraw the current page into a
+ * screen capture
+ *
+ * Parameters:
+ *      uint16_t tail_ms: keep capturing page updates for this
+ *                        long after the redraw
+ *
+ * Return: true if queued, false if the queue is full
+ *
+ * Expects:
+ *      Called from core0 thread context only (single producer)
+ ************************/
+bool render_capture(uint16_t tail_ms)
+{
+        RenderMsg msg = {
+                .type = RENDER_MSG_CAPTURE,
+                .page = 0,
+                .arg = tail_ms,
+                .stamp_us = 0
+        };
+
+        if (spsc_push(&render_queue, &msg) == false) {
+                return false;
+        }
+        sched_post(SCHED_CORE_RENDER, SCHED_EV_RENDER);
+        return true;
+}
+
+/********** render_configure ********
+ *
+ * Send a page-specific setting to the render core
+ *
+ * Parameters:
+ *      uint page:      index into page_table
+ *      uint16_t key:   which setting, defined by the page
+ *      uint32_t value: new value
+ *
+ * Return: true if queued, false if the queue is full
+ *
+ * Expects:
+ *      Called from core0 thread context only (single producer)
+ *
+ * Notes:
+ *      Ignored by the render core if the page has no
+ *      configure hook or rejects the setting
+ ************************/
+bool render_configure(uint page, uint16_t key, uint32_t value)
+{
+        RenderMsg msg = {
+                .type = RENDER_MSG_CONFIG,
+                .page = (uint8_t)page,
+                .arg = key,
+                .stamp_us = value
+        };
+
+        if (spsc_push(&render_queue, &msg) == false) {
+                return false;
+        }
+        sched_post(SCHED_CORE_RENDER, SCHED_EV_RENDER);
+        return true;
+}
+
+/********** render_report_pages ********
+ *
+ * Print descriptor and runtime statistics for every page
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB serial initialized
+ *
+ * Notes:
+ *      One "PAGE" line per table entry, then "OK"
+ *      enter= is the last page switch time and slices= the
+ *      number of slices it took; warm=1 when the page had
+ *      been pre-warmed before that switch
+ *      Reads render core counters without locking
+ ************************/
+void render_report_pages(void)
+{
+        for (uint i = 0; i < page_count; i++) {
+                const PageDesc *d = page_table[i];
+                const PageStats *st = &page_stats[i];
+
+                printf("PAGE %u %s period=%lu budget=%lu mem=%lu "
+                       "updates=%lu overruns=%lu max=%lu "
+                       "enter=%lu slices=%u warm=%d\n",
+                       i, d->name, (unsigned long)d->period_us,
+                       (unsigned long)d->budget_us,
+                       (unsigned long)d->mem_bytes,
+                       (unsigned long)st->updates,
+                       (unsigned long)st->overruns,
+                       (unsigned long)st->max_update_us,
+                       (unsigned long)st->last_enter_us,
+                       st->last_enter_slices,
+                       st->entered_warm ? 1 : 0);
+        }
+        printf("OK\n");
+}
@@ -0,0 +1,29 @@
+/**************************************************************
+ *
+ *                          render.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the render core. Core1 owns the display and
+ *     runs the page enter/update functions; core0 controls it by
+ *     posting messages through a lock-free queue.
+ *
+ **************************************************************/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+void render_launch(uint16_t bg, uint16_t text);
+bool render_select_page(uint page, uint32_t edge_us);
+bool render_set_power(uint state, uint32_t edge_us);
+uint render_selected_page(void);
+bool render_set_colors(uint16_t bg, uint16_t text);
+bool render_capture(uint16_t tail_ms);
+bool render_configure(uint page, uint16_t key, uint32_t value);
+void render_report_pages(void);
+
+#endif
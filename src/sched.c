@@ -0,0 +1,529 @@
+/**************************************************************
+ *
+ *                          sched.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Event-driven scheduler. GPIO, USB and timer interrupts
+ *     and the other core post per-core event bits under a
+ *     hardware spin lock; each core's loop waits in WFE with
+ *     its own hardware alarm armed at its next deadline, so
+ *     wake-ups have microsecond precision and the core sleeps
+ *     between them. Page idle time is measured on the render
+ *     core, which runs the pages.
+ *
+ *     Tickers schedule periodic work on absolute deadlines
+ *     (next = prev + period) so lateness never accumulates.
+ *     When a tick is late by more than a period, the policy
+ *     either skips the missed steps or runs them back to back.
+ *
+ **************************************************************/
+
+#include "sched.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/platform.h"
+#include <stdio.h>
+
+static volatile uint32_t pending_events[SCHED_NUM_CORES];
+static spin_lock_t *event_lock;
+static int wake_alarm[SCHED_NUM_CORES] = { -1, -1 };
+static uint64_t control_idle_us = 0;
+
+static uint current_page = 0;
+static const char *page_names[SCHED_MAX_PAGES];
+static uint64_t idle_us[SCHED_MAX_PAGES];
+static uint64_t total_us[SCHED_MAX_PAGES];
+static absolute_time_t page_since;
+
+static Ticker *tickers[SCHED_MAX_PAGES];
+
+static void wake_alarm_irq(uint alarm_num);
+static uint32_t take_events(uint core, uint32_t mask);
+static void close_page_interval(absolute_time_t now);
+static void print_idle(const char *name, uint64_t idle, uint64_t total);
+static uint hist_bucket(uint64_t us);
+static void print_hist(const char *label, const uint32_t *hist);
+
+/********** wake_alarm_irq ********
+ *
+ * Hardware alarm handler for the scheduler deadline
+ *
+ * Parameters:
+ *      uint alarm_num: alarm that fired (unused)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Runs in interrupt context on the core that armed it
+ ************************/
+static void wake_alarm_irq(uint alarm_num)
+{
+        (void)alarm_num;
+        sched_post(get_core_num(), SCHED_EV_TIMER);
+}
+
+/********** take_events ********
+ *
+ * Atomically fetch and clear pending events
+ *
+ * Parameters:
+ *      uint core:     core whose events to take
+ *      uint32_t mask: event bits the caller is interested in
+ *
+ * Return: pending events within mask (now cleared)
+ *
+ * Expects:
+ *      sched_init has been called
+ ************************/
+static uint32_t take_events(uint core, uint32_t mask)
+{
+        uint32_t irq = spin_lock_blocking(event_lock);
+        uint32_t ev = pending_events[core] & mask;
+        pending_events[core] &= ~ev;
+        spin_unlock(event_lock, irq);
+        return ev;
+}
+
+/********** close_page_interval ********
+ *
+ * Credit time since the last page change to the current page
+ *
+ * Parameters:
+ *      absolute_time_t now: end of the interval
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void close_page_interval(absolute_time_t now)
+{
+        total_us[current_page] +=
+                (uint64_t)absolute_time_diff_us(page_since, now);
+        page_since = now;
+}
+
+/********** sched_init ********
+ *
+ * Claim the spin lock shared by both cores
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 at startup, before any sched_post
+ *      and before core1 is launched
+ ************************/
+void sched_init(void)
+{
+        event_lock = spin_lock_init((uint)spin_lock_claim_unused(true));
+        page_since = get_absolute_time();
+}
+
+/********** sched_init_core ********
+ *
+ * Claim the calling core's wake-up alarm
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      sched_init has been called
+ *      Called once on each core that uses sched_wait
+ *
+ * Notes:
+ *      The alarm interrupt is enabled on the calling core, so
+ *      deadline wake-ups land on the core that is waiting
+ ************************/
+void sched_init_core(void)
+{
+        uint core = get_core_num();
+
+        wake_alarm[core] = hardware_alarm_claim_unused(true);
+        hardware_alarm_set_callback((uint)wake_alarm[core],
+                                    wake_alarm_irq);
+}
+
+/********** sched_post ********
+ *
+ * Post event bits to a core and wake it from WFE
+ *
+ * Parameters:
+ *      uint core:       SCHED_CORE_CONTROL or SCHED_CORE_RENDER
+ *      uint32_t events: SCHED_EV_* bits to set
+ *
+ * Return: none
+ *
+ * Expects:
+ *      sched_init has been called
+ *
+ * Notes:
+ *      Safe to call from interrupt handlers
+ *      SEV also covers the race where an event lands between
+ *      the pending check and the WFE in sched_wait
+ ************************/
+void sched_post(uint core, uint32_t events)
+{
+        uint32_t irq = spin_lock_blocking(event_lock);
+        pending_events[core] |= events;
+        spin_unlock(event_lock, irq);
+        __sev();
+}
+
+/********** sched_wait ********
+ *
+ * Sleep the calling core until an event in mask is posted to
+ * it or deadline passes
+ *
+ * Parameters:
+ *      uint32_t mask:            SCHED_EV_* bits to wake on
+ *      absolute_time_t deadline: next timed work, or
+ *                                at_the_end_of_time for none
+ *
+ * Return: events that ended the wait; SCHED_EV_TIMER is set
+ *         when the deadline was reached
+ *
+ * Expects:
+ *      sched_init_core has been called on this core
+ *
+ * Notes:
+ *      On the render core, time spent in WFE is credited as
+ *      idle to the current page
+ *      Spurious SCHED_EV_TIMER wake-ups are possible and must
+ *      be tolerated by the caller
+ ************************/
+uint32_t sched_wait(uint32_t mask, absolute_time_t deadline)
+{
+        uint core = get_core_num();
+        uint alarm = (uint)wake_alarm[core];
+
+        mask |= SCHED_EV_TIMER;
+
+        uint32_t ev = take_events(core, mask);
+        if (ev != 0) {
+                return ev;
+        }
+
+        bool timed = !is_at_the_end_of_time(deadline);
+        if (timed && hardware_alarm_set_target(alarm, deadline)) {
+                return SCHED_EV_TIMER;
+        }
+
+        absolute_time_t start = get_absolute_time();
+
+        while ((ev = take_events(core, mask)) == 0) {
+                if (timed && time_reached(deadline)) {
+                        ev = SCHED_EV_TIMER;
+                        break;
+                }
+                __wfe();
+        }
+
+        if (timed) {
+                hardware_alarm_cancel(alarm);
+        }
+
+        uint64_t idle = (uint64_t)absolute_time_diff_us(
+                start, get_absolute_time());
+        if (core == SCHED_CORE_RENDER) {
+                idle_us[current_page] += idle;
+        } else {
+                control_idle_us += idle;
+        }
+        return ev;
+}
+
+/********** sched_set_page ********
+ *
+ * Switch the page that idle time is accounted against
+ *
+ * Parameters:
+ *      uint page:        page index (< SCHED_MAX_PAGES)
+ *      const char *name: label used in reports
+ *
+ * Return: none
+ *
+ * Expects:
+ *      name points to static storage
+ *      Called on the render core
+ ************************/
+void sched_set_page(uint page, const char *name)
+{
+        if (page >= SCHED_MAX_PAGES) {
+                return;
+        }
+
+        close_page_interval(get_absolute_time());
+        current_page = page;
+        page_names[page] = name;
+}
+
+/********** sched_report_idle ********
+ *
+ * Print idle CPU percentage for each page seen so far
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB serial initialized
+ *
+ * Notes:
+ *      Output: "IDLE control <pct>%" for core0, then one
+ *      "IDLE <page> <pct>%" line per page for core1, then "OK"
+ *      Reads render core counters without locking; a report
+ *      can be off by the tick that is in progress
+ ************************/
+void sched_report_idle(void)
+{
+        absolute_time_t now = get_absolute_time();
+
+        print_idle("control", control_idle_us,
+                   to_us_since_boot(now));
+
+        for (uint i = 0; i < SCHED_MAX_PAGES; i++) {
+                uint64_t total = total_us[i];
+                if (i == current_page) {
+                        total += (uint64_t)absolute_time_diff_us(
+                                page_since, now);
+                }
+                if (page_names[i] != NULL) {
+                        print_idle(page_names[i], idle_us[i], total);
+                }
+        }
+        printf("OK\n");
+}
+
+/********** print_idle ********
+ *
+ * Print one idle percentage line
+ *
+ * Parameters:
+ *      const char *name: label
+ *      uint64_t idle:    microseconds spent idle
+ *      uint64_t total:   microseconds observed
+ *
+ * Return: none
+ *
+ * Expects:
+ *      name is not NULL
+ ************************/
+static void print_idle(const char *name, uint64_t idle, uint64_t total)
+{
+        if (total == 0) {
+                return;
+        }
+
+        uint32_t permille = (uint32_t)((idle * 1000u) / total);
+        printf("IDLE %s %lu.%lu%%\n", name,
+               (unsigned long)(permille / 10),
+               (unsigned long)(permille % 10));
+}
+
+/********** hist_bucket ********
+ *
+ * Map a duration to a log2 histogram bucket
+ *
+ * Parameters:
+ *      uint64_t us: duration in microseconds
+ *
+ * Return: bucket index in [0, TICK_HIST_BUCKETS)
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Bucket 0 holds 0-15us, bucket i holds [2^(i+3), 2^(i+4))
+ *      The last bucket also holds everything above it
+ ************************/
+static uint hist_bucket(uint64_t us)
+{
+        if (us < 16) {
+                return 0;
+        }
+        if (us >= (1u << (TICK_HIST_BUCKETS + 2))) {
+                return TICK_HIST_BUCKETS - 1;
+        }
+
+        uint bits = 32u - (uint)__builtin_clz((uint32_t)us);
+        return bits - 4u;
+}
+
+/********** print_hist ********
+ *
+ * Print one histogram line
+ *
+ * Parameters:
+ *      const char *label:     line prefix
+ *      const uint32_t *hist:  TICK_HIST_BUCKETS counters
+ *
+ * Return: none
+ *
+ * Expects:
+ *      hist is not NULL
+ ************************/
+static void print_hist(const char *label, const uint32_t *hist)
+{
+        printf("%s", label);
+        for (uint i = 0; i < TICK_HIST_BUCKETS; i++) {
+                printf(" %lu", (unsigned long)hist[i]);
+        }
+        printf("\n");
+}
+
+/********** ticker_start ********
+ *
+ * (Re)start a fixed-timestep ticker
+ *
+ * Parameters:
+ *      Ticker *t:          ticker to start
+ *      const char *name:   label used in reports
+ *      uint32_t period_us: step period (0 = never due)
+ *      TickPolicy policy:  TICK_SKIP or TICK_CATCH_UP
+ *      uint8_t max_steps:  cap on steps per poll for catch-up
+ *
+ * Return: none
+ *
+ * Expects:
+ *      t has static storage duration
+ *
+ * Notes:
+ *      First step is due one period from now
+ *      Statistics are kept across restarts
+ ************************/
+void ticker_start(Ticker *t, const char *name, uint32_t period_us,
+                  TickPolicy policy, uint8_t max_steps)
+{
+        t->name = name;
+        t->period_us = period_us;
+        t->policy = policy;
+        t->max_steps = max_steps == 0 ? 1 : max_steps;
+        t->started = false;
+        t->next = delayed_by_us(get_absolute_time(), period_us);
+
+        for (uint i = 0; i < SCHED_MAX_PAGES; i++) {
+                if (tickers[i] == t) {
+                        return;
+                }
+                if (tickers[i] == NULL) {
+                        tickers[i] = t;
+                        return;
+                }
+        }
+}
+
+/********** ticker_poll ********
+ *
+ * Check whether the ticker is due and advance its deadline
+ *
+ * Parameters:
+ *      Ticker *t: started ticker
+ *
+ * Return: number of steps to run now (0 if not yet due)
+ *
+ * Expects:
+ *      ticker_start has been called on t
+ *
+ * Notes:
+ *      Deadlines stay on the grid start + k * period
+ *      TICK_SKIP returns at most 1 and drops missed steps
+ *      TICK_CATCH_UP returns up to max_steps; any backlog
+ *      beyond that is dropped so the ticker cannot spiral
+ *      Records lateness and run-to-run jitter histograms
+ ************************/
+uint ticker_poll(Ticker *t)
+{
+        if (t->period_us == 0) {
+                return 0;
+        }
+
+        absolute_time_t now = get_absolute_time();
+        int64_t late = absolute_time_diff_us(t->next, now);
+        if (late < 0) {
+                return 0;
+        }
+
+        uint32_t due = (uint32_t)((uint64_t)late / t->period_us) + 1;
+        uint32_t steps = 1;
+        if (t->policy == TICK_CATCH_UP) {
+                steps = due < t->max_steps ? due : t->max_steps;
+        }
+
+        t->skipped += due - steps;
+        t->next = delayed_by_us(t->next, (uint64_t)due * t->period_us);
+        t->late_hist[hist_bucket((uint64_t)late)]++;
+
+        if (t->started) {
+                int64_t gap = absolute_time_diff_us(t->last_run, now);
+                int64_t jitter = gap - (int64_t)t->period_us;
+                if (jitter < 0) {
+                        jitter = -jitter;
+                }
+                t->jitter_hist[hist_bucket((uint64_t)jitter)]++;
+        }
+        t->started = true;
+        t->last_run = now;
+        t->runs += steps;
+
+        return steps;
+}
+
+/********** ticker_deadline ********
+ *
+ * Get the absolute time the next step is due
+ *
+ * Parameters:
+ *      const Ticker *t: started ticker
+ *
+ * Return: next deadline, or at_the_end_of_time if period is 0
+ *
+ * Expects:
+ *      ticker_start has been called on t
+ ************************/
+absolute_time_t ticker_deadline(const Ticker *t)
+{
+        if (t->period_us == 0) {
+                return at_the_end_of_time;
+        }
+        return t->next;
+}
+
+/********** sched_report_timing ********
+ *
+ * Print step counts and histograms for every ticker
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      USB serial initialized
+ *
+ * Notes:
+ *      "TICK <name> period=<us> runs=<n> skipped=<n>" followed
+ *      by "LATE" and "JITTER" lines of bucket counts; bucket 0
+ *      is 0-15us and each later bucket doubles, then "OK"
+ ************************/
+void sched_report_timing(void)
+{
+        for (uint i = 0; i < SCHED_MAX_PAGES && tickers[i] != NULL; i++) {
+                const Ticker *t = tickers[i];
+
+                printf("TICK %s period=%lu runs=%lu skipped=%lu\n",
+                       t->name, (unsigned long)t->period_us,
+                       (unsigned long)t->runs,
+                       (unsigned long)t->skipped);
+                print_hist("LATE", t->late_hist);
+                print_hist("JITTER", t->jitter_hist);
+        }
+        printf("OK\n");
+}
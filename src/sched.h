@@ -0,0 +1,70 @@
+/**************************************************************
+ *
+ *                          sched.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the event-driven scheduler. Interrupt
+ *     sources and the other core post event bits to a core,
+ *     and each core's loop sleeps in WFE until an event arrives
+ *     or its hardware alarm deadline is reached. Tracks idle
+ *     time per display page and provides fixed-timestep
+ *     tickers with lateness statistics.
+ *
+ **************************************************************/
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define SCHED_EV_BUTTON (1u << 0)
+#define SCHED_EV_USB    (1u << 1)
+#define SCHED_EV_TIMER  (1u << 2)
+#define SCHED_EV_RENDER (1u << 3)
+#define SCHED_EV_TLM    (1u << 4)
+#define SCHED_EV_SHOT   (1u << 5)
+#define SCHED_EV_SPLIT  (1u << 6)
+
+#define SCHED_CORE_CONTROL 0
+#define SCHED_CORE_RENDER  1
+#define SCHED_NUM_CORES    2
+
+#define SCHED_MAX_PAGES 16
+#define TICK_HIST_BUCKETS 12
+
+typedef enum {
+        TICK_SKIP,
+        TICK_CATCH_UP
+} TickPolicy;
+
+typedef struct {
+        const char *name;
+        uint32_t period_us;
+        TickPolicy policy;
+        uint8_t max_steps;
+        bool started;
+        absolute_time_t next;
+        absolute_time_t last_run;
+        uint32_t runs;
+        uint32_t skipped;
+        uint32_t late_hist[TICK_HIST_BUCKETS];
+        uint32_t jitter_hist[TICK_HIST_BUCKETS];
+} Ticker;
+
+void sched_init(void);
+void sched_init_core(void);
+void sched_post(uint core, uint32_t events);
+uint32_t sched_wait(uint32_t mask, absolute_time_t deadline);
+void sched_set_page(uint page, const char *name);
+void sched_report_idle(void);
+void sched_report_timing(void);
+
+void ticker_start(Ticker *t, const char *name, uint32_t period_us,
+                  TickPolicy policy, uint8_t max_steps);
+uint ticker_poll(Ticker *t);
+absolute_time_t ticker_deadline(const Ticker *t);
+
+#endif
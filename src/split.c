@@ -0,0 +1,174 @@
+/**************************************************************
+ *
+ *                          split.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Splits a loop across both cores. The render core posts
+ *     SCHED_EV_SPLIT to the control core, which is normally
+ *     asleep in WFE, and starts on the first half itself. The
+ *     second half is claimed under a spin lock by whichever
+ *     core reaches it first: the control core if it woke in
+ *     time, otherwise the render core once its own half is
+ *     done. A control core busy with USB therefore only costs
+ *     the speed-up, never a stall.
+ *
+ *     Only one job is ever open, and only the render core
+ *     opens them; it does not return until both halves are
+ *     finished, so the halves may write shared buffers as
+ *     long as they write disjoint parts.
+ *
+ **************************************************************/
+
+#include "split.h"
+#include "sched.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+typedef enum {
+        SPLIT_IDLE,
+        SPLIT_OFFERED,
+        SPLIT_RUNNING,
+        SPLIT_DONE
+} SplitState;
+
+static spin_lock_t *split_lock;
+static volatile uint8_t split_state = SPLIT_IDLE;
+static SplitFn split_fn;
+static uint split_begin;
+static uint split_end;
+
+static uint32_t jobs;
+static uint32_t helped;
+
+static bool claim(void);
+
+/********** split_init ********
+ *
+ * Claim the spin lock guarding the offered half
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 before core1 is launched
+ ************************/
+void split_init(void)
+{
+        split_lock = spin_lock_init((uint)spin_lock_claim_unused(true));
+}
+
+/********** claim ********
+ *
+ * Take the offered half if nobody has yet
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: true if the caller now owns the second half
+ *
+ * Expects:
+ *      split_init has been called
+ ************************/
+static bool claim(void)
+{
+        uint32_t irq = spin_lock_blocking(split_lock);
+        bool mine = split_state == SPLIT_OFFERED;
+
+        if (mine) {
+                split_state = SPLIT_RUNNING;
+        }
+        spin_unlock(split_lock, irq);
+        return mine;
+}
+
+/********** split_run ********
+ *
+ * Run fn over [0, n) on both cores
+ *
+ * Parameters:
+ *      SplitFn fn: work function, called once per half
+ *      uint n:     number of items
+ *
+ * Return: none, once both halves have finished
+ *
+ * Expects:
+ *      Called on the render core only
+ *      fn only touches state its half owns, plus read-only
+ *      shared state
+ *
+ * Notes:
+ *      The first half is [0, n/2) and always runs here
+ ************************/
+void split_run(SplitFn fn, uint n)
+{
+        uint mid = n / 2;
+
+        split_fn = fn;
+        split_begin = mid;
+        split_end = n;
+        __dmb();
+        split_state = SPLIT_OFFERED;
+        jobs++;
+        sched_post(SCHED_CORE_CONTROL, SCHED_EV_SPLIT);
+
+        fn(0, mid, 0);
+
+        if (claim()) {
+                fn(mid, n, 1);
+        } else {
+                helped++;
+                while (split_state != SPLIT_DONE) {
+                        /* the other half is short; spin */
+                }
+                __dmb();
+        }
+        split_state = SPLIT_IDLE;
+}
+
+/********** split_help ********
+ *
+ * Run the offered half, if it is still unclaimed
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the control core when SCHED_EV_SPLIT arrives
+ *
+ * Notes:
+ *      Does nothing if the render core already took it back
+ ************************/
+void split_help(void)
+{
+        if (claim() == false) {
+                return;
+        }
+
+        __dmb();
+        split_fn(split_begin, split_end, 1);
+        __dmb();
+        split_state = SPLIT_DONE;
+}
+
+/********** split_report ********
+ *
+ * Print how often the control core took a share of the work
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ ************************/
+void split_report(void)
+{
+        printf("SPLIT jobs=%lu helped=%lu\n", (unsigned long)jobs,
+               (unsigned long)helped);
+}
@@ -0,0 +1,28 @@
+/**************************************************************
+ *
+ *                          split.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for sharing a loop between the cores. The
+ *     render core runs the first half of a range and offers
+ *     the second half to the control core; whichever core
+ *     gets to it first runs it.
+ *
+ **************************************************************/
+
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include <stdint.h>
+#include "pico/types.h"
+
+/* runs items [begin, end); part is 0 for the first half, 1 for the second */
+typedef void (*SplitFn)(uint begin, uint end, uint part);
+
+void split_init(void);
+void split_run(SplitFn fn, uint n);
+void split_help(void);
+void split_report(void);
+
+#endif
@@ -0,0 +1,119 @@
+/**************************************************************
+ *
+ *                          spsc.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Lock-free single-producer single-consumer ring buffer.
+ *     The producer only writes head and the consumer only
+ *     writes tail; both are free-running 32-bit counters, so
+ *     aligned word stores keep them consistent on the M0+ and
+ *     memory barriers order element copies against index
+ *     updates across cores.
+ *
+ **************************************************************/
+
+#include "spsc.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+/********** spsc_init ********
+ *
+ * Initialize an empty queue over caller-provided storage
+ *
+ * Parameters:
+ *      SpscQueue *q:       queue to initialize
+ *      void *buf:          storage for capacity elements
+ *      uint32_t elem_size: size of one element in bytes
+ *      uint32_t capacity:  number of slots (power of two)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      q and buf are not NULL
+ *      capacity is a power of two
+ *      Called before either side touches the queue
+ ************************/
+void spsc_init(SpscQueue *q, void *buf, uint32_t elem_size,
+               uint32_t capacity)
+{
+        q->buf = (uint8_t *)buf;
+        q->elem_size = elem_size;
+        q->mask = capacity - 1;
+        q->head = 0;
+        q->tail = 0;
+}
+
+/********** spsc_push ********
+ *
+ * Append an element (producer side only)
+ *
+ * Parameters:
+ *      SpscQueue *q:     initialized queue
+ *      const void *item: element to copy in
+ *
+ * Return: true if queued, false if the queue is full
+ *
+ * Expects:
+ *      Only ever called from one context
+ ************************/
+bool spsc_push(SpscQueue *q, const void *item)
+{
+        uint32_t head = q->head;
+
+        if (head - q->tail > q->mask) {
+                return false;
+        }
+
+        memcpy(q->buf + (head & q->mask) * q->elem_size, item,
+               q->elem_size);
+        __dmb();
+        q->head = head + 1;
+        return true;
+}
+
+/********** spsc_pop ********
+ *
+ * Remove the oldest element (consumer side only)
+ *
+ * Parameters:
+ *      SpscQueue *q: initialized queue
+ *      void *out:    destination for the element
+ *
+ * Return: true if an element was removed, false if empty
+ *
+ * Expects:
+ *      Only ever called from one context
+ ************************/
+bool spsc_pop(SpscQueue *q, void *out)
+{
+        uint32_t tail = q->tail;
+
+        if (tail == q->head) {
+                return false;
+        }
+
+        __dmb();
+        memcpy(out, q->buf + (tail & q->mask) * q->elem_size,
+               q->elem_size);
+        __dmb();
+        q->tail = tail + 1;
+        return true;
+}
+
+/********** spsc_count ********
+ *
+ * Number of elements currently queued
+ *
+ * Parameters:
+ *      const SpscQueue *q: initialized queue
+ *
+ * Return: element count (a snapshot; may change concurrently)
+ *
+ * Expects:
+ *      none
+ ************************/
+uint32_t spsc_count(const SpscQueue *q)
+{
+        return q->head - q->tail;
+}
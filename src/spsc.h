@@ -0,0 +1,33 @@
+/**************************************************************
+ *
+ *                          spsc.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for a lock-free single-producer single-consumer
+ *     queue of fixed-size elements. Safe between the two cores
+ *     or between an interrupt handler and thread code.
+ *
+ **************************************************************/
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+        uint8_t *buf;
+        uint32_t elem_size;
+        uint32_t mask;
+        volatile uint32_t head;
+        volatile uint32_t tail;
+} SpscQueue;
+
+void spsc_init(SpscQueue *q, void *buf, uint32_t elem_size,
+               uint32_t capacity);
+bool spsc_push(SpscQueue *q, const void *item);
+bool spsc_pop(SpscQueue *q, void *out);
+uint32_t spsc_count(const SpscQueue *q);
+
+#endif
@@ -0,0 +1,227 @@
+/**************************************************************
+ *
+ *                        telemetry.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Binary telemetry stream. Every page update and every
+ *     completed page entry on the render core becomes one
+ *     24-byte TelemetryRecord: when it started, how long it
+ *     took, pixels handed to the display DMA since the last
+ *     record, the page's own work count and whether it missed
+ *     its tick or overran its budget.
+ *
+ *     Records go through an SPSC ring to the control core,
+ *     which writes them to USB only while the CDC driver has
+ *     room for a whole record, so a slow or absent host never
+ *     stalls either core. A full ring drops the record and
+ *     counts it; the count travels in every later record.
+ *
+ *     A HELLO record is sent first after the stream is enabled,
+ *     carrying the SPI baud rate and page count so the host
+ *     can turn pixel counts into DMA utilisation.
+ *
+ **************************************************************/
+
+#include "telemetry.h"
+#include "dispmon.h"
+#include "page.h"
+#include "spsc.h"
+#include "sched.h"
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/spi.h"
+#include "tusb.h"
+
+#define TLM_QUEUE_LEN 64
+
+static TelemetryRecord tlm_queue_buf[TLM_QUEUE_LEN];
+static SpscQueue tlm_queue;
+static volatile bool enabled = false;
+static bool hello_pending = false;
+static uint16_t dropped = 0;
+
+static void seal(TelemetryRecord *r);
+static void send(TelemetryRecord *r);
+
+/********** seal ********
+ *
+ * Fill in the sync bytes and checksum of a record
+ *
+ * Parameters:
+ *      TelemetryRecord *r: record with its fields set
+ *
+ * Return: none
+ *
+ * Expects:
+ *      r is not NULL
+ ************************/
+static void seal(TelemetryRecord *r)
+{
+        const uint8_t *b = (const uint8_t *)r;
+        uint8_t sum = 0;
+
+        r->sync0 = TLM_SYNC0;
+        r->sync1 = TLM_SYNC1;
+        r->check = 0;
+        for (uint i = 0; i < sizeof(*r); i++) {
+                sum += b[i];
+        }
+        r->check = (uint8_t)-sum;
+}
+
+/********** send ********
+ *
+ * Write one record to the USB driver
+ *
+ * Parameters:
+ *      TelemetryRecord *r: sealed record
+ *
+ * Return: none
+ *
+ * Expects:
+ *      tud_cdc_write_available() >= sizeof(*r)
+ ************************/
+static void send(TelemetryRecord *r)
+{
+        stdio_usb.out_chars((const char *)r, (int)sizeof(*r));
+}
+
+/********** telemetry_init ********
+ *
+ * Set up the record queue
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called once on core0 before the render core starts
+ ************************/
+void telemetry_init(void)
+{
+        spsc_init(&tlm_queue, tlm_queue_buf, sizeof(TelemetryRecord),
+                  TLM_QUEUE_LEN);
+}
+
+/********** telemetry_record ********
+ *
+ * Record one update or page entry
+ *
+ * Parameters:
+ *      TelemetryType type: TLM_REC_TICK or TLM_REC_ENTER
+ *      uint page:          page index
+ *      uint32_t t_us:      time_us_32 when the work started
+ *      uint32_t dur_us:    how long it took
+ *      uint32_t work:      page work count, 0 if none
+ *      uint8_t flags:      TLM_FLAG_* bits
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on the render core only
+ *
+ * Notes:
+ *      The pixel count is taken even while the stream is off,
+ *      so the first record after enabling covers only its own
+ *      interval rather than everything since boot
+ *      Wakes the control core with SCHED_EV_TLM to drain it
+ ************************/
+void telemetry_record(TelemetryType type, uint page, uint32_t t_us,
+                      uint32_t dur_us, uint32_t work, uint8_t flags)
+{
+        uint32_t pixels = dispmon_take_pixels();
+
+        if (enabled == false) {
+                return;
+        }
+
+        TelemetryRecord r = {
+                .type    = (uint8_t)type,
+                .page    = (uint8_t)page,
+                .t_us    = t_us,
+                .dur_us  = dur_us,
+                .pixels  = pixels,
+                .work    = work,
+                .dropped = dropped,
+                .flags   = flags,
+        };
+        seal(&r);
+
+        if (spsc_push(&tlm_queue, &r) == false) {
+                dropped++;
+                return;
+        }
+        sched_post(SCHED_CORE_CONTROL, SCHED_EV_TLM);
+}
+
+/********** telemetry_enable ********
+ *
+ * Start or stop the stream
+ *
+ * Parameters:
+ *      bool on: true to start
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on core0
+ *
+ * Notes:
+ *      Starting queues a HELLO record ahead of any others
+ ************************/
+void telemetry_enable(bool on)
+{
+        hello_pending = on;
+        enabled = on;
+}
+
+/********** telemetry_drain ********
+ *
+ * Write queued records to USB without blocking
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called from the control core loop
+ *
+ * Notes:
+ *      Stops as soon as the CDC buffer cannot take a whole
+ *      record, leaving the rest for the next pass
+ *      With the stream off or no host attached, queued
+ *      records are discarded
+ ************************/
+void telemetry_drain(void)
+{
+        TelemetryRecord r;
+
+        if (enabled == false || tud_cdc_connected() == false) {
+                while (spsc_pop(&tlm_queue, &r)) {
+                }
+                return;
+        }
+
+        if (hello_pending) {
+                if (tud_cdc_write_available() < sizeof(r)) {
+                        return;
+                }
+                r = (TelemetryRecord){
+                        .type   = TLM_REC_HELLO,
+                        .t_us   = time_us_32(),
+                        .dur_us = spi_get_baudrate(spi0),
+                        .work   = page_count,
+                };
+                seal(&r);
+                send(&r);
+                hello_pending = false;
+        }
+
+        while (tud_cdc_write_available() >= sizeof(r) &&
+               spsc_pop(&tlm_queue, &r)) {
+                send(&r);
+        }
+}
@@ -0,0 +1,56 @@
+/**************************************************************
+ *
+ *                        telemetry.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the binary telemetry stream. The render
+ *     core records one fixed-size record per page update or
+ *     page entry; the control core writes them to USB while
+ *     the stream is enabled. See tools/telemetry.py.
+ *
+ **************************************************************/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+#define TLM_SYNC0 0xa5
+#define TLM_SYNC1 0x5a
+
+#define TLM_FLAG_MISSED  (1u << 0)
+#define TLM_FLAG_OVERRUN (1u << 1)
+
+typedef enum {
+        TLM_REC_HELLO,
+        TLM_REC_TICK,
+        TLM_REC_ENTER
+} TelemetryType;
+
+/* little-endian on the wire; check makes the byte sum 0 mod 256 */
+typedef struct {
+        uint8_t sync0;
+        uint8_t sync1;
+        uint8_t type;
+        uint8_t page;
+        uint32_t t_us;
+        uint32_t dur_us;
+        uint32_t pixels;
+        uint32_t work;
+        uint16_t dropped;
+        uint8_t flags;
+        uint8_t check;
+} TelemetryRecord;
+
+_Static_assert(sizeof(TelemetryRecord) == 24, "telemetry record layout");
+
+void telemetry_init(void);
+void telemetry_record(TelemetryType type, uint page, uint32_t t_us,
+                      uint32_t dur_us, uint32_t work, uint8_t flags);
+void telemetry_enable(bool on);
+void telemetry_drain(void);
+
+#endif
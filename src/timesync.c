@@ -0,0 +1,449 @@
+/**************************************************************
+ *
+ *                         timesync.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Drift-corrected software clock on the 64-bit timer.
+ *
+ *     A host client (tools/timesync.py) probes the local timer
+ *     over USB, measures the round trip, and sends back a
+ *     sample: the local timer value and the host UTC time at
+ *     the middle of the round trip. The last SYNC_SAMPLES
+ *     samples with a round trip close to the best one are
+ *     fitted by least squares, host = a + b * local, giving
+ *     the crystal drift (b - 1) and where the clock should be
+ *     now.
+ *
+ *     The clock runs at the fitted rate. A remaining offset is
+ *     removed by running up to SYNC_SLEW_PPB faster or slower
+ *     until it is gone, so time never jumps or runs backwards.
+ *     Only the first sync, a T command, or an error above
+ *     SYNC_STEP_US steps the clock.
+ *
+ *     The clock state is written on core0 only and read from
+ *     both cores through a sequence lock.
+ *
+ **************************************************************/
+
+#include "timesync.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+#define SYNC_SAMPLES       16
+#define SYNC_MAX_RTT_US    50000
+#define SYNC_RTT_SLACK_US  500
+#define SYNC_MIN_SPAN_US   10000000
+#define SYNC_STEP_US       1000000
+#define SYNC_SLEW_PPB      500000
+#define SYNC_MAX_DRIFT_PPB 1000000
+
+#define PPB 1000000000LL
+
+typedef struct {
+        uint64_t local_us;
+        int64_t host_us;
+        uint32_t rtt_us;
+} SyncSample;
+
+typedef struct {
+        bool valid;
+        uint64_t local0;
+        int64_t utc0;
+        int32_t drift_ppb;
+        int32_t slew_ppb;
+        uint64_t slew_len_us;
+} SoftClock;
+
+static SyncSample samples[SYNC_SAMPLES];
+static uint sample_count = 0;
+static uint sample_next = 0;
+static uint samples_used = 0;
+static int64_t last_error_us = 0;
+static uint32_t steps = 0;
+
+static SoftClock sclock;
+static volatile uint32_t sclock_seq = 0;
+
+static int64_t scale_ppb(int64_t dt, int32_t ppb);
+static int64_t clock_at(const SoftClock *c, uint64_t local_us);
+static SoftClock read_clock(void);
+static void write_clock(const SoftClock *c);
+static int64_t fit_target(uint64_t now, int32_t *drift_ppb);
+
+/********** scale_ppb ********
+ *
+ * Scale a time span by a rate in parts per billion
+ *
+ * Parameters:
+ *      int64_t dt:  span in microseconds, >= 0
+ *      int32_t ppb: rate
+ *
+ * Return: dt * ppb / PPB, truncated toward zero
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Splits dt at PPB so the product cannot overflow: dt *
+ *      ppb alone overflows after about 106 days at the
+ *      1e6 ppb drift clamp
+ ************************/
+static int64_t scale_ppb(int64_t dt, int32_t ppb)
+{
+        return dt / PPB * ppb + dt % PPB * ppb / PPB;
+}
+
+/********** clock_at ********
+ *
+ * Evaluate a software clock at a local timer value
+ *
+ * Parameters:
+ *      const SoftClock *c: clock state
+ *      uint64_t local_us:  time_us_64 value
+ *
+ * Return: UTC microseconds
+ *
+ * Expects:
+ *      c->valid and local_us >= c->local0
+ *
+ * Notes:
+ *      The slew only applies for its first slew_len_us after
+ *      the anchor; after that the clock runs at the drift rate
+ ************************/
+static int64_t clock_at(const SoftClock *c, uint64_t local_us)
+{
+        int64_t dt = (int64_t)(local_us - c->local0);
+        int64_t ds = dt < (int64_t)c->slew_len_us ? dt :
+                     (int64_t)c->slew_len_us;
+
+        return c->utc0 + dt + scale_ppb(dt, c->drift_ppb) +
+               scale_ppb(ds, c->slew_ppb);
+}
+
+/********** read_clock ********
+ *
+ * Take a consistent copy of the clock state
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: clock state
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Retries while core0 is in the middle of an update
+ ************************/
+static SoftClock read_clock(void)
+{
+        SoftClock c;
+        uint32_t seq;
+
+        do {
+                seq = sclock_seq;
+                __dmb();
+                c = sclock;
+                __dmb();
+        } while ((seq & 1) || seq != sclock_seq);
+
+        return c;
+}
+
+/********** write_clock ********
+ *
+ * Publish new clock state
+ *
+ * Parameters:
+ *      const SoftClock *c: new state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on core0 only
+ ************************/
+static void write_clock(const SoftClock *c)
+{
+        sclock_seq++;
+        __dmb();
+        sclock = *c;
+        __dmb();
+        sclock_seq++;
+}
+
+/********** timesync_step ********
+ *
+ * Set the clock immediately
+ *
+ * Parameters:
+ *      int64_t utc_us: current UTC time in microseconds
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on core0
+ *
+ * Notes:
+ *      Keeps the drift estimate and cancels any slew
+ ************************/
+void timesync_step(int64_t utc_us)
+{
+        SoftClock c = read_clock();
+
+        c.valid = true;
+        c.local0 = time_us_64();
+        c.utc0 = utc_us;
+        c.slew_ppb = 0;
+        c.slew_len_us = 0;
+        write_clock(&c);
+        steps++;
+}
+
+/********** timesync_invalidate ********
+ *
+ * Forget the time after the local timer has stopped
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      Called on core0
+ *
+ * Notes:
+ *      Keeps the drift estimate but drops the stored
+ *      samples, whose local times no longer line up with the
+ *      host's; the next T command or sample sets the clock
+ ************************/
+void timesync_invalidate(void)
+{
+        SoftClock c = read_clock();
+
+        c.valid = false;
+        c.slew_ppb = 0;
+        c.slew_len_us = 0;
+        write_clock(&c);
+        sample_count = 0;
+        sample_next = 0;
+        samples_used = 0;
+}
+
+/********** fit_target ********
+ *
+ * Estimate host time now from the stored samples
+ *
+ * Parameters:
+ *      uint64_t now:       time_us_64 value to evaluate at
+ *      int32_t *drift_ppb: set to the fitted drift, or left
+ *                          alone if the samples span too
+ *                          little time to fit a rate
+ *
+ * Return: estimated UTC microseconds at now
+ *
+ * Expects:
+ *      sample_count > 0
+ *
+ * Notes:
+ *      Samples whose round trip is more than twice the best
+ *      one (plus slack) are left out, since their midpoint
+ *      is the least certain
+ *      Coordinates are taken relative to the newest sample so
+ *      doubles keep microsecond precision
+ ************************/
+static int64_t fit_target(uint64_t now, int32_t *drift_ppb)
+{
+        const SyncSample *ref = &samples[(sample_next + SYNC_SAMPLES - 1) %
+                                         SYNC_SAMPLES];
+        uint32_t min_rtt = UINT32_MAX;
+
+        for (uint i = 0; i < sample_count; i++) {
+                if (samples[i].rtt_us < min_rtt) {
+                        min_rtt = samples[i].rtt_us;
+                }
+        }
+        uint32_t max_rtt = 2 * min_rtt + SYNC_RTT_SLACK_US;
+
+        double sx = 0, sy = 0;
+        double first = 0, last = 0;
+        uint n = 0;
+
+        for (uint i = 0; i < sample_count; i++) {
+                if (samples[i].rtt_us > max_rtt) {
+                        continue;
+                }
+                double x = (double)(int64_t)(samples[i].local_us -
+                                             ref->local_us);
+                sx += x;
+                sy += (double)(samples[i].host_us - ref->host_us);
+                if (n == 0 || x < first) {
+                        first = x;
+                }
+                if (n == 0 || x > last) {
+                        last = x;
+                }
+                n++;
+        }
+        samples_used = n;
+
+        double mx = sx / n;
+        double my = sy / n;
+        double rate = 1.0 + (double)*drift_ppb / PPB;
+
+        if (n >= 2 && last - first >= SYNC_MIN_SPAN_US) {
+                double sxx = 0, sxy = 0;
+
+                for (uint i = 0; i < sample_count; i++) {
+                        if (samples[i].rtt_us > max_rtt) {
+                                continue;
+                        }
+                        double x = (double)(int64_t)(samples[i].local_us -
+                                                     ref->local_us) - mx;
+                        double y = (double)(samples[i].host_us -
+                                            ref->host_us) - my;
+                        sxx += x * x;
+                        sxy += x * y;
+                }
+
+                double ppb = (sxy / sxx - 1.0) * PPB;
+                if (ppb > SYNC_MAX_DRIFT_PPB) {
+                        ppb = SYNC_MAX_DRIFT_PPB;
+                } else if (ppb < -SYNC_MAX_DRIFT_PPB) {
+                        ppb = -SYNC_MAX_DRIFT_PPB;
+                }
+                *drift_ppb = (int32_t)ppb;
+                rate = 1.0 + ppb / PPB;
+        }
+
+        double x_now = (double)(int64_t)(now - ref->local_us);
+        return ref->host_us + (int64_t)(my + (x_now - mx) * rate);
+}
+
+/********** timesync_sample ********
+ *
+ * Add a host time sample and steer the clock
+ *
+ * Parameters:
+ *      uint64_t local_us: time_us_64 value reported by a probe
+ *      int64_t host_us:   host UTC microseconds at the middle
+ *                         of that probe's round trip
+ *      uint32_t rtt_us:   probe round-trip time
+ *
+ * Return: true if accepted, false if the round trip was too
+ *         long or the local time is in the future
+ *
+ * Expects:
+ *      Called on core0
+ *
+ * Notes:
+ *      The clock is re-anchored at its current value, so the
+ *      change of rate never makes it jump
+ ************************/
+bool timesync_sample(uint64_t local_us, int64_t host_us, uint32_t rtt_us)
+{
+        uint64_t now = time_us_64();
+
+        if (rtt_us > SYNC_MAX_RTT_US || local_us > now) {
+                return false;
+        }
+
+        samples[sample_next] = (SyncSample){ local_us, host_us, rtt_us };
+        sample_next = (sample_next + 1) % SYNC_SAMPLES;
+        if (sample_count < SYNC_SAMPLES) {
+                sample_count++;
+        }
+
+        SoftClock c = read_clock();
+        int32_t drift = c.drift_ppb;
+        int64_t target = fit_target(now, &drift);
+        int64_t current = c.valid ? clock_at(&c, now) : target;
+        int64_t err = target - current;
+
+        last_error_us = err;
+        c.drift_ppb = drift;
+        c.local0 = now;
+
+        if (c.valid == false || err > SYNC_STEP_US || err < -SYNC_STEP_US) {
+                c.valid = true;
+                c.utc0 = target;
+                c.slew_ppb = 0;
+                c.slew_len_us = 0;
+                steps++;
+        } else {
+                c.utc0 = current;
+                c.slew_ppb = err >= 0 ? SYNC_SLEW_PPB : -SYNC_SLEW_PPB;
+                c.slew_len_us = (uint64_t)((err >= 0 ? err : -err) *
+                                           PPB / SYNC_SLEW_PPB);
+        }
+
+        write_clock(&c);
+        return true;
+}
+
+/********** timesync_now ********
+ *
+ * Read the software clock
+ *
+ * Parameters:
+ *      int64_t *utc_us: set to UTC microseconds
+ *
+ * Return: false if the clock has never been set
+ *
+ * Expects:
+ *      utc_us is not NULL
+ *
+ * Notes:
+ *      Safe on either core
+ ************************/
+bool timesync_now(int64_t *utc_us)
+{
+        SoftClock c = read_clock();
+
+        if (c.valid == false) {
+                return false;
+        }
+
+        *utc_us = clock_at(&c, time_us_64());
+        return true;
+}
+
+/********** timesync_report ********
+ *
+ * Print the drift estimate and slew state
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      stdio initialized
+ *
+ * Notes:
+ *      drift= is the crystal's error, positive when the local
+ *      timer runs fast
+ *      offset= is the error found at the last sample; slew=
+ *      is how much of it is still to be removed
+ ************************/
+void timesync_report(void)
+{
+        SoftClock c = read_clock();
+        int64_t left = 0;
+        uint64_t dt = time_us_64() - c.local0;
+
+        if (dt < c.slew_len_us) {
+                left = scale_ppb((int64_t)(c.slew_len_us - dt), c.slew_ppb);
+        }
+
+        int32_t ppb = -c.drift_ppb;
+        uint32_t mag = (uint32_t)(ppb < 0 ? -ppb : ppb);
+
+        printf("SYNC n=%u used=%u steps=%lu drift=%s%lu.%03luppm "
+               "offset=%lldus slew=%lldus\n",
+               sample_count, samples_used, (unsigned long)steps,
+               ppb < 0 ? "-" : "", (unsigned long)(mag / 1000),
+               (unsigned long)(mag % 1000), (long long)last_error_us,
+               (long long)left);
+}
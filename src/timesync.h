@@ -0,0 +1,26 @@
+/**************************************************************
+ *
+ *                         timesync.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the drift-corrected software clock. Host
+ *     time samples taken over USB are fitted against the local
+ *     64-bit microsecond timer, and the clock is slewed toward
+ *     the fit instead of being stepped.
+ *
+ **************************************************************/
+
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void timesync_step(int64_t utc_us);
+void timesync_invalidate(void);
+bool timesync_sample(uint64_t local_us, int64_t host_us, uint32_t rtt_us);
+bool timesync_now(int64_t *utc_us);
+void timesync_report(void);
+
+#endif
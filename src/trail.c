@@ -0,0 +1,299 @@
+/**************************************************************
+ *
+ *                          trail.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Motion trails for the ball page. Fading the whole
+ *     screen would mean resending all of it over SPI every
+ *     frame, so only rows a ball has recently crossed are
+ *     tracked: each gets one of TRAIL_ROWS slots, a byte of
+ *     intensity per pixel, for as long as anything in it is
+ *     lit. A row that cannot get a slot simply has no trail.
+ *
+ *     Each frame every lit word of every slot is decayed four
+ *     pixels at a time: v -= v / 4 per byte, then bytes below
+ *     16 (invisible at the 16 blend levels) are cleared so
+ *     the row eventually frees its slot. A full stamp fades
+ *     out in about ten frames.
+ *
+ *     Each row remembers the pixel range that changed this
+ *     frame; the ball page collects those ranges and resends
+ *     only them, drawing trail pixels through the blend table
+ *     of the first ball's color.
+ *
+ *     Used on the render core only.
+ *
+ **************************************************************/
+
+#include "trail.h"
+#include "../lib/src/ST7789/hardware.h"
+
+#define TRAIL_WORDS (SCREEN_WIDTH / 4)
+#define NO_SLOT     0xff
+
+static uint32_t slots[TRAIL_ROWS][TRAIL_WORDS];
+static uint8_t free_slots[TRAIL_ROWS];
+static uint free_n;
+
+static uint8_t slot_of[SCREEN_HEIGHT];
+static uint8_t lit_lo[SCREEN_HEIGHT];
+static uint8_t lit_hi[SCREEN_HEIGHT];
+static int16_t changed_lo[SCREEN_HEIGHT];
+static int16_t changed_hi[SCREEN_HEIGHT];
+
+static inline uint32_t decay4(uint32_t v);
+static void mark_changed(int y, int x0, int x1);
+
+/********** decay4 ********
+ *
+ * Fade four packed intensities by a quarter
+ *
+ * Parameters:
+ *      uint32_t v: four 8-bit intensities
+ *
+ * Return: faded intensities, bytes below 16 cleared
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      v / 4 <= v, so the subtraction never borrows across
+ *      bytes; the high nibble of each byte is then folded
+ *      into its bit 0 to build a keep mask
+ ************************/
+static inline uint32_t decay4(uint32_t v)
+{
+        v -= (v >> 2) & 0x3f3f3f3fu;
+
+        uint32_t h = (v >> 4) & 0x0f0f0f0fu;
+        h |= h >> 1;
+        h |= h >> 2;
+        return v & ((h & 0x01010101u) * 0xffu);
+}
+
+/********** mark_changed ********
+ *
+ * Widen a row's changed range
+ *
+ * Parameters:
+ *      int y:      screen row
+ *      int x0, x1: changed pixels (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= y < SCREEN_HEIGHT
+ ************************/
+static void mark_changed(int y, int x0, int x1)
+{
+        if (x0 < changed_lo[y]) {
+                changed_lo[y] = (int16_t)x0;
+        }
+        if (x1 > changed_hi[y]) {
+                changed_hi[y] = (int16_t)x1;
+        }
+}
+
+/********** trail_reset ********
+ *
+ * Forget every trail
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      The screen no longer shows any trail
+ ************************/
+void trail_reset(void)
+{
+        for (uint i = 0; i < TRAIL_ROWS; i++) {
+                free_slots[i] = (uint8_t)i;
+        }
+        free_n = TRAIL_ROWS;
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                slot_of[y] = NO_SLOT;
+                changed_lo[y] = SCREEN_WIDTH;
+                changed_hi[y] = -1;
+        }
+}
+
+/********** trail_decay ********
+ *
+ * Fade every trail by one frame
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      trail_reset has been called
+ *
+ * Notes:
+ *      Only the lit words of each slot are visited; rows left
+ *      dark give their slot back, but keep their changed range
+ *      so the last faded pixels are still cleared on screen
+ ************************/
+void trail_decay(void)
+{
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                if (slot_of[y] == NO_SLOT) {
+                        continue;
+                }
+
+                uint32_t *row = slots[slot_of[y]];
+                int lo = TRAIL_WORDS;
+                int hi = -1;
+
+                for (int w = lit_lo[y]; w <= lit_hi[y]; w++) {
+                        uint32_t v = row[w];
+
+                        if (v == 0) {
+                                continue;
+                        }
+                        v = decay4(v);
+                        row[w] = v;
+                        if (v != 0) {
+                                if (w < lo) {
+                                        lo = w;
+                                }
+                                hi = w;
+                        }
+                }
+                mark_changed(y, lit_lo[y] * 4, lit_hi[y] * 4 + 3);
+
+                if (hi < 0) {
+                        free_slots[free_n++] = slot_of[y];
+                        slot_of[y] = NO_SLOT;
+                } else {
+                        lit_lo[y] = (uint8_t)lo;
+                        lit_hi[y] = (uint8_t)hi;
+                }
+        }
+}
+
+/********** trail_stamp ********
+ *
+ * Light a disc at full intensity
+ *
+ * Parameters:
+ *      int cx, cy:               disc center in pixels
+ *      int r:                    radius in pixels
+ *      const CircleTable *shape: circle tables for r
+ *
+ * Return: none
+ *
+ * Expects:
+ *      trail_reset has been called
+ *
+ * Notes:
+ *      Clipped to the screen; rows that find no free slot
+ *      are skipped
+ ************************/
+void trail_stamp(int cx, int cy, int r, const CircleTable *shape)
+{
+        for (int dy = -r; dy <= r; dy++) {
+                int y = cy + dy;
+
+                if (y < 0 || y >= SCREEN_HEIGHT) {
+                        continue;
+                }
+
+                int hw = shape->halfw[dy < 0 ? -dy : dy];
+                int x0 = cx - hw < 0 ? 0 : cx - hw;
+                int x1 = cx + hw >= SCREEN_WIDTH ? SCREEN_WIDTH - 1 : cx + hw;
+
+                if (x0 > x1) {
+                        continue;
+                }
+                if (slot_of[y] == NO_SLOT) {
+                        if (free_n == 0) {
+                                continue;
+                        }
+                        uint8_t s = free_slots[--free_n];
+                        for (uint w = 0; w < TRAIL_WORDS; w++) {
+                                slots[s][w] = 0;
+                        }
+                        slot_of[y] = s;
+                        lit_lo[y] = (uint8_t)(x0 / 4);
+                        lit_hi[y] = (uint8_t)(x1 / 4);
+                }
+
+                uint8_t *px = (uint8_t *)slots[slot_of[y]];
+                for (int x = x0; x <= x1; x++) {
+                        px[x] = 0xff;
+                }
+                if (x0 / 4 < lit_lo[y]) {
+                        lit_lo[y] = (uint8_t)(x0 / 4);
+                }
+                if (x1 / 4 > lit_hi[y]) {
+                        lit_hi[y] = (uint8_t)(x1 / 4);
+                }
+                mark_changed(y, x0, x1);
+        }
+}
+
+/********** trail_take_row ********
+ *
+ * Collect and clear a row's changed range
+ *
+ * Parameters:
+ *      int y:       screen row
+ *      int *x0:     first changed pixel, set if any changed
+ *      int *x1:     last changed pixel, set if any changed
+ *
+ * Return: true if part of the row changed since the last take
+ *
+ * Expects:
+ *      0 <= y < SCREEN_HEIGHT
+ ************************/
+bool trail_take_row(int y, int *x0, int *x1)
+{
+        if (changed_hi[y] < 0) {
+                return false;
+        }
+
+        *x0 = changed_lo[y];
+        *x1 = changed_hi[y];
+        changed_lo[y] = SCREEN_WIDTH;
+        changed_hi[y] = -1;
+        return true;
+}
+
+/********** trail_row_fill ********
+ *
+ * Paint a row's trail, or background, into a row buffer
+ *
+ * Parameters:
+ *      int y:               screen row
+ *      uint16_t *buf:       row buffer, indexed by screen x
+ *      int x0, x1:          pixels to paint (inclusive)
+ *      uint16_t bg_px:      background, byte-swapped
+ *      const uint16_t *lut: CIRCLE_LEVELS blend table of the
+ *                           trail color over the background
+ *
+ * Return: none
+ *
+ * Expects:
+ *      0 <= x0 <= x1 < SCREEN_WIDTH
+ ************************/
+void trail_row_fill(int y, uint16_t *buf, int x0, int x1, uint16_t bg_px,
+                    const uint16_t *lut)
+{
+        if (slot_of[y] == NO_SLOT) {
+                for (int x = x0; x <= x1; x++) {
+                        buf[x] = bg_px;
+                }
+                return;
+        }
+
+        const uint8_t *px = (const uint8_t *)slots[slot_of[y]];
+        for (int x = x0; x <= x1; x++) {
+                uint v = px[x];
+                buf[x] = v == 0 ? bg_px : lut[v >> 4];
+        }
+}
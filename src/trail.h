@@ -0,0 +1,33 @@
+/**************************************************************
+ *
+ *                          trail.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the ball page's motion trails: an 8-bit
+ *     intensity buffer over the rows balls recently crossed,
+ *     fading a little every frame.
+ *
+ **************************************************************/
+
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+#include "circle.h"
+
+#define TRAIL_ROWS 80
+
+/* row slots, then per screen row: slot, lit words, changed range */
+#define TRAIL_SCRATCH_BYTES (TRAIL_ROWS * 320 + TRAIL_ROWS + 240 * 7)
+
+void trail_reset(void);
+void trail_decay(void);
+void trail_stamp(int cx, int cy, int r, const CircleTable *shape);
+bool trail_take_row(int y, int *x0, int *x1);
+void trail_row_fill(int y, uint16_t *buf, int x0, int x1, uint16_t bg_px,
+                    const uint16_t *lut);
+
+#endif
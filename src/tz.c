@@ -0,0 +1,79 @@
+/**************************************************************
+ *
+ *                            tz.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     UTC offset lookup in the compiled transition table.
+ *     tz_transition_at is sorted, so a lookup is a binary
+ *     search for the last transition at or before the time.
+ *     The result is cached with the interval it holds for
+ *     (from that transition up to the next one), so the clock
+ *     page's once-a-second lookups are a range check.
+ *
+ *     Each core has its own cache entry, so no locking is
+ *     needed.
+ *
+ **************************************************************/
+
+#include "tz.h"
+#include "pico/platform.h"
+#include <stdbool.h>
+
+#define TZ_CORES 2
+
+typedef struct {
+        bool valid;
+        int64_t from;
+        int64_t until;
+        int32_t offset;
+} TzCache;
+
+static TzCache cache[TZ_CORES];
+
+/********** tz_offset_at ********
+ *
+ * UTC offset in effect at a given time
+ *
+ * Parameters:
+ *      int64_t utc: seconds since 1970-01-01 00:00:00 UTC
+ *
+ * Return: offset in seconds to add to UTC for local time
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Before the first transition the table's initial offset
+ *      applies; after the table's end year the last offset is
+ *      kept
+ ************************/
+int32_t tz_offset_at(int64_t utc)
+{
+        TzCache *c = &cache[get_core_num()];
+
+        if (c->valid && utc >= c->from && utc < c->until) {
+                return c->offset;
+        }
+
+        /* lo = number of transitions at or before utc */
+        uint lo = 0;
+        uint hi = tz_transition_count;
+        while (lo < hi) {
+                uint mid = (lo + hi) / 2;
+                if ((int64_t)tz_transition_at[mid] <= utc) {
+                        lo = mid + 1;
+                } else {
+                        hi = mid;
+                }
+        }
+
+        c->from = lo > 0 ? (int64_t)tz_transition_at[lo - 1] : INT64_MIN;
+        c->until = lo < tz_transition_count ?
+                   (int64_t)tz_transition_at[lo] : INT64_MAX;
+        c->offset = lo > 0 ? tz_transition_offset[lo - 1] :
+                    tz_initial_offset;
+        c->valid = true;
+
+        return c->offset;
+}
@@ -0,0 +1,28 @@
+/**************************************************************
+ *
+ *                            tz.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the compiled timezone table. The table is
+ *     generated from tzdata at build time by
+ *     tools/gen_tz_table.py.
+ *
+ **************************************************************/
+
+#ifndef TZ_H
+#define TZ_H
+
+#include <stdint.h>
+
+extern const char tz_name[];
+extern const uint32_t tz_table_start;
+extern const uint32_t tz_table_end;
+extern const int32_t tz_initial_offset;
+extern const uint16_t tz_transition_count;
+extern const uint32_t tz_transition_at[];
+extern const int32_t tz_transition_offset[];
+
+int32_t tz_offset_at(int64_t utc);
+
+#endif
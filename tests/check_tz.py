@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+check_tz.py
+
+Check src/tz.c against the host zoneinfo.
+
+Runs a tz_probe binary (tz.c linked with a table generated by
+tools/gen_tz_table.py for one zone) and compares every tz_offset_at
+result with the offset zoneinfo gives:
+
+- every 30 minutes from two days before the table start to two days
+  after its end;
+- every second from 2 s before to 2 s after each transition, ascending
+  on core 0 and descending on core 1, interleaved, so each core's
+  cached interval is hit at exactly its end (utc == until) and start;
+- times before the first transition and the table start, and after
+  2100, including a jump backwards across the whole table.
+
+Outside the table's years tz.c keeps the nearest offset it has (the
+initial offset before, the last one after), so that is what is
+expected there.
+
+Usage:
+    check_tz.py --zone Australia/Sydney --probe ./tz_probe_sydney
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import zoneinfo
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "tools"))
+from gen_tz_table import DAY, offset_at, transitions, year_start  # noqa: E402
+
+HALF_HOUR = 1800
+AROUND = 2
+MAX_REPORTS = 10
+
+
+def queries(zone, start, end):
+    """(core, epoch) pairs to ask the probe, in order."""
+    q = []
+    for t in range(start - 2 * DAY, end + 2 * DAY, HALF_HOUR):
+        q.append((0, t))
+
+    _, changes = transitions(zone, start, end)
+    for at, _ in changes:
+        for i in range(2 * AROUND + 1):
+            q.append((0, at - AROUND + i))
+            q.append((1, at + AROUND - i))
+
+    first = changes[0][0] if changes else end
+    for t in (first - 1, first, start, start - 1, 0, 1600000000,
+              end - 1, end, end + 1, 4102444800, 2 ** 32 - 1, 2 ** 40,
+              start, end, start - 1):
+        q.append((0, t))
+        q.append((1, t))
+    return q
+
+
+def expected(zone, start, end, t):
+    """Offset tz_offset_at should return at t."""
+    if t < start:
+        return offset_at(zone, start)
+    if t >= end:
+        return offset_at(zone, end - 1)
+    return offset_at(zone, t)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    ap.add_argument("--zone", required=True)
+    ap.add_argument("--probe", required=True)
+    ap.add_argument("--from", dest="first", type=int, default=2023)
+    ap.add_argument("--to", dest="last", type=int, default=2100)
+    args = ap.parse_args()
+
+    zone = zoneinfo.ZoneInfo(args.zone)
+    start = year_start(args.first)
+    end = year_start(args.last + 1)
+
+    q = queries(zone, start, end)
+    stdin = "".join("%d %d\n" % (core, t) for core, t in q)
+    out = subprocess.run([args.probe], input=stdin, capture_output=True,
+                         text=True, check=True).stdout.split("\n")
+
+    if out[0] != args.zone:
+        sys.exit("probe table is for %s, not %s" % (out[0], args.zone))
+    got = [int(line) for line in out[1:] if line]
+    if len(got) != len(q):
+        sys.exit("probe answered %d of %d queries" % (len(got), len(q)))
+
+    failures = 0
+    for (core, t), off in zip(q, got):
+        want = expected(zone, start, end, t)
+        if off != want:
+            if failures < MAX_REPORTS:
+                print("FAIL %s core %d at %d: got %d, want %d" %
+                      (args.zone, core, t, off, want), file=sys.stderr)
+            failures += 1
+
+    if failures:
+        sys.exit("%d of %d lookups wrong" % (failures, len(q)))
+    print("%s: %d lookups ok" % (args.zone, len(q)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,189 @@
+/**************************************************************
+ *
+ *                         cmd_fakes.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Recording stand-ins for the render, clock, telemetry and
+ *     report calls made by cmd.c, and a page table with the
+ *     firmware's page names. remote.c is not faked here: tests
+ *     link either remote_fakes.c or the real module.
+ *
+ **************************************************************/
+
+#include "cmd_fakes.h"
+#include "page.h"
+#include "render.h"
+#include "clock.h"
+#include "timesync.h"
+#include "telemetry.h"
+#include "latency.h"
+#include "monitor.h"
+#include "power.h"
+#include "split.h"
+#include "life.h"
+#include "plasma.h"
+#include "circle.h"
+#include "ball.h"
+#include "remote.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LOG_BYTES 65536
+
+bool fake_render_busy = false;
+
+static char log_buf[LOG_BYTES];
+static size_t log_len = 0;
+static uint selected = 0;
+
+static const PageDesc fake_clock = { .name = "clock" };
+static const PageDesc fake_quote = { .name = "quote" };
+static const PageDesc fake_ball = { .name = BALL_PAGE_NAME };
+static const PageDesc fake_mandel = { .name = "mandelbrot" };
+static const PageDesc fake_remote = { .name = REMOTE_PAGE_NAME };
+
+const PageDesc *const page_table[] = {
+        &fake_clock, &fake_quote, &fake_ball, &fake_mandel, &fake_remote,
+};
+const uint page_count = sizeof(page_table) / sizeof(page_table[0]);
+
+/********** fake_log_reset ********
+ *
+ * Empty the call log and reset the fakes' state
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+void fake_log_reset(void)
+{
+        log_len = 0;
+        log_buf[0] = '\0';
+        selected = 0;
+        fake_render_busy = false;
+}
+
+/********** fake_log ********
+ *
+ * The calls logged since the last reset, one per line
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: log text
+ *
+ * Expects:
+ *      none
+ ************************/
+const char *fake_log(void)
+{
+        return log_buf;
+}
+
+/********** fake_log_add ********
+ *
+ * Append one line to the call log
+ *
+ * Parameters:
+ *      const char *fmt: printf format, without newline
+ *
+ * Return: none
+ *
+ * Expects:
+ *      fmt is not NULL
+ ************************/
+void fake_log_add(const char *fmt, ...)
+{
+        va_list ap;
+
+        va_start(ap, fmt);
+        int n = vsnprintf(log_buf + log_len, LOG_BYTES - log_len - 1, fmt, ap);
+        va_end(ap);
+        if (n > 0 && log_len + (size_t)n + 2 < LOG_BYTES) {
+                log_len += (size_t)n;
+                log_buf[log_len++] = '\n';
+                log_buf[log_len] = '\0';
+        }
+}
+
+bool render_select_page(uint page, uint32_t edge_us)
+{
+        (void)edge_us;
+        if (fake_render_busy) {
+                return false;
+        }
+        selected = page;
+        fake_log_add("page %u", page);
+        return true;
+}
+
+uint render_selected_page(void)
+{
+        return selected;
+}
+
+bool render_set_colors(uint16_t bg, uint16_t text)
+{
+        if (fake_render_busy) {
+                return false;
+        }
+        fake_log_add("colors %04x %04x", bg, text);
+        return true;
+}
+
+bool render_capture(uint16_t tail_ms)
+{
+        if (fake_render_busy) {
+                return false;
+        }
+        fake_log_add("capture %u", tail_ms);
+        return true;
+}
+
+bool render_configure(uint page, uint16_t key, uint32_t value)
+{
+        if (fake_render_busy) {
+                return false;
+        }
+        fake_log_add("configure %u %u %lu", page, key, (unsigned long)value);
+        return true;
+}
+
+bool clock_set_epoch_utc(time_t epoch_utc)
+{
+        if (epoch_utc <= CLOCK_EPOCH_MIN || epoch_utc >= CLOCK_EPOCH_MAX) {
+                return false;
+        }
+        fake_log_add("epoch %lld", (long long)epoch_utc);
+        return true;
+}
+
+bool clock_sync_sample(uint64_t local_us, int64_t host_us, uint32_t rtt_us)
+{
+        fake_log_add("sync %llu %lld %lu", (unsigned long long)local_us,
+                     (long long)host_us, (unsigned long)rtt_us);
+        return rtt_us < 50000;
+}
+
+void telemetry_enable(bool on)
+{
+        fake_log_add("telemetry %d", on);
+}
+
+void timesync_report(void)   { fake_log_add("report C"); }
+void sched_report_idle(void) { fake_log_add("report I"); }
+void sched_report_timing(void) { fake_log_add("report J"); }
+void render_report_pages(void) { fake_log_add("report P"); }
+void latency_report(void)    { fake_log_add("report L"); }
+void monitor_report(void)    { fake_log_add("report W"); }
+void power_report(void)      { fake_log_add("report S"); }
+void split_report(void)      { fake_log_add("report X"); }
+void life_report(void)       { fake_log_add("report G"); }
+void plasma_report(void)     { fake_log_add("report F"); }
+void circle_bench(void)      { fake_log_add("report CIRCLE"); }
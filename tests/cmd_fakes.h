@@ -0,0 +1,26 @@
+/**************************************************************
+ *
+ *                         cmd_fakes.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the recording stand-ins of the modules
+ *     cmd.c dispatches to. Each call the command layer makes
+ *     is appended to a log as one line, so a test can check
+ *     both the replies and what was done.
+ *
+ **************************************************************/
+
+#ifndef CMD_FAKES_H
+#define CMD_FAKES_H
+
+#include <stdbool.h>
+
+/* when set, render_* calls fail as if the render queue were full */
+extern bool fake_render_busy;
+
+void fake_log_reset(void);
+const char *fake_log(void);
+void fake_log_add(const char *fmt, ...);
+
+#endif
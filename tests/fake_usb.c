@@ -0,0 +1,247 @@
+/**************************************************************
+ *
+ *                         fake_usb.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host stand-in for the USB CDC stdio driver. in_chars
+ *     hands out queued input in reads of a chosen size: all
+ *     that fits, or a pseudo-random 1 to max bytes, the way
+ *     real USB packets split a stream at arbitrary points.
+ *     out_chars appends to an output buffer the test reads;
+ *     the TinyUSB write room it reports can likewise be
+ *     limited to a pseudo-random amount per call.
+ *
+ **************************************************************/
+
+#include "fake_usb.h"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+#include <string.h>
+
+#define IN_BYTES  (1u << 22)
+#define OUT_BYTES (1u << 16)
+
+static uint8_t in_buf[IN_BYTES];
+static size_t in_head = 0;
+static size_t in_tail = 0;
+static uint32_t chunk_seed = 0;
+static size_t chunk_max = 0;
+static bool connected = true;
+static uint32_t room_seed = 0;
+static size_t room_max = 0;
+
+static char out_buf[OUT_BYTES];
+static size_t out_len = 0;
+
+static uint32_t next_rand(uint32_t *seed);
+static void out_chars(const char *buf, int len);
+static int in_chars(char *buf, int len);
+
+stdio_driver_t stdio_usb = { out_chars, in_chars };
+
+/********** fake_usb_reset ********
+ *
+ * Drop all queued input and output, read in one piece and
+ * report a connected host with unlimited write room
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+void fake_usb_reset(void)
+{
+        in_head = 0;
+        in_tail = 0;
+        chunk_seed = 0;
+        chunk_max = 0;
+        connected = true;
+        room_seed = 0;
+        room_max = 0;
+        out_len = 0;
+}
+
+/********** fake_usb_feed ********
+ *
+ * Queue bytes as if the host had sent them
+ *
+ * Parameters:
+ *      const void *data: bytes
+ *      size_t n:         byte count
+ *
+ * Return: none
+ *
+ * Expects:
+ *      All input queued since the last reset fits IN_BYTES
+ ************************/
+void fake_usb_feed(const void *data, size_t n)
+{
+        memcpy(in_buf + in_tail, data, n);
+        in_tail += n;
+}
+
+/********** fake_usb_chunks ********
+ *
+ * Choose how input is split into reads
+ *
+ * Parameters:
+ *      uint32_t seed: random sequence for read sizes
+ *      size_t max:    largest read; 0 reads all that fits
+ *
+ * Return: none
+ *
+ * Expects:
+ *      seed is not 0 when max is not 0
+ ************************/
+void fake_usb_chunks(uint32_t seed, size_t max)
+{
+        chunk_seed = seed;
+        chunk_max = max;
+}
+
+/********** fake_usb_connect ********
+ *
+ * Attach or detach the host
+ *
+ * Parameters:
+ *      bool on: whether tud_cdc_connected reports a host
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+void fake_usb_connect(bool on)
+{
+        connected = on;
+}
+
+/********** fake_usb_write_room ********
+ *
+ * Choose how much room tud_cdc_write_available reports
+ *
+ * Parameters:
+ *      uint32_t seed: random sequence for the room
+ *      size_t max:    most room reported; 0 for unlimited
+ *
+ * Return: none
+ *
+ * Expects:
+ *      seed is not 0 when max is not 0
+ *
+ * Notes:
+ *      Each call reports 0 to max bytes, as if the host had
+ *      read some of the CDC buffer in between
+ ************************/
+void fake_usb_write_room(uint32_t seed, size_t max)
+{
+        room_seed = seed;
+        room_max = max;
+}
+
+/********** fake_usb_pending ********
+ *
+ * Input not yet read
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: byte count
+ *
+ * Expects:
+ *      none
+ ************************/
+size_t fake_usb_pending(void)
+{
+        return in_tail - in_head;
+}
+
+/********** fake_usb_output ********
+ *
+ * Everything written since the last clear
+ *
+ * Parameters:
+ *      size_t *len: set to the byte count
+ *
+ * Return: output, NUL-terminated
+ *
+ * Expects:
+ *      len is not NULL
+ ************************/
+const char *fake_usb_output(size_t *len)
+{
+        out_buf[out_len] = '\0';
+        *len = out_len;
+        return out_buf;
+}
+
+/********** fake_usb_clear_output ********
+ *
+ * Forget the output written so far
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+void fake_usb_clear_output(void)
+{
+        out_len = 0;
+}
+
+bool tud_cdc_connected(void)
+{
+        return connected;
+}
+
+uint32_t tud_cdc_write_available(void)
+{
+        if (room_max == 0) {
+                return OUT_BYTES;
+        }
+        return next_rand(&room_seed) % (uint32_t)(room_max + 1);
+}
+
+static uint32_t next_rand(uint32_t *seed)
+{
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 17;
+        *seed ^= *seed << 5;
+        return *seed;
+}
+
+static void out_chars(const char *buf, int len)
+{
+        if (out_len + (size_t)len < OUT_BYTES) {
+                memcpy(out_buf + out_len, buf, (size_t)len);
+                out_len += (size_t)len;
+        }
+}
+
+static int in_chars(char *buf, int len)
+{
+        size_t n = in_tail - in_head;
+
+        if ((size_t)len < n) {
+                n = (size_t)len;
+        }
+        if (chunk_max != 0) {
+                size_t c = 1 + next_rand(&chunk_seed) % chunk_max;
+                if (c < n) {
+                        n = c;
+                }
+        }
+        if (n == 0) {
+                return 0;
+        }
+        memcpy(buf, in_buf + in_head, n);
+        in_head += n;
+        return (int)n;
+}
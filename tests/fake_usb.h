@@ -0,0 +1,30 @@
+/**************************************************************
+ *
+ *                         fake_usb.h
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Interface for the host stand-in of the USB CDC stdio
+ *     driver: tests queue input bytes, choose how they are
+ *     split into reads, how much room writes find, and
+ *     inspect what was written back.
+ *
+ **************************************************************/
+
+#ifndef FAKE_USB_H
+#define FAKE_USB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+void fake_usb_reset(void);
+void fake_usb_feed(const void *data, size_t n);
+void fake_usb_chunks(uint32_t seed, size_t max);
+void fake_usb_connect(bool on);
+void fake_usb_write_room(uint32_t seed, size_t max);
+size_t fake_usb_pending(void);
+const char *fake_usb_output(size_t *len);
+void fake_usb_clear_output(void);
+
+#endif
@@ -0,0 +1,70 @@
+/**************************************************************
+ *
+ *                        host_stubs.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Stand-ins for the SDK and timesync calls made by the
+ *     sources under test, so those files link unchanged off
+ *     target. The timer is a simulated clock that tests set
+ *     through host_time_us.
+ *
+ **************************************************************/
+
+#include "pico/platform.h"
+#include "pico/stdlib.h"
+#include "timesync.h"
+
+/* core the code under test believes it runs on */
+uint host_core_num = 0;
+
+/* what the timer reads */
+uint64_t host_time_us = 0;
+
+uint get_core_num(void)
+{
+        return host_core_num;
+}
+
+uint64_t time_us_64(void)
+{
+        return host_time_us;
+}
+
+uint32_t time_us_32(void)
+{
+        return (uint32_t)host_time_us;
+}
+
+absolute_time_t get_absolute_time(void)
+{
+        return host_time_us;
+}
+
+bool time_reached(absolute_time_t t)
+{
+        return host_time_us >= t;
+}
+
+void timesync_step(int64_t utc_us)
+{
+        (void)utc_us;
+}
+
+void timesync_invalidate(void)
+{
+}
+
+bool timesync_sample(uint64_t local_us, int64_t host_us, uint32_t rtt_us)
+{
+        (void)local_us;
+        (void)host_us;
+        (void)rtt_us;
+        return false;
+}
+
+bool timesync_now(int64_t *utc_us)
+{
+        (void)utc_us;
+        return false;
+}
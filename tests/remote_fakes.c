@@ -0,0 +1,41 @@
+/**************************************************************
+ *
+ *                        remote_fakes.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Stand-in for remote.c when only the text commands are
+ *     under test: every rectangle is refused as out of range,
+ *     so no pixel bytes are ever expected.
+ *
+ **************************************************************/
+
+#include "remote.h"
+#include "cmd_fakes.h"
+
+bool remote_begin(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+        fake_log_add("rect %u %u %u %u", x0, y0, x1, y1);
+        return false;
+}
+
+uint32_t remote_pending(void)
+{
+        return 0;
+}
+
+uint8_t *remote_rx_space(uint32_t *room)
+{
+        *room = 0;
+        return NULL;
+}
+
+void remote_rx_commit(uint32_t n)
+{
+        (void)n;
+}
+
+void remote_report(void)
+{
+        fake_log_add("report R");
+}
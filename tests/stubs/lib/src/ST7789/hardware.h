@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for the display library's ST7789/hardware.h: the
+ * two driver calls the host-tested sources make, provided by the
+ * test's panel model.
+ */
+
+#ifndef HOST_ST7789_HARDWARE_H
+#define HOST_ST7789_HARDWARE_H
+
+#include "pico/types.h"
+
+void set_address_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+void start_display_transfer(uint16_t *buf, size_t len);
+
+#endif
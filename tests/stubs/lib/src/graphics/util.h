@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for the display library's graphics/util.h: just
+ * what the host-tested sources use.
+ */
+
+#ifndef HOST_GRAPHICS_UTIL_H
+#define HOST_GRAPHICS_UTIL_H
+
+#include "pico/types.h"
+
+#define SCREEN_WIDTH  320
+#define SCREEN_HEIGHT 240
+
+void push_scanline_swapped_xy(uint16_t x, uint16_t y, uint16_t *buf,
+                              size_t len);
+
+#endif
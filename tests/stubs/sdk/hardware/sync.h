@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/sync.h. The host tests
+ * run on one thread, so barriers only need to stop the compiler.
+ */
+
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+static inline void __dmb(void)
+{
+        __asm__ volatile ("" ::: "memory");
+}
+
+#endif
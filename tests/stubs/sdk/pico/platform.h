@@ -0,0 +1,14 @@
+/* Host stand-in for the Pico SDK's pico/platform.h */
+
+#ifndef HOST_PICO_PLATFORM_H
+#define HOST_PICO_PLATFORM_H
+
+#include "pico/types.h"
+
+uint get_core_num(void);
+
+static inline void tight_loop_contents(void)
+{
+}
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for the Pico SDK's pico/stdio_usb.h. fake_usb.c
+ * provides the driver, fed and drained by the tests.
+ */
+
+#ifndef HOST_PICO_STDIO_USB_H
+#define HOST_PICO_STDIO_USB_H
+
+typedef struct stdio_driver {
+        void (*out_chars)(const char *buf, int len);
+        int (*in_chars)(char *buf, int len);
+} stdio_driver_t;
+
+extern stdio_driver_t stdio_usb;
+
+#endif
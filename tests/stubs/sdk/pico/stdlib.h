@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for the Pico SDK's pico/stdlib.h. The timer reads
+ * a simulated clock in host_stubs.c that tests advance by hand.
+ */
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include "pico/types.h"
+#include "pico/platform.h"
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+bool time_reached(absolute_time_t t);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for the Pico SDK's pico/types.h: just the types the
+ * host-tested sources use.
+ */
+
+#ifndef HOST_PICO_TYPES_H
+#define HOST_PICO_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+typedef struct {
+        int16_t year;
+        int8_t month;
+        int8_t day;
+        int8_t dotw;
+        int8_t hour;
+        int8_t min;
+        int8_t sec;
+} datetime_t;
+
+#endif
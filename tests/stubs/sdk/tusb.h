@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for TinyUSB's tusb.h: the CDC calls the sources
+ * under test make, answered by fake_usb.c.
+ */
+
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool tud_cdc_connected(void);
+uint32_t tud_cdc_write_available(void);
+
+#endif
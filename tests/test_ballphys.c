@@ -0,0 +1,288 @@
+/**************************************************************
+ *
+ *                       test_ballphys.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host check that ballphys.c is deterministic and behaves
+ *     physically.
+ *
+ *     Each replay case starts a world from a ball count,
+ *     radius and PHYS setting, optionally replaces the start
+ *     velocities from a fixed seed, runs a number of steps and
+ *     compares a hash of the whole state with a golden value.
+ *     Any change to the step's arithmetic or ordering changes
+ *     the hash; if a change is meant to alter trajectories,
+ *     run with --print and update the table.
+ *
+ *     It also checks that kinetic energy is conserved with
+ *     e = 1, no gravity and no friction, and that a ball
+ *     under gravity with e < 1 comes to rest on the floor.
+ *
+ **************************************************************/
+
+#include "ballphys.h"
+#include <stdio.h>
+#include <string.h>
+
+#define AREA_X0 4
+#define AREA_Y0 4
+#define AREA_X1 315
+#define AREA_Y1 235
+
+typedef struct {
+        uint count;
+        int r;
+        uint g, e, f;
+        uint32_t seed;
+        uint steps;
+        uint32_t hash;
+} Replay;
+
+/* seed 0 keeps ballphys_init's own start velocities */
+static const Replay replays[] = {
+        {  1, 12,    0, 1000, 1000, 0,           1000, 0x91a45d0eu },
+        {  1, 12,  250,  800,  990, 0,           1000, 0x6e645736u },
+        {  8,  6,    0, 1000, 1000, 0,           1000, 0x4e1b58b6u },
+        { 16,  6,  100,  900,  995, 0x1234abcdu, 1000, 0x20537a47u },
+        { 64,  6,    0, 1000, 1000, 0,           2000, 0xf35855d1u },
+        { 64,  6,  400,  700,  980, 0x9e3779b9u, 2000, 0x2a051f55u },
+        { 64, 16,   50, 1000,  999, 0x0badf00du, 1000, 0x6ce56d58u },
+};
+
+#define REPLAY_COUNT (sizeof(replays) / sizeof(replays[0]))
+
+static unsigned failures = 0;
+
+static void start(BallWorld *w, uint count, int r, uint g, uint e,
+                  uint f, uint32_t seed);
+static uint32_t hash_world(const BallWorld *w);
+static uint64_t energy(const BallWorld *w);
+static void check_replays(int print);
+static void check_energy(void);
+static void check_rest(void);
+
+/********** start ********
+ *
+ * Set up a world for a test case
+ *
+ * Parameters:
+ *      BallWorld *w:  world to fill
+ *      uint count:    balls
+ *      int r:         radius
+ *      uint g, e, f:  PHYS settings, thousandths
+ *      uint32_t seed: start velocity seed, 0 for the default
+ *
+ * Return: none
+ *
+ * Expects:
+ *      w is not NULL
+ ************************/
+static void start(BallWorld *w, uint count, int r, uint g, uint e,
+                  uint f, uint32_t seed)
+{
+        BallParams p;
+
+        ballphys_params(&p, g, e, f);
+        ballphys_init(w, count, r, AREA_X0, AREA_Y0, AREA_X1, AREA_Y1, &p);
+
+        for (uint i = 0; seed != 0 && i < w->count; i++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                w->vx[i] = (int32_t)(seed & 0x7ffff) - (1 << 18);
+                w->vy[i] = (int32_t)((seed >> 12) & 0x7ffff) - (1 << 18);
+        }
+}
+
+/********** hash_world ********
+ *
+ * FNV-1a hash of every ball's position, velocity and hits
+ *
+ * Parameters:
+ *      const BallWorld *w: world
+ *
+ * Return: hash
+ *
+ * Expects:
+ *      w is not NULL
+ ************************/
+static uint32_t hash_world(const BallWorld *w)
+{
+        uint32_t h = 2166136261u;
+
+        for (uint i = 0; i < w->count; i++) {
+                uint32_t v[5] = {
+                        (uint32_t)w->x[i], (uint32_t)w->y[i],
+                        (uint32_t)w->vx[i], (uint32_t)w->vy[i], w->hit[i]
+                };
+
+                for (uint k = 0; k < 5; k++) {
+                        for (uint b = 0; b < 32; b += 8) {
+                                h = (h ^ ((v[k] >> b) & 0xff)) * 16777619u;
+                        }
+                }
+        }
+        return h;
+}
+
+/********** energy ********
+ *
+ * Total kinetic energy, in Q16.16 speed squared
+ *
+ * Parameters:
+ *      const BallWorld *w: world
+ *
+ * Return: sum of vx^2 + vy^2
+ *
+ * Expects:
+ *      w is not NULL
+ ************************/
+static uint64_t energy(const BallWorld *w)
+{
+        uint64_t sum = 0;
+
+        for (uint i = 0; i < w->count; i++) {
+                sum += (uint64_t)((int64_t)w->vx[i] * w->vx[i]);
+                sum += (uint64_t)((int64_t)w->vy[i] * w->vy[i]);
+        }
+        return sum;
+}
+
+/********** check_replays ********
+ *
+ * Run every replay case and compare its final state hash
+ *
+ * Parameters:
+ *      int print: non-zero to print the hashes as table rows
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_replays(int print)
+{
+        static BallWorld w;
+
+        for (uint c = 0; c < REPLAY_COUNT; c++) {
+                const Replay *t = &replays[c];
+
+                start(&w, t->count, t->r, t->g, t->e, t->f, t->seed);
+                for (uint s = 0; s < t->steps; s++) {
+                        ballphys_step(&w);
+                }
+                uint32_t h = hash_world(&w);
+
+                if (print) {
+                        printf("{ %2u, %2d, %4u, %4u, %4u, 0x%08xu, %4u, "
+                               "0x%08xu },\n", t->count, t->r, t->g, t->e,
+                               t->f, t->seed, t->steps, h);
+                } else if (h != t->hash) {
+                        fprintf(stderr, "FAIL replay %u: hash 0x%08x, "
+                                "want 0x%08x\n", c, h, t->hash);
+                        failures++;
+                }
+        }
+}
+
+/********** check_energy ********
+ *
+ * Elastic, frictionless and weightless balls keep their energy
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Collision impulses are rounded to Q16.16, so energy
+ *      may drift by a rounding error per collision; it must
+ *      stay within 0.01% over the run (a single ball, which
+ *      only meets walls, keeps it exactly)
+ ************************/
+static void check_energy(void)
+{
+        static BallWorld w;
+        uint counts[] = { 1, 16, 64 };
+
+        for (uint c = 0; c < 3; c++) {
+                start(&w, counts[c], 6, 0, 1000, 1000, 0);
+                uint64_t e0 = energy(&w);
+                uint64_t lo = e0, hi = e0;
+
+                for (uint s = 0; s < 5000; s++) {
+                        ballphys_step(&w);
+                        uint64_t e = energy(&w);
+                        lo = e < lo ? e : lo;
+                        hi = e > hi ? e : hi;
+                }
+                if ((hi - lo) * 10000 > e0) {
+                        fprintf(stderr, "FAIL energy with %u balls: %llu "
+                                "to %llu, start %llu\n", counts[c],
+                                (unsigned long long)lo,
+                                (unsigned long long)hi,
+                                (unsigned long long)e0);
+                        failures++;
+                }
+        }
+}
+
+/********** check_rest ********
+ *
+ * A ball under gravity with e < 1 settles on the floor
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_rest(void)
+{
+        static BallWorld w;
+
+        start(&w, 1, 12, 500, 700, 950, 0);
+        for (uint s = 0; s < 3000; s++) {
+                ballphys_step(&w);
+        }
+
+        int32_t y = w.y[0];
+        for (uint s = 0; s < 100; s++) {
+                ballphys_step(&w);
+                if (w.y[0] != y || w.vx[0] != 0) {
+                        break;
+                }
+        }
+        if (w.y[0] != w.max_y || w.vx[0] != 0 ||
+            w.vy[0] > w.params.gravity || w.vy[0] < 0) {
+                fprintf(stderr, "FAIL rest: y=%ld (floor %ld) vx=%ld "
+                        "vy=%ld\n", (long)w.y[0], (long)w.max_y,
+                        (long)w.vx[0], (long)w.vy[0]);
+                failures++;
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        int print = argc > 1 && strcmp(argv[1], "--print") == 0;
+
+        check_replays(print);
+        if (print) {
+                return 0;
+        }
+        check_energy();
+        check_rest();
+
+        if (failures > 0) {
+                fprintf(stderr, "%u failures\n", failures);
+                return 1;
+        }
+        printf("ok\n");
+        return 0;
+}
@@ -0,0 +1,639 @@
+/**************************************************************
+ *
+ *                        test_capture.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host check of the screen capture encoder in capture.c.
+ *
+ *     Random address windows are filled with random pixel
+ *     transfers (solid, few-colour, noisy and long runs, split
+ *     at arbitrary points) while a capture runs. The chunks
+ *     written to the fake USB driver are decoded the way
+ *     tools/screenshot.py does and replayed onto a blank
+ *     frame, which must match a reference panel that applied
+ *     the same windows and pixels directly.
+ *
+ *     The "control core" drains the chunk ring from sched_post
+ *     only now and then, into a USB buffer with random room, so
+ *     the render side regularly finds the ring full and has to
+ *     wait. A solid full-screen fill must take the fewest runs
+ *     possible, and with no host attached nothing is written.
+ *
+ **************************************************************/
+
+#include "capture.h"
+#include "sched.h"
+#include "fake_usb.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH  320
+#define HEIGHT 240
+#define XFER_MAX 2048
+
+typedef struct {
+        uint16_t px[WIDTH * HEIGHT];
+        uint16_t x0, y0, x1, y1;
+        uint16_t x, y;
+} Panel;
+
+typedef struct {
+        Panel frame;
+        bool begun;
+        bool ended;
+        uint16_t width, height;
+        uint page;
+        uint32_t end_count;
+        uint32_t put_count;
+        uint32_t runs;
+        uint bad;
+} Decoded;
+
+static Panel ref;
+static Decoded dec;
+static uint32_t rng = 1;
+static uint32_t drain_odds = 1;
+static unsigned failures = 0;
+
+static uint32_t next_rand(void);
+static void panel_reset(Panel *p);
+static void panel_window(Panel *p, uint16_t x0, uint16_t y0, uint16_t x1,
+                         uint16_t y1);
+static void panel_put(Panel *p, uint16_t color);
+static void drain(void);
+static void decode(const uint8_t *b, size_t n);
+static void decode_chunk(uint8_t type, const uint8_t *p, uint len);
+static uint16_t get_u16(const uint8_t *p);
+static void send_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+static void send_pixels(const uint16_t *colors, size_t n);
+static uint fill(uint16_t *buf, uint n, uint mode);
+static void start(uint page);
+static void finish(void);
+static void check_random(uint32_t seed, size_t room);
+static void check_solid(void);
+static void check_detached(void);
+
+/********** next_rand ********
+ *
+ * Advance the test's random sequence
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: 32 pseudo-random bits
+ *
+ * Expects:
+ *      rng is not 0
+ ************************/
+static uint32_t next_rand(void)
+{
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+}
+
+/********** panel_reset ********
+ *
+ * Blank a panel model and open its full-screen window
+ *
+ * Parameters:
+ *      Panel *p: panel
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ ************************/
+static void panel_reset(Panel *p)
+{
+        memset(p->px, 0, sizeof(p->px));
+        panel_window(p, 0, 0, WIDTH - 1, HEIGHT - 1);
+}
+
+/********** panel_window ********
+ *
+ * Set a panel model's address window
+ *
+ * Parameters:
+ *      Panel *p:                panel
+ *      uint16_t x0, y0, x1, y1: window corners (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ ************************/
+static void panel_window(Panel *p, uint16_t x0, uint16_t y0, uint16_t x1,
+                         uint16_t y1)
+{
+        p->x0 = x0;
+        p->y0 = y0;
+        p->x1 = x1;
+        p->y1 = y1;
+        p->x = x0;
+        p->y = y0;
+}
+
+/********** panel_put ********
+ *
+ * Write one pixel at a panel model's cursor and advance it
+ *
+ * Parameters:
+ *      Panel *p:       panel
+ *      uint16_t color: RGB565, unswapped
+ *
+ * Return: none
+ *
+ * Expects:
+ *      p is not NULL
+ *
+ * Notes:
+ *      Fills the window row by row and wraps back to its top,
+ *      as the ST7789 and tools/screenshot.py do
+ ************************/
+static void panel_put(Panel *p, uint16_t color)
+{
+        if (p->x < WIDTH && p->y < HEIGHT) {
+                p->px[p->y * WIDTH + p->x] = color;
+        }
+        if (++p->x > p->x1) {
+                p->x = p->x0;
+                if (++p->y > p->y1) {
+                        p->y = p->y0;
+                }
+        }
+}
+
+/********** get_u16 ********
+ *
+ * Read a little-endian 16-bit field
+ *
+ * Parameters:
+ *      const uint8_t *p: field
+ *
+ * Return: value
+ *
+ * Expects:
+ *      p is not NULL
+ ************************/
+static uint16_t get_u16(const uint8_t *p)
+{
+        return (uint16_t)(p[0] | p[1] << 8);
+}
+
+/********** decode_chunk ********
+ *
+ * Apply one chunk to the decoded frame
+ *
+ * Parameters:
+ *      uint8_t type:     CaptureChunkType
+ *      const uint8_t *p: payload
+ *      uint len:         payload length
+ *
+ * Return: none
+ *
+ * Expects:
+ *      The chunk's checksum has been verified
+ *
+ * Notes:
+ *      Counts a wrong payload length, or any chunk outside a
+ *      BEGIN/END pair, as bad
+ ************************/
+static void decode_chunk(uint8_t type, const uint8_t *p, uint len)
+{
+        if (type == CAP_CHUNK_BEGIN) {
+                if (len != 5 || dec.begun) {
+                        dec.bad++;
+                        return;
+                }
+                dec.begun = true;
+                dec.width = get_u16(p);
+                dec.height = get_u16(p + 2);
+                dec.page = p[4];
+                panel_reset(&dec.frame);
+                return;
+        }
+        if (dec.begun == false || dec.ended) {
+                dec.bad++;
+                return;
+        }
+
+        switch (type) {
+        case CAP_CHUNK_WINDOW:
+                if (len != 8) {
+                        dec.bad++;
+                        return;
+                }
+                panel_window(&dec.frame, get_u16(p), get_u16(p + 2),
+                             get_u16(p + 4), get_u16(p + 6));
+                break;
+        case CAP_CHUNK_RUNS:
+                if (len == 0 || len % 3 != 0) {
+                        dec.bad++;
+                        return;
+                }
+                for (uint i = 0; i < len; i += 3) {
+                        if (p[i] == 0) {
+                                dec.bad++;
+                        }
+                        for (uint k = 0; k < p[i]; k++) {
+                                panel_put(&dec.frame, get_u16(p + i + 1));
+                        }
+                        dec.put_count += p[i];
+                        dec.runs++;
+                }
+                break;
+        case CAP_CHUNK_END:
+                if (len != 4) {
+                        dec.bad++;
+                        return;
+                }
+                dec.end_count = get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+                dec.ended = true;
+                break;
+        default:
+                dec.bad++;
+        }
+}
+
+/********** decode ********
+ *
+ * Split written bytes into chunks and apply them
+ *
+ * Parameters:
+ *      const uint8_t *b: bytes written to USB
+ *      size_t n:         byte count
+ *
+ * Return: none
+ *
+ * Expects:
+ *      b holds whole chunks, as capture_drain writes them
+ *
+ * Notes:
+ *      Unlike tools/screenshot.py nothing is skipped: every
+ *      byte must belong to a well-formed chunk
+ ************************/
+static void decode(const uint8_t *b, size_t n)
+{
+        size_t i = 0;
+
+        while (i < n) {
+                if (n - i < 5 || b[i] != CAP_SYNC0 || b[i + 1] != CAP_SYNC1 ||
+                    b[i + 3] > CAP_PAYLOAD_MAX || n - i < 5u + b[i + 3]) {
+                        dec.bad++;
+                        return;
+                }
+
+                uint len = b[i + 3];
+                uint8_t sum = 0;
+                for (uint k = 0; k < 5 + len; k++) {
+                        sum += b[i + k];
+                }
+                if (sum != 0) {
+                        dec.bad++;
+                } else {
+                        decode_chunk(b[i + 2], b + i + 4, len);
+                }
+                i += 5 + len;
+        }
+}
+
+/********** drain ********
+ *
+ * Act as the control core: write queued chunks and decode
+ * what reached USB
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void drain(void)
+{
+        size_t n;
+        const char *out;
+
+        capture_drain();
+        out = fake_usb_output(&n);
+        decode((const uint8_t *)out, n);
+        fake_usb_clear_output();
+}
+
+/********** sched_post ********
+ *
+ * Stand-in for the scheduler's cross-core event post
+ *
+ * Parameters:
+ *      uint core:       core to wake
+ *      uint32_t events: SCHED_EV_* bits
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      A SCHED_EV_SHOT to the control core drains the ring
+ *      one time in drain_odds, so capture.c sees it fill up
+ ************************/
+void sched_post(uint core, uint32_t events)
+{
+        if (core == SCHED_CORE_CONTROL && (events & SCHED_EV_SHOT) != 0 &&
+            next_rand() % drain_odds == 0) {
+                drain();
+        }
+}
+
+/********** send_window ********
+ *
+ * Open an address window, as the display monitor does
+ *
+ * Parameters:
+ *      uint16_t x0, y0, x1, y1: window corners (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void send_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+        capture_window(x0, y0, x1, y1);
+        panel_window(&ref, x0, y0, x1, y1);
+}
+
+/********** send_pixels ********
+ *
+ * Send pixels in transfers of random size, as the display
+ * monitor does
+ *
+ * Parameters:
+ *      const uint16_t *colors: RGB565, unswapped
+ *      size_t n:               pixel count
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Transfer buffers hold byte-swapped pixels
+ ************************/
+static void send_pixels(const uint16_t *colors, size_t n)
+{
+        static uint16_t xfer[XFER_MAX];
+        size_t done = 0;
+
+        while (done < n) {
+                size_t len = 1 + next_rand() % XFER_MAX;
+                if (len > n - done) {
+                        len = n - done;
+                }
+                for (size_t i = 0; i < len; i++) {
+                        uint16_t c = colors[done + i];
+                        xfer[i] = (uint16_t)(c << 8 | c >> 8);
+                        panel_put(&ref, c);
+                }
+                capture_pixels(xfer, len);
+                done += len;
+        }
+}
+
+/********** fill ********
+ *
+ * Make pixels for one window
+ *
+ * Parameters:
+ *      uint16_t *buf: pixels out
+ *      uint n:        pixel count
+ *      uint mode:     0 solid, 1 three colours, 2 noise, 3 long
+ *                     runs around the 255-pixel run limit
+ *
+ * Return: n
+ *
+ * Expects:
+ *      buf holds n pixels
+ ************************/
+static uint fill(uint16_t *buf, uint n, uint mode)
+{
+        uint16_t palette[3] = {
+                (uint16_t)next_rand(), (uint16_t)next_rand(), 0xffff,
+        };
+        uint16_t c = palette[0];
+        uint left = 0;
+
+        for (uint i = 0; i < n; i++) {
+                switch (mode) {
+                case 0:
+                        buf[i] = palette[0];
+                        break;
+                case 1:
+                        buf[i] = palette[next_rand() % 3];
+                        break;
+                case 2:
+                        buf[i] = (uint16_t)next_rand();
+                        break;
+                default:
+                        if (left == 0) {
+                                c = palette[next_rand() % 3];
+                                left = 250 + next_rand() % 12;
+                        }
+                        buf[i] = c;
+                        left--;
+                }
+        }
+        return n;
+}
+
+/********** start ********
+ *
+ * Begin a capture on a blank reference panel
+ *
+ * Parameters:
+ *      uint page: page number to report
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void start(uint page)
+{
+        memset(&dec, 0, sizeof(dec));
+        panel_reset(&ref);
+        capture_begin(page, WIDTH, HEIGHT);
+}
+
+/********** finish ********
+ *
+ * End the capture and write out everything still queued
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      start has been called
+ ************************/
+static void finish(void)
+{
+        capture_end();
+        fake_usb_write_room(0, 0);
+        drain();
+}
+
+/********** check_random ********
+ *
+ * Capture random windows and transfers and compare the
+ * decoded frame with the reference panel
+ *
+ * Parameters:
+ *      uint32_t seed: random sequence
+ *      size_t room:   most USB write room per drain, 0 for
+ *                     unlimited
+ *
+ * Return: none
+ *
+ * Expects:
+ *      seed is not 0
+ ************************/
+static void check_random(uint32_t seed, size_t room)
+{
+        static uint16_t colors[WIDTH * HEIGHT + WIDTH];
+        uint32_t sent = 0;
+        uint page = seed % 9;
+
+        rng = seed;
+        fake_usb_reset();
+        fake_usb_write_room(seed * 7 + 1, room);
+        drain_odds = room == 0 ? 1 : 5;
+
+        /* not part of the capture */
+        capture_window(0, 0, 9, 9);
+        capture_pixels(colors, 100);
+
+        start(page);
+        for (uint w = 0; w < 200; w++) {
+                uint16_t x0 = (uint16_t)(next_rand() % WIDTH);
+                uint16_t y0 = (uint16_t)(next_rand() % HEIGHT);
+                uint16_t x1 = (uint16_t)(x0 + next_rand() % (WIDTH - x0));
+                uint16_t y1 = (uint16_t)(y0 + next_rand() % (HEIGHT - y0));
+                uint area = (uint)(x1 - x0 + 1) * (y1 - y0 + 1);
+                uint n = area;
+
+                if (next_rand() % 8 == 0) {
+                        n = (uint)(next_rand() % (area + WIDTH));
+                }
+                send_window(x0, y0, x1, y1);
+                sent += fill(colors, n, next_rand() % 4);
+                send_pixels(colors, n);
+        }
+        finish();
+
+        if (dec.bad != 0 || dec.begun == false || dec.ended == false ||
+            dec.width != WIDTH || dec.height != HEIGHT || dec.page != page ||
+            dec.end_count != sent || dec.put_count != sent ||
+            memcmp(dec.frame.px, ref.px, sizeof(ref.px)) != 0) {
+                fprintf(stderr, "FAIL seed %08x room %zu: %u bad chunks, "
+                        "%lu of %lu pixels\n", (unsigned)seed, room, dec.bad,
+                        (unsigned long)dec.put_count, (unsigned long)sent);
+                failures++;
+        }
+}
+
+/********** check_solid ********
+ *
+ * A solid full-screen fill, sent in many transfers, takes
+ * one run per CAP_RUN_MAX pixels
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_solid(void)
+{
+        static uint16_t colors[WIDTH * HEIGHT];
+        const uint32_t n = WIDTH * HEIGHT;
+
+        rng = 0x5eed;
+        fake_usb_reset();
+        drain_odds = 1;
+        start(0);
+        send_window(0, 0, WIDTH - 1, HEIGHT - 1);
+        fill(colors, n, 0);
+        send_pixels(colors, n);
+        finish();
+
+        if (dec.bad != 0 || dec.runs != (n + 254) / 255 ||
+            memcmp(dec.frame.px, ref.px, sizeof(ref.px)) != 0) {
+                fprintf(stderr, "FAIL solid: %lu runs, want %lu\n",
+                        (unsigned long)dec.runs,
+                        (unsigned long)(n + 254) / 255);
+                failures++;
+        }
+}
+
+/********** check_detached ********
+ *
+ * With no host attached, chunks are discarded and the
+ * capture still completes
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_detached(void)
+{
+        static uint16_t colors[WIDTH * HEIGHT];
+        size_t n;
+
+        rng = 0xd00d;
+        fake_usb_reset();
+        fake_usb_connect(false);
+        drain_odds = 3;
+        start(1);
+        send_window(0, 0, WIDTH - 1, HEIGHT - 1);
+        fill(colors, WIDTH * HEIGHT, 2);
+        send_pixels(colors, WIDTH * HEIGHT);
+        capture_end();
+        capture_drain();
+
+        fake_usb_output(&n);
+        if (n != 0 || capture_active()) {
+                fprintf(stderr, "FAIL detached: %zu bytes written\n", n);
+                failures++;
+        }
+}
+
+int main(void)
+{
+        static const size_t rooms[] = { 0, 100, 200, 1000 };
+
+        capture_init();
+        for (uint32_t s = 1; s <= 16; s++) {
+                check_random(s * 0x9e3779b9u, rooms[s % 4]);
+        }
+        check_solid();
+        check_detached();
+
+        if (failures > 0) {
+                fprintf(stderr, "%u failures\n", failures);
+                return 1;
+        }
+        printf("capture: ok\n");
+        return 0;
+}
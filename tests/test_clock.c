@@ -0,0 +1,185 @@
+/**************************************************************
+ *
+ *                        test_clock.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host check of clock.c's calendar conversions against the
+ *     C library. Across the accepted clock_set_epoch_utc range
+ *     (CLOCK_EPOCH_MIN to CLOCK_EPOCH_MAX) it compares
+ *     clock_epoch_to_datetime with gmtime_r field by field and
+ *     round-trips each time through clock_datetime_to_epoch:
+ *     every second of every third day, and every 7919th second
+ *     of the others (about 800 million timestamps). --full
+ *     checks every second instead.
+ *
+ *     It also round-trips every day from 0001-01-01 to
+ *     9999-12-31 through clock_civil_from_days and
+ *     clock_days_from_civil, checking the date against
+ *     gmtime_r.
+ *
+ *     Prints the first MAX_REPORTS mismatches and exits
+ *     non-zero if there were any.
+ *
+ **************************************************************/
+
+#define _DEFAULT_SOURCE
+#include "clock.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SECS_PER_DAY 86400
+#define SPARSE_STRIDE 7919
+#define MAX_REPORTS 10
+
+static unsigned long failures = 0;
+
+static void fail(const char *what, int64_t value);
+static void check_epoch(int64_t t);
+static void check_epoch_range(int full);
+static void check_days(void);
+
+/********** fail ********
+ *
+ * Count a mismatch and describe the first few
+ *
+ * Parameters:
+ *      const char *what: check that failed
+ *      int64_t value:    timestamp or day number checked
+ *
+ * Return: none
+ *
+ * Expects:
+ *      what is not NULL
+ ************************/
+static void fail(const char *what, int64_t value)
+{
+        if (failures++ < MAX_REPORTS) {
+                fprintf(stderr, "FAIL %s at %lld\n", what, (long long)value);
+        }
+}
+
+/********** check_epoch ********
+ *
+ * Compare one timestamp's conversion with gmtime_r
+ *
+ * Parameters:
+ *      int64_t t: seconds since the Unix epoch
+ *
+ * Return: none
+ *
+ * Expects:
+ *      time_t is 64 bits
+ ************************/
+static void check_epoch(int64_t t)
+{
+        time_t tt = (time_t)t;
+        struct tm tm;
+        datetime_t dt;
+
+        gmtime_r(&tt, &tm);
+        clock_epoch_to_datetime(t, &dt);
+
+        if (dt.year != tm.tm_year + 1900 || dt.month != tm.tm_mon + 1 ||
+            dt.day != tm.tm_mday || dt.dotw != tm.tm_wday ||
+            dt.hour != tm.tm_hour || dt.min != tm.tm_min ||
+            dt.sec != tm.tm_sec) {
+                fail("clock_epoch_to_datetime", t);
+        }
+        if (clock_datetime_to_epoch(&dt) != t) {
+                fail("clock_datetime_to_epoch", t);
+        }
+}
+
+/********** check_epoch_range ********
+ *
+ * Check timestamps across the accepted epoch range
+ *
+ * Parameters:
+ *      int full: non-zero to check every second
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_epoch_range(int full)
+{
+        int64_t first = CLOCK_EPOCH_MIN + 1;
+        int64_t last = CLOCK_EPOCH_MAX - 1;
+        unsigned long long n = 0;
+
+        for (int64_t day = first / SECS_PER_DAY;
+             day <= last / SECS_PER_DAY; day++) {
+                int64_t step = full || day % 3 == 0 ? 1 : SPARSE_STRIDE;
+
+                for (int64_t s = 0; s < SECS_PER_DAY; s += step) {
+                        int64_t t = day * SECS_PER_DAY + s;
+
+                        if (t >= first && t <= last) {
+                                check_epoch(t);
+                                n++;
+                        }
+                }
+        }
+        check_epoch(first);
+        check_epoch(last);
+        printf("epoch range: %llu timestamps\n", n + 2);
+}
+
+/********** check_days ********
+ *
+ * Round-trip every day of years 1 to 9999
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      time_t is 64 bits
+ ************************/
+static void check_days(void)
+{
+        int32_t first = clock_days_from_civil(1, 1, 1);
+        int32_t last = clock_days_from_civil(9999, 12, 31);
+
+        for (int32_t days = first; days <= last; days++) {
+                time_t tt = (time_t)days * SECS_PER_DAY;
+                struct tm tm;
+                int y, m, d;
+
+                gmtime_r(&tt, &tm);
+                clock_civil_from_days(days, &y, &m, &d);
+
+                if (y != tm.tm_year + 1900 || m != tm.tm_mon + 1 ||
+                    d != tm.tm_mday) {
+                        fail("clock_civil_from_days", days);
+                }
+                if (clock_days_from_civil(y, m, d) != days) {
+                        fail("clock_days_from_civil", days);
+                }
+        }
+        printf("days: %ld checked\n", (long)(last - first + 1));
+}
+
+int main(int argc, char *argv[])
+{
+        int full = argc > 1 && strcmp(argv[1], "--full") == 0;
+
+        if (sizeof(time_t) < 8) {
+                fprintf(stderr, "needs a 64-bit time_t\n");
+                return 1;
+        }
+
+        check_days();
+        check_epoch_range(full);
+
+        if (failures > 0) {
+                fprintf(stderr, "%lu mismatches\n", failures);
+                return 1;
+        }
+        printf("ok\n");
+        return 0;
+}
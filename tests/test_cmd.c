@@ -0,0 +1,393 @@
+/**************************************************************
+ *
+ *                         test_cmd.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host check of the USB command layer in cmd.c, fed
+ *     through the fake USB driver with the modules it calls
+ *     replaced by recording fakes.
+ *
+ *     A script of lines covering every command, its argument
+ *     checks and the line-level errors is sent in one piece,
+ *     a byte per read, and split at pseudo-random points; each
+ *     time the replies and the calls made must match the
+ *     script exactly. Lines of 255 and 256 bytes check the
+ *     overflow edge, and BENCH must parse all of its samples.
+ *
+ **************************************************************/
+
+#define _DEFAULT_SOURCE
+#include "cmd.h"
+#include "cmd_fakes.h"
+#include "fake_usb.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RX_US 5000000u
+
+extern uint64_t host_time_us;
+
+typedef struct {
+        const char *in;
+        const char *out;
+        const char *log;
+} Step;
+
+static const Step script[] = {
+        { "T 1700000123",     "OK",           "epoch 1700000123" },
+        { "T 1700000000",     "ERR range",    "" },
+        { "T -5",             "ERR range",    "" },
+        { "T -",              "ERR fmt",      "" },
+        { "T 17x",            "ERR fmt",      "" },
+        { "T",                "ERR args",     "" },
+        { "T 1 2",            "ERR args",     "" },
+        { "t 1700000123",     "ERR cmd",      "" },
+        { "Y",                "Y 5000000",    "" },
+        { "Y 123456789 1700000000123456 850", "OK",
+          "sync 123456789 1700000000123456 850\nreport C" },
+        { "Y 1 -2 60000",     "ERR rtt",      "sync 1 -2 60000" },
+        { "Y 1 2",            "ERR fmt",      "" },
+        { "Y 1 2 4294967296", "ERR fmt",      "" },
+        { "PAGE 3",           "OK",           "page 3" },
+        { "PAGE Mandelbrot",  "OK",           "page 3" },
+        { "PAGE 5",           "ERR page",     "" },
+        { "PAGE mandel",      "ERR page",     "" },
+        { "COLOR 0000 f800",  "OK",           "colors 0000 f800" },
+        { "COLOR FFFF 1",     "OK",           "colors ffff 0001" },
+        { "COLOR 10000 0",    "ERR fmt",      "" },
+        { "COLOR 00g0 0",     "ERR fmt",      "" },
+        { "TLM 1",            "OK",           "telemetry 1" },
+        { "TLM 2",            "ERR fmt",      "" },
+        { "SHOT",             "OK",           "capture 0" },
+        { "SHOT 10000",       "OK",           "capture 10000" },
+        { "SHOT 10001",       "ERR range",    "" },
+        { "SHOT x",           "ERR fmt",      "" },
+        { "RECT 0 0 1 1",     "ERR page",     "" },
+        { "PAGE REMOTE",      "OK",           "page 4" },
+        { "RECT 0 0 65536 1", "ERR fmt",      "" },
+        { "RECT 10 20 9 29",  "ERR range",    "rect 10 20 9 29" },
+        { "BALLS 0",          "ERR range",    "" },
+        { "BALLS 64",         "OK",           "configure 2 0 64" },
+        { "BALLS 65",         "ERR range",    "" },
+        { "PHYS 0 1000 1000", "OK",           "configure 2 1 1049600000" },
+        { "PHYS 1001 0 0",    "ERR range",    "" },
+        { "PHYS a 0 0",       "ERR fmt",      "" },
+        { "TRAIL 1",          "OK",           "configure 2 2 1" },
+        { "TRAIL 2",          "ERR range",    "" },
+        { "I",                "",             "report I" },
+        { "I 1",              "ERR args",     "" },
+        { "CIRCLE",           "",             "report CIRCLE" },
+        { "STATS",            "",
+          "report I\nreport J\nreport P\nreport L\nreport W\nreport S\n"
+          "report C\nreport R\nreport X\nreport G\nreport F" },
+        { "",                 "",             "" },
+        { "    ",             "",             "" },
+        { "PAGE 1\r",         "OK",           "page 1" },
+        { "  PAGE   2  ",     "OK",           "page 2" },
+        { "A B C D E F G H",  "ERR cmd",      "" },
+        { "A B C D E F G H I", "ERR fmt",     "" },
+};
+
+#define STEP_COUNT (sizeof(script) / sizeof(script[0]))
+
+/* longest line the receive buffer holds with its newline */
+#define LINE_MAX_OK 255
+
+static char script_in[16384];
+static size_t script_in_len = 0;
+static char script_out[8192];
+static char script_log[8192];
+static unsigned failures = 0;
+
+static void build_script(void);
+static void append(char *dst, const char *s, const char *end);
+static void run(const void *in, size_t n, uint32_t seed, size_t max);
+static void check_script(void);
+static void check_busy(void);
+static void check_help(void);
+static void check_bench(void);
+
+/********** append ********
+ *
+ * Append a line to an expected text, if it is not empty
+ *
+ * Parameters:
+ *      char *dst:       NUL-terminated text
+ *      const char *s:   line without ending
+ *      const char *end: line ending
+ *
+ * Return: none
+ *
+ * Expects:
+ *      dst has room
+ ************************/
+static void append(char *dst, const char *s, const char *end)
+{
+        if (s[0] != '\0') {
+                strcat(dst, s);
+                strcat(dst, end);
+        }
+}
+
+/********** build_script ********
+ *
+ * Join the script's lines into the input, the replies and
+ * the call log expected
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      A 256-byte line is answered with one "ERR overflow" and
+ *      dropped up to its newline, as is a 768-byte one; a
+ *      255-byte line still fits
+ ************************/
+static void build_script(void)
+{
+        char line[LINE_MAX_OK + 2];
+
+        script_in[0] = '\0';
+        script_out[0] = '\0';
+        script_log[0] = '\0';
+        for (size_t i = 0; i < STEP_COUNT; i++) {
+                append(script_in, script[i].in, "\n");
+                if (script[i].in[0] == '\0') {
+                        strcat(script_in, "\n");
+                }
+                append(script_out, script[i].out, "\r\n");
+                append(script_log, script[i].log, "\n");
+        }
+
+        memset(line, '1', sizeof(line));
+        line[0] = 'T';
+        line[1] = ' ';
+        line[LINE_MAX_OK] = '\0';
+        append(script_in, line, "\n");
+        append(script_out, "ERR fmt", "\r\n");
+
+        line[LINE_MAX_OK] = '1';
+        line[LINE_MAX_OK + 1] = '\0';
+        append(script_in, line, "\n");
+        for (int i = 0; i < 3; i++) {
+                strcat(script_in, line);
+        }
+        strcat(script_in, "\n");
+        append(script_in, "TLM 0", "\n");
+        append(script_out, "ERR overflow", "\r\n");
+        append(script_out, "ERR overflow", "\r\n");
+        append(script_out, "OK", "\r\n");
+        append(script_log, "telemetry 0", "\n");
+
+        script_in_len = strlen(script_in);
+}
+
+/********** run ********
+ *
+ * Send bytes to the command layer and poll until all are read
+ *
+ * Parameters:
+ *      const void *in: bytes the host sends
+ *      size_t n:       byte count
+ *      uint32_t seed:  read size sequence
+ *      size_t max:     largest read, 0 for all that fits
+ *
+ * Return: none
+ *
+ * Expects:
+ *      The input ends at a line boundary, so cmd.c is left
+ *      with an empty receive buffer
+ ************************/
+static void run(const void *in, size_t n, uint32_t seed, size_t max)
+{
+        fake_usb_reset();
+        fake_log_reset();
+        fake_usb_feed(in, n);
+        fake_usb_chunks(seed, max);
+        while (fake_usb_pending() > 0) {
+                cmd_poll();
+        }
+}
+
+/********** check_script ********
+ *
+ * Run the script with every split of reads and compare
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_script(void)
+{
+        static const struct {
+                uint32_t seed;
+                size_t max;
+        } splits[] = {
+                { 0, 0 }, { 1, 1 }, { 0x1234567u, 3 }, { 0x9e3779b9u, 7 },
+                { 0xdeadbeefu, 64 }, { 0x0badf00du, 300 }, { 77u, 1000 },
+        };
+
+        for (size_t s = 0; s < sizeof(splits) / sizeof(splits[0]); s++) {
+                size_t len;
+
+                run(script_in, script_in_len, splits[s].seed, splits[s].max);
+                const char *out = fake_usb_output(&len);
+                if (strcmp(out, script_out) != 0) {
+                        fprintf(stderr, "FAIL replies, reads of up to %zu "
+                                "(seed %08x):\n%s\nwant:\n%s\n",
+                                splits[s].max, (unsigned)splits[s].seed,
+                                out, script_out);
+                        failures++;
+                }
+                if (strcmp(fake_log(), script_log) != 0) {
+                        fprintf(stderr, "FAIL calls, reads of up to %zu "
+                                "(seed %08x):\n%s\nwant:\n%s\n",
+                                splits[s].max, (unsigned)splits[s].seed,
+                                fake_log(), script_log);
+                        failures++;
+                }
+        }
+}
+
+/********** check_busy ********
+ *
+ * Commands that queue work for the render core reply
+ * "ERR busy" when the queue is full
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_busy(void)
+{
+        static const char in[] =
+                "PAGE 1\nCOLOR 0 0\nSHOT\nBALLS 3\nPHYS 0 0 0\nTRAIL 0\n"
+                "TLM 0\n";
+        static const char want[] =
+                "ERR busy\r\nERR busy\r\nERR busy\r\nERR busy\r\n"
+                "ERR busy\r\nERR busy\r\nOK\r\n";
+        size_t len;
+
+        fake_usb_reset();
+        fake_log_reset();
+        fake_render_busy = true;
+        fake_usb_feed(in, sizeof(in) - 1);
+        cmd_poll();
+        if (strcmp(fake_usb_output(&len), want) != 0 ||
+            strcmp(fake_log(), "telemetry 0\n") != 0) {
+                fprintf(stderr, "FAIL busy:\n%s\n", fake_usb_output(&len));
+                failures++;
+        }
+        fake_render_busy = false;
+}
+
+/********** check_help ********
+ *
+ * HELP lists the table from first entry to last
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void check_help(void)
+{
+        static const char in[] = "HELP\n";
+        static const char first[] = "T <epoch>: set UTC time\r\n";
+        static const char last[] = "HELP: this list\r\n";
+        size_t len;
+
+        run(in, sizeof(in) - 1, 0, 0);
+        const char *out = fake_usb_output(&len);
+        if (len < sizeof(first) + sizeof(last) ||
+            strncmp(out, first, sizeof(first) - 1) != 0 ||
+            strcmp(out + len - (sizeof(last) - 1), last) != 0) {
+                fprintf(stderr, "FAIL help:\n%s\n", out);
+                failures++;
+        }
+}
+
+/********** check_bench ********
+ *
+ * BENCH times every sample and the sscanf comparison, with
+ * no sample failing its command's argument parsing
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      BENCH prints through stdio, so stdout is sent to a
+ *      temporary file while it runs
+ ************************/
+static void check_bench(void)
+{
+        static const char in[] = "BENCH\n";
+        char line[256];
+        unsigned lines = 0, errors = 0;
+        FILE *tmp = tmpfile();
+        int saved = dup(STDOUT_FILENO);
+
+        if (tmp == NULL || saved < 0) {
+                fprintf(stderr, "FAIL bench: no temporary file\n");
+                failures++;
+                return;
+        }
+        fflush(stdout);
+        dup2(fileno(tmp), STDOUT_FILENO);
+        run(in, sizeof(in) - 1, 0, 0);
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+
+        rewind(tmp);
+        while (fgets(line, sizeof(line), tmp) != NULL) {
+                lines += strncmp(line, "BENCH ", 6) == 0;
+                errors += strstr(line, "ERR") != NULL;
+        }
+        fclose(tmp);
+
+        if (lines != 6 || errors != 0) {
+                fprintf(stderr, "FAIL bench: %u lines, %u errors\n",
+                        lines, errors);
+                failures++;
+        }
+}
+
+int main(void)
+{
+        host_time_us = RX_US;
+        build_script();
+        check_script();
+        check_busy();
+        check_help();
+        check_bench();
+
+        if (failures > 0) {
+                fprintf(stderr, "%u failures\n", failures);
+                return 1;
+        }
+        printf("cmd: %zu script lines ok\n", STEP_COUNT);
+        return 0;
+}
@@ -0,0 +1,351 @@
+/**************************************************************
+ *
+ *                         test_life.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host check of the bit-packed Game of Life in life.c
+ *     against a naive reference that counts each cell's eight
+ *     neighbours one by one on the wrapping grid.
+ *
+ *     From the page's own random start, every generation the
+ *     bit-packed step computes must equal the reference's,
+ *     through a reseed when the grid settles or reaches
+ *     LIFE_RESEED_GENS. After every tick the model panel,
+ *     which only sees the rows life.c chose to send, must show
+ *     the generation just computed in the page's colours, so
+ *     a row that changed but was not flagged is caught too.
+ *     split_run runs the second half of the rows first, so
+ *     the halves must not depend on each other.
+ *
+ *     A lone glider, crossing every edge and word boundary,
+ *     must also come back to where it started after 1920
+ *     generations.
+ *
+ **************************************************************/
+
+#include "life.h"
+#include "split.h"
+#include "../lib/src/graphics/util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BG 0x1234
+#define FG 0xabcd
+#define RANDOM_GENS 6000
+
+/* a glider moves one cell diagonally every four generations */
+#define GLIDER_GENS (4 * 480)
+
+static uint16_t panel[SCREEN_HEIGHT][SCREEN_WIDTH];
+static uint8_t want[LIFE_ROWS][LIFE_COLS];
+static Life life;
+static unsigned failures = 0;
+
+static bool cell(const Life *l, uint x, uint y);
+static void load(uint8_t g[LIFE_ROWS][LIFE_COLS], const Life *l);
+static void naive_step(uint8_t g[LIFE_ROWS][LIFE_COLS]);
+static bool grid_matches(const Life *l, uint8_t g[LIFE_ROWS][LIFE_COLS]);
+static bool panel_matches(uint8_t g[LIFE_ROWS][LIFE_COLS]);
+static void check_random(void);
+static void check_glider(void);
+
+/********** split_run ********
+ *
+ * Stand-in for the two-core split: both halves in turn on
+ * this thread
+ *
+ * Parameters:
+ *      SplitFn fn: work on items [begin, end)
+ *      uint n:     item count
+ *
+ * Return: none
+ *
+ * Expects:
+ *      fn is not NULL
+ *
+ * Notes:
+ *      The second half runs first, so a half that read rows
+ *      the other had already written would go wrong
+ ************************/
+void split_run(SplitFn fn, uint n)
+{
+        fn(n / 2, n, 1);
+        fn(0, n / 2, 0);
+}
+
+void push_scanline_swapped_xy(uint16_t x, uint16_t y, uint16_t *buf,
+                              size_t len)
+{
+        for (size_t i = 0; i < len && x + i < SCREEN_WIDTH; i++) {
+                panel[y][x + i] = (uint16_t)(buf[i] << 8 | buf[i] >> 8);
+        }
+}
+
+/********** cell ********
+ *
+ * Read one cell of the live generation
+ *
+ * Parameters:
+ *      const Life *l: game state
+ *      uint x, y:     cell
+ *
+ * Return: true if alive
+ *
+ * Expects:
+ *      x < LIFE_COLS, y < LIFE_ROWS
+ ************************/
+static bool cell(const Life *l, uint x, uint y)
+{
+        return (l->cells[l->cur][y][x / 32] >> (x % 32)) & 1;
+}
+
+/********** load ********
+ *
+ * Copy the live generation into a byte-per-cell grid
+ *
+ * Parameters:
+ *      uint8_t g[][]: grid out
+ *      const Life *l: game state
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ ************************/
+static void load(uint8_t g[LIFE_ROWS][LIFE_COLS], const Life *l)
+{
+        for (uint y = 0; y < LIFE_ROWS; y++) {
+                for (uint x = 0; x < LIFE_COLS; x++) {
+                        g[y][x] = cell(l, x, y);
+                }
+        }
+}
+
+/********** naive_step ********
+ *
+ * Advance a byte-per-cell grid one generation
+ *
+ * Parameters:
+ *      uint8_t g[][]: grid, updated in place
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Counts each cell's neighbours one at a time, wrapping
+ *      at every edge
+ ************************/
+static void naive_step(uint8_t g[LIFE_ROWS][LIFE_COLS])
+{
+        static uint8_t next[LIFE_ROWS][LIFE_COLS];
+
+        for (uint y = 0; y < LIFE_ROWS; y++) {
+                for (uint x = 0; x < LIFE_COLS; x++) {
+                        uint n = 0;
+
+                        for (int dy = -1; dy <= 1; dy++) {
+                                for (int dx = -1; dx <= 1; dx++) {
+                                        uint yy = (y + LIFE_ROWS + dy) %
+                                                  LIFE_ROWS;
+                                        uint xx = (x + LIFE_COLS + dx) %
+                                                  LIFE_COLS;
+
+                                        if (dx != 0 || dy != 0) {
+                                                n += g[yy][xx];
+                                        }
+                                }
+                        }
+                        next[y][x] = n == 3 || (n == 2 && g[y][x]);
+                }
+        }
+        memcpy(g, next, sizeof(next));
+}
+
+/********** grid_matches ********
+ *
+ * Compare the live generation with a reference grid
+ *
+ * Parameters:
+ *      const Life *l: game state
+ *      uint8_t g[][]: reference
+ *
+ * Return: true if every cell agrees
+ *
+ * Expects:
+ *      none
+ ************************/
+static bool grid_matches(const Life *l, uint8_t g[LIFE_ROWS][LIFE_COLS])
+{
+        for (uint y = 0; y < LIFE_ROWS; y++) {
+                for (uint x = 0; x < LIFE_COLS; x++) {
+                        if (cell(l, x, y) != g[y][x]) {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+
+/********** panel_matches ********
+ *
+ * Compare the panel with a grid drawn at 2x2 pixels per cell
+ *
+ * Parameters:
+ *      uint8_t g[][]: reference
+ *
+ * Return: true if every pixel agrees
+ *
+ * Expects:
+ *      none
+ ************************/
+static bool panel_matches(uint8_t g[LIFE_ROWS][LIFE_COLS])
+{
+        for (uint y = 0; y < SCREEN_HEIGHT; y++) {
+                for (uint x = 0; x < SCREEN_WIDTH; x++) {
+                        if (panel[y][x] != (g[y / 2][x / 2] ? FG : BG)) {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+
+/********** check_random ********
+ *
+ * Follow the page from its random start against the naive
+ * reference, through reseeds
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      A reseed replaces the generation just computed, but the
+ *      panel still shows it; the grid is compared again from
+ *      the new seed on
+ ************************/
+static void check_random(void)
+{
+        uint reseeds = 0;
+
+        memset(panel, 0, sizeof(panel));
+        life_init(&life, BG, FG);
+        load(want, &life);
+        life_tick(&life);
+        if (panel_matches(want) == false) {
+                fprintf(stderr, "FAIL random: first draw\n");
+                failures++;
+                return;
+        }
+
+        for (uint i = 0; i < RANDOM_GENS; i++) {
+                uint32_t gen = life.gen;
+
+                naive_step(want);
+                life_tick(&life);
+
+                if (panel_matches(want) == false) {
+                        fprintf(stderr, "FAIL random: panel after "
+                                "generation %lu\n", (unsigned long)gen + 1);
+                        failures++;
+                        return;
+                }
+                if (life.full) {
+                        reseeds++;
+                        load(want, &life);
+                        life_tick(&life);
+                        if (panel_matches(want) == false) {
+                                fprintf(stderr, "FAIL random: redraw "
+                                        "after reseed %u\n", reseeds);
+                                failures++;
+                                return;
+                        }
+                } else if (grid_matches(&life, want) == false) {
+                        fprintf(stderr, "FAIL random: generation %lu\n",
+                                (unsigned long)life.gen);
+                        failures++;
+                        return;
+                }
+        }
+
+        if (reseeds == 0) {
+                fprintf(stderr, "FAIL random: never reseeded\n");
+                failures++;
+        }
+}
+
+/********** check_glider ********
+ *
+ * A lone glider returns to its start after crossing the
+ * grid's edges
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Placed across a word boundary; 480 diagonal steps are
+ *      a whole number of laps of both 160 columns and 120 rows
+ ************************/
+static void check_glider(void)
+{
+        static const uint8_t shape[3][3] = {
+                { 0, 1, 0 }, { 0, 0, 1 }, { 1, 1, 1 },
+        };
+        static uint8_t start[LIFE_ROWS][LIFE_COLS];
+
+        life_init(&life, BG, FG);
+        memset(life.cells[life.cur], 0, sizeof(life.cells[life.cur]));
+        memset(start, 0, sizeof(start));
+        for (uint y = 0; y < 3; y++) {
+                for (uint x = 0; x < 3; x++) {
+                        uint cx = 31 + x, cy = 117 + y;
+
+                        start[cy][cx] = shape[y][x];
+                        life.cells[life.cur][cy][cx / 32] |=
+                                (uint32_t)shape[y][x] << (cx % 32);
+                }
+        }
+        memcpy(want, start, sizeof(start));
+
+        life_tick(&life);
+        for (uint i = 0; i < GLIDER_GENS; i++) {
+                naive_step(want);
+                life_tick(&life);
+                if (life.full || grid_matches(&life, want) == false) {
+                        fprintf(stderr, "FAIL glider: generation %u\n",
+                                i + 1);
+                        failures++;
+                        return;
+                }
+        }
+        if (grid_matches(&life, start) == false ||
+            panel_matches(start) == false) {
+                fprintf(stderr, "FAIL glider: not back at the start\n");
+                failures++;
+        }
+}
+
+int main(void)
+{
+        check_random();
+        check_glider();
+
+        if (failures > 0) {
+                fprintf(stderr, "%u failures\n", failures);
+                return 1;
+        }
+        printf("life: ok\n");
+        return 0;
+}
@@ -0,0 +1,417 @@
+/**************************************************************
+ *
+ *                        test_remote.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host check of remote display mode: the real cmd.c and
+ *     remote.c, fed through the fake USB driver, drawing on a
+ *     model of the panel.
+ *
+ *     A script of random rectangles, some full-screen, with
+ *     text commands (and rejected rectangles, which send no
+ *     pixels) between them is sent split at pseudo-random
+ *     points. Pixel bytes include newlines and command text,
+ *     so any byte parsed as a line shows up as a wrong reply.
+ *     The render core gets a turn only now and then, so the
+ *     command layer often runs out of buffers and must stop
+ *     reading and resume later. The replies must match the
+ *     script and the panel must hold what was sent.
+ *
+ *     The panel model applies a transfer only when the render
+ *     core waits for it, so a buffer refilled while still on
+ *     the wire would show up as corrupt pixels.
+ *
+ **************************************************************/
+
+#include "remote.h"
+#include "cmd.h"
+#include "sched.h"
+#include "dispmon.h"
+#include "fake_usb.h"
+#include "../lib/src/ST7789/hardware.h"
+#include "../lib/src/graphics/util.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RECT_COUNT 60
+#define INPUT_MAX  (3u << 20)
+
+/* polls in a row with nothing read or drawn before giving up */
+#define STUCK_POLLS 10000
+
+typedef struct {
+        const char *line;
+        const char *reply;
+} TextCmd;
+
+/* sent between rectangles; none of them changes the page */
+static const TextCmd texts[] = {
+        { "Y",               "Y 0" },
+        { "COLOR 1234 abcd", "OK" },
+        { "BALLS 3",         "OK" },
+        { "T 5",             "ERR range" },
+        { "BOGUS 1",         "ERR cmd" },
+        { "RECT 0 0 320 0",  "ERR range" },
+        { "RECT 5 5 4 5",    "ERR range" },
+        { "RECT 0 0 1",      "ERR args" },
+        { "I",               "" },
+};
+
+#define TEXT_COUNT (sizeof(texts) / sizeof(texts[0]))
+
+static uint16_t panel[SCREEN_WIDTH * SCREEN_HEIGHT];
+static uint16_t ref[SCREEN_WIDTH * SCREEN_HEIGHT];
+static uint16_t win_x0, win_y0, win_x1, win_y1, cur_x, cur_y;
+static const uint16_t *dma_buf = NULL;
+static size_t dma_len = 0;
+static unsigned dma_overlaps = 0;
+static bool stuck = false;
+
+static uint8_t script_in[INPUT_MAX];
+static size_t script_in_len = 0;
+static char script_out[16384];
+static uint32_t rng = 1;
+static unsigned failures = 0;
+
+static uint32_t next_rand(void);
+static void add_text(const char *line, const char *reply);
+static void add_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+static void build_script(uint32_t seed);
+static uint run(uint32_t seed, size_t max, uint render_odds);
+static void check(uint32_t seed, size_t max, uint render_odds);
+
+/********** next_rand ********
+ *
+ * Advance the test's random sequence
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: 32 pseudo-random bits
+ *
+ * Expects:
+ *      rng is not 0
+ ************************/
+static uint32_t next_rand(void)
+{
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+}
+
+void sched_post(uint core, uint32_t events)
+{
+        (void)core;
+        (void)events;
+}
+
+void set_address_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+        if (dma_buf != NULL) {
+                dma_overlaps++;
+        }
+        win_x0 = x0;
+        win_y0 = y0;
+        win_x1 = x1;
+        win_y1 = y1;
+        cur_x = x0;
+        cur_y = y0;
+}
+
+void start_display_transfer(uint16_t *buf, size_t len)
+{
+        if (dma_buf != NULL) {
+                dma_overlaps++;
+        }
+        dma_buf = buf;
+        dma_len = len;
+}
+
+/********** dispmon_wait_idle ********
+ *
+ * Finish the transfer on the wire, as the panel sees it
+ *
+ * Parameters:
+ *      none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      none
+ *
+ * Notes:
+ *      Pixels arrive as big-endian bytes, so each is swapped
+ *      back to plain RGB565; the window fills row by row and
+ *      wraps to its top, as the ST7789 does
+ ************************/
+void dispmon_wait_idle(void)
+{
+        for (size_t i = 0; i < dma_len; i++) {
+                uint16_t p = dma_buf[i];
+
+                if (cur_x < SCREEN_WIDTH && cur_y < SCREEN_HEIGHT) {
+                        panel[cur_y * SCREEN_WIDTH + cur_x] =
+                                (uint16_t)(p << 8 | p >> 8);
+                }
+                if (++cur_x > win_x1) {
+                        cur_x = win_x0;
+                        if (++cur_y > win_y1) {
+                                cur_y = win_y0;
+                        }
+                }
+        }
+        dma_buf = NULL;
+        dma_len = 0;
+}
+
+/********** add_text ********
+ *
+ * Append a text command and its reply to the script
+ *
+ * Parameters:
+ *      const char *line:  command, without newline
+ *      const char *reply: expected reply, "" for none
+ *
+ * Return: none
+ *
+ * Expects:
+ *      The script has room
+ ************************/
+static void add_text(const char *line, const char *reply)
+{
+        size_t n = strlen(line);
+
+        memcpy(script_in + script_in_len, line, n);
+        script_in_len += n;
+        script_in[script_in_len++] = '\n';
+        if (reply[0] != '\0') {
+                strcat(script_out, reply);
+                strcat(script_out, "\r\n");
+        }
+}
+
+/********** add_rect ********
+ *
+ * Append a RECT command with random pixels to the script and
+ * draw them on the reference screen
+ *
+ * Parameters:
+ *      uint16_t x0, y0, x1, y1: rectangle corners (inclusive)
+ *
+ * Return: none
+ *
+ * Expects:
+ *      The rectangle is on screen and the script has room
+ *
+ * Notes:
+ *      Pixels are random, newlines, or the bytes of a command
+ *      line, so a parser reading pixels as text would reply
+ ************************/
+static void add_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+        static const char text[] = "\nPAGE 0\nT 5\n";
+        char line[40];
+        uint mode = next_rand() % 3;
+        uint t = 0;
+
+        snprintf(line, sizeof(line), "RECT %u %u %u %u", x0, y0, x1, y1);
+        add_text(line, "OK");
+        for (uint y = y0; y <= y1; y++) {
+                for (uint x = x0; x <= x1; x++) {
+                        uint16_t c;
+
+                        if (mode == 0) {
+                                c = (uint16_t)next_rand();
+                        } else if (mode == 1) {
+                                c = next_rand() % 2 ? 0x0a0a : 0x0d0a;
+                        } else {
+                                c = (uint16_t)(text[t] << 8 | text[t + 1]);
+                                t = (t + 2) % (sizeof(text) - 1);
+                        }
+                        ref[y * SCREEN_WIDTH + x] = c;
+                        script_in[script_in_len++] = (uint8_t)(c >> 8);
+                        script_in[script_in_len++] = (uint8_t)c;
+                }
+        }
+}
+
+/********** build_script ********
+ *
+ * Make a random script of rectangles and text commands
+ *
+ * Parameters:
+ *      uint32_t seed: random sequence
+ *
+ * Return: none
+ *
+ * Expects:
+ *      seed is not 0
+ *
+ * Notes:
+ *      Every eighth rectangle is full-screen, larger than all
+ *      the pixel buffers together; the rest are at most 48
+ *      rows, which keeps the script within INPUT_MAX
+ *      A RECT on another page is refused
+ ************************/
+static void build_script(uint32_t seed)
+{
+        rng = seed;
+        script_in_len = 0;
+        script_out[0] = '\0';
+        memset(ref, 0, sizeof(ref));
+
+        add_text("PAGE 0", "OK");
+        add_text("RECT 0 0 1 1", "ERR page");
+        add_text("PAGE remote", "OK");
+        for (uint r = 0; r < RECT_COUNT; r++) {
+                uint16_t x0 = 0, y0 = 0;
+                uint16_t x1 = SCREEN_WIDTH - 1, y1 = SCREEN_HEIGHT - 1;
+
+                if (r % 8 != 0) {
+                        x0 = (uint16_t)(next_rand() % SCREEN_WIDTH);
+                        y0 = (uint16_t)(next_rand() % SCREEN_HEIGHT);
+                        x1 = (uint16_t)(x0 + next_rand() % (SCREEN_WIDTH - x0));
+                        y1 = (uint16_t)(y0 + next_rand() % 48);
+                        if (y1 >= SCREEN_HEIGHT) {
+                                y1 = SCREEN_HEIGHT - 1;
+                        }
+                }
+                add_rect(x0, y0, x1, y1);
+                while (next_rand() % 2 == 0) {
+                        const TextCmd *t = &texts[next_rand() % TEXT_COUNT];
+                        add_text(t->line, t->reply);
+                }
+        }
+}
+
+/********** run ********
+ *
+ * Send the script, giving the render core a turn now and then
+ *
+ * Parameters:
+ *      uint32_t seed:    read size sequence
+ *      size_t max:       largest read, 0 for all that fits
+ *      uint render_odds: the render core runs after one poll
+ *                        in render_odds
+ *
+ * Return: polls that stopped with input still waiting, for
+ *         want of a free pixel buffer
+ *
+ * Expects:
+ *      remote_init has been called
+ *
+ * Notes:
+ *      Sets stuck and gives up if STUCK_POLLS polls in a row
+ *      neither read input nor received pixels
+ ************************/
+static uint run(uint32_t seed, size_t max, uint render_odds)
+{
+        uint stalls = 0;
+        uint idle = 0;
+
+        fake_usb_reset();
+        fake_usb_feed(script_in, script_in_len);
+        fake_usb_chunks(seed, max);
+        memset(panel, 0, sizeof(panel));
+        dma_overlaps = 0;
+        stuck = false;
+
+        while (fake_usb_pending() > 0 || remote_pending() != 0) {
+                size_t before = fake_usb_pending();
+                uint32_t expect = remote_pending();
+
+                cmd_poll();
+                if (fake_usb_pending() > 0 && remote_pending() != 0) {
+                        stalls++;
+                }
+                if (next_rand() % render_odds == 0) {
+                        remote_render(true);
+                }
+                idle = fake_usb_pending() == before &&
+                       remote_pending() == expect ? idle + 1 : 0;
+                if (idle > STUCK_POLLS) {
+                        stuck = true;
+                        break;
+                }
+        }
+        remote_render(true);
+        return stalls;
+}
+
+/********** check ********
+ *
+ * Run a script and compare replies and screen
+ *
+ * Parameters:
+ *      uint32_t seed:    script and read size sequence
+ *      size_t max:       largest read, 0 for all that fits
+ *      uint render_odds: see run
+ *
+ * Return: none
+ *
+ * Expects:
+ *      seed is not 0
+ *
+ * Notes:
+ *      With the render core held back, reading must have
+ *      stopped for want of buffers at least once
+ ************************/
+static void check(uint32_t seed, size_t max, uint render_odds)
+{
+        size_t len;
+
+        build_script(seed);
+        uint stalls = run(seed, max, render_odds);
+        const char *out = fake_usb_output(&len);
+
+        if (strcmp(out, script_out) != 0) {
+                fprintf(stderr, "FAIL seed %08x reads %zu render 1/%u: "
+                        "replies\n%s\nwant:\n%s\n", (unsigned)seed, max,
+                        render_odds, out, script_out);
+                failures++;
+        }
+        if (stuck) {
+                fprintf(stderr, "FAIL seed %08x reads %zu render 1/%u: "
+                        "stopped reading\n", (unsigned)seed, max,
+                        render_odds);
+                failures++;
+        }
+        if (memcmp(panel, ref, sizeof(ref)) != 0 || dma_overlaps != 0) {
+                fprintf(stderr, "FAIL seed %08x reads %zu render 1/%u: "
+                        "screen differs, %u overlapping transfers\n",
+                        (unsigned)seed, max, render_odds, dma_overlaps);
+                failures++;
+        }
+        if (render_odds > 1 && stalls == 0) {
+                fprintf(stderr, "FAIL seed %08x reads %zu render 1/%u: "
+                        "never ran out of buffers\n", (unsigned)seed, max,
+                        render_odds);
+                failures++;
+        }
+}
+
+int main(void)
+{
+        static const struct {
+                size_t max;
+                uint render_odds;
+        } runs[] = {
+                { 0, 1 }, { 0, 8 }, { 1, 1 }, { 7, 4 }, { 64, 16 },
+                { 300, 3 }, { 5000, 8 }, { 100000, 2 },
+        };
+
+        remote_init();
+        for (uint i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+                check(0x2545f491u * (i + 1), runs[i].max,
+                      runs[i].render_odds);
+        }
+
+        if (failures > 0) {
+                fprintf(stderr, "%u failures\n", failures);
+                return 1;
+        }
+        printf("remote: ok\n");
+        return 0;
+}
@@ -0,0 +1,32 @@
+/**************************************************************
+ *
+ *                         tz_probe.c
+ *
+ *     Author:  AJ Romeo
+ *
+ *     Host driver for tz.c, run by check_tz.py. Reads lines of
+ *     "core epoch" from stdin, calls tz_offset_at for each as
+ *     if on that core, and prints one offset per line. Queries
+ *     are answered in input order, so the caller controls what
+ *     the per-core cache holds at each lookup.
+ *
+ **************************************************************/
+
+#include "tz.h"
+#include "pico/types.h"
+#include <stdio.h>
+
+extern uint host_core_num;
+
+int main(void)
+{
+        unsigned core;
+        long long utc;
+
+        printf("%s\n", tz_name);
+        while (scanf("%u %lld", &core, &utc) == 2) {
+                host_core_num = core;
+                printf("%ld\n", (long)tz_offset_at((int64_t)utc));
+        }
+        return 0;
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+gen_tz_table.py
+
+Generate the compiled UTC-offset transition table used by src/tz.c.
+
+The zone's rules are taken from the host tzdata via zoneinfo, sampled
+once a day between the start and end years, and each offset change is
+narrowed to the exact second by bisection. The output is a C file
+defining the tables declared in src/tz.h.
+
+Usage:
+    gen_tz_table.py --zone America/New_York --from 2023 --to 2100 -o tz_table.c
+"""
+
+import argparse
+import datetime
+import sys
+import zoneinfo
+
+DAY = 86400
+
+
+def offset_at(zone, epoch):
+    """UTC offset of zone at epoch, in seconds."""
+    utc = datetime.datetime.fromtimestamp(epoch, datetime.timezone.utc)
+    return int(utc.astimezone(zone).utcoffset().total_seconds())
+
+
+def find_change(zone, lo, hi):
+    """First second in (lo, hi] whose offset differs from lo's."""
+    before = offset_at(zone, lo)
+    while hi - lo > 1:
+        mid = (lo + hi) // 2
+        if offset_at(zone, mid) == before:
+            lo = mid
+        else:
+            hi = mid
+    return hi
+
+
+def transitions(zone, start, end):
+    """Initial offset at start and (epoch, offset) for each change."""
+    initial = offset_at(zone, start)
+    changes = []
+    prev = initial
+    t = start
+    while t < end:
+        nxt = min(t + DAY, end)
+        off = offset_at(zone, nxt)
+        if off != prev:
+            at = find_change(zone, t, nxt)
+            changes.append((at, offset_at(zone, at)))
+            prev = off
+        t = nxt
+    return initial, changes
+
+
+def year_start(year):
+    return int(datetime.datetime(year, 1, 1,
+                                 tzinfo=datetime.timezone.utc).timestamp())
+
+
+def emit(out, zone_name, first, last, initial, changes):
+    version = None
+    try:
+        import tzdata
+        version = tzdata.IANA_VERSION
+    except ImportError:
+        pass
+
+    w = out.write
+    w("/* Generated by tools/gen_tz_table.py -- do not edit */\n")
+    w("/* zone %s, %d-%d%s */\n\n" % (zone_name, first, last,
+      ", tzdata " + version if version else ""))
+    w('#include "tz.h"\n\n')
+    w('const char tz_name[] = "%s";\n' % zone_name)
+    w("const uint32_t tz_table_start = %du;\n" % year_start(first))
+    w("const uint32_t tz_table_end = %du;\n" % year_start(last + 1))
+    w("const int32_t tz_initial_offset = %d;\n" % initial)
+    w("const uint16_t tz_transition_count = %d;\n\n" % len(changes))
+
+    w("const uint32_t tz_transition_at[] = {\n")
+    for at, _ in changes:
+        w("        %du,\n" % at)
+    if not changes:
+        w("        0u\n")
+    w("};\n\n")
+
+    w("const int32_t tz_transition_offset[] = {\n")
+    for _, off in changes:
+        w("        %d,\n" % off)
+    if not changes:
+        w("        0\n")
+    w("};\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    ap.add_argument("--zone", default="America/New_York")
+    ap.add_argument("--from", dest="first", type=int, default=2023)
+    ap.add_argument("--to", dest="last", type=int, default=2100)
+    ap.add_argument("-o", "--output", default="-")
+    args = ap.parse_args()
+
+    if args.last >= 2106 or args.first > args.last:
+        sys.exit("year range must be ascending and end before 2106")
+
+    try:
+        zone = zoneinfo.ZoneInfo(args.zone)
+    except zoneinfo.ZoneInfoNotFoundError:
+        sys.exit("unknown zone %s" % args.zone)
+
+    start = year_start(args.first)
+    end = year_start(args.last + 1)
+    initial, changes = transitions(zone, start, end)
+
+    if args.output == "-":
+        emit(sys.stdout, args.zone, args.first, args.last, initial, changes)
+    else:
+        with open(args.output, "w") as out:
+            emit(out, args.zone, args.first, args.last, initial, changes)
+
+
+if __name__ == "__main__":
+    main()
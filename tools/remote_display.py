@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+remote_display.py
+
+Use the widget as a small USB display. Selects the remote page, then
+streams frames as "RECT x0 y0 x1 y1" commands, each followed by the
+rectangle's RGB565 pixels as raw big-endian bytes, the panel's own
+order. The widget reads them straight into DMA buffers, and USB flow
+control paces the stream.
+
+Frames come from a raw RGB565BE file or stdin, which works with ffmpeg:
+
+    ffmpeg -i clip.mp4 -vf scale=320:240 -f rawvideo -pix_fmt rgb565be - |
+        remote_display.py /dev/ttyACM0 --raw -
+
+or, with no --raw, from a built-in moving test pattern. With --delta only
+bands of rows that changed since the previous frame are sent.
+
+Requires pyserial.
+
+Usage:
+    remote_display.py /dev/ttyACM0 [--raw FILE|-] [--fps 30] [--delta]
+"""
+
+import argparse
+import math
+import sys
+import time
+
+try:
+    import serial
+except ImportError:
+    sys.exit("remote_display.py needs pyserial (pip install pyserial)")
+
+
+def rgb565(r, g, b):
+    return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3)
+
+
+def pattern_frames(width, height):
+    """Scrolling colour bars with a bouncing square."""
+    bars = [rgb565(255, 0, 0), rgb565(0, 255, 0), rgb565(0, 0, 255),
+            rgb565(255, 255, 0), rgb565(0, 255, 255), rgb565(255, 0, 255),
+            rgb565(255, 255, 255), rgb565(0, 0, 0)]
+    n = 0
+    while True:
+        row = bytearray()
+        for x in range(width):
+            c = bars[((x + n * 4) * len(bars) // width) % len(bars)]
+            row += c.to_bytes(2, "big")
+        frame = bytearray(row * height)
+        size = height // 4
+        sx = int((width - size) * (0.5 + 0.5 * math.sin(n / 20.0)))
+        sy = int((height - size) * (0.5 + 0.5 * math.cos(n / 13.0)))
+        black = b"\x00\x00" * size
+        for y in range(sy, sy + size):
+            i = (y * width + sx) * 2
+            frame[i:i + size * 2] = black
+        yield bytes(frame)
+        n += 1
+
+
+def raw_frames(path, width, height):
+    size = width * height * 2
+    f = sys.stdin.buffer if path == "-" else open(path, "rb")
+    while True:
+        frame = f.read(size)
+        if len(frame) < size:
+            return
+        yield frame
+
+
+def bands(frame, prev, width, height, rows):
+    """(y0, y1) bands of rows to send; all of them unless prev is set."""
+    stride = width * 2
+    for y0 in range(0, height, rows):
+        y1 = min(y0 + rows, height) - 1
+        a, b = y0 * stride, (y1 + 1) * stride
+        if prev is None or frame[a:b] != prev[a:b]:
+            yield y0, y1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    ap.add_argument("port")
+    ap.add_argument("--raw", help="RGB565BE frame file, or - for stdin")
+    ap.add_argument("--width", type=int, default=320)
+    ap.add_argument("--height", type=int, default=240)
+    ap.add_argument("--fps", type=float, default=0,
+                    help="frame rate limit; 0 sends as fast as USB allows")
+    ap.add_argument("--rows", type=int, default=16,
+                    help="rows per RECT")
+    ap.add_argument("--delta", action="store_true",
+                    help="send only changed bands")
+    args = ap.parse_args()
+
+    if args.raw:
+        frames = raw_frames(args.raw, args.width, args.height)
+    else:
+        frames = pattern_frames(args.width, args.height)
+
+    stride = args.width * 2
+    with serial.Serial(args.port, 115200, timeout=0) as port:
+        port.write(b"PAGE remote\n")
+        port.flush()
+        time.sleep(0.2)
+        port.reset_input_buffer()
+
+        prev = None
+        count, sent, start = 0, 0, time.monotonic()
+        next_at = start
+        for frame in frames:
+            for y0, y1 in bands(frame, prev if args.delta else None,
+                                args.width, args.height, args.rows):
+                port.write(b"RECT 0 %d %d %d\n" % (y0, args.width - 1, y1))
+                port.write(frame[y0 * stride:(y1 + 1) * stride])
+                sent += (y1 - y0 + 1) * stride
+            port.read(4096)
+            prev = frame
+            count += 1
+
+            now = time.monotonic()
+            if now - start >= 2.0:
+                print("%.1f fps %.0f KB/s" % (count / (now - start),
+                                              sent / 1024 / (now - start)))
+                count, sent, start = 0, 0, now
+            if args.fps > 0:
+                next_at += 1.0 / args.fps
+                if next_at > now:
+                    time.sleep(next_at - now)
+                else:
+                    next_at = now
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+screenshot.py
+
+Host side of the widget's screen capture. Sends "SHOT", which makes the
+widget redraw its current page while run-length encoding every address
+window and pixel transfer sent to the panel, then replays those chunks
+onto a blank frame and writes it as a PNG.
+
+Chunks start with A5 5C, a type and a payload length, and their bytes
+sum to 0 mod 256; anything else on the port (text replies, telemetry)
+is skipped. Pixels fill the last address window row by row, as the
+panel does.
+
+Requires pyserial.
+
+Usage:
+    screenshot.py /dev/ttyACM0 [-o shot.png] [--ms 0]
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+try:
+    import serial
+except ImportError:
+    sys.exit("screenshot.py needs pyserial (pip install pyserial)")
+
+SYNC = b"\xa5\x5c"
+BEGIN, WINDOW, RUNS, END = 0, 1, 2, 3
+PAYLOAD_MAX = 59
+
+
+class Decoder:
+    """Splits a byte stream into (type, payload) chunks."""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        out = []
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                keep = 1 if self.buf[-1:] == SYNC[:1] else 0
+                del self.buf[:len(self.buf) - keep]
+                break
+            del self.buf[:i]
+            if len(self.buf) < 4:
+                break
+            ctype, n = self.buf[2], self.buf[3]
+            if ctype > END or n > PAYLOAD_MAX:
+                del self.buf[:1]
+                continue
+            if len(self.buf) < 5 + n:
+                break
+            chunk = bytes(self.buf[:5 + n])
+            if sum(chunk) & 0xff != 0:
+                del self.buf[:1]
+                continue
+            out.append((ctype, chunk[4:4 + n]))
+            del self.buf[:5 + n]
+        return out
+
+
+class Frame:
+    """Replays windows and pixel runs the way the panel applies them."""
+
+    def __init__(self, width, height):
+        self.width = width
+        self.height = height
+        self.pixels = [0] * (width * height)
+        self.window = (0, 0, width - 1, height - 1)
+        self.x, self.y = 0, 0
+        self.count = 0
+
+    def set_window(self, x0, y0, x1, y1):
+        self.window = (x0, y0, x1, y1)
+        self.x, self.y = x0, y0
+
+    def put(self, count, color):
+        x0, y0, x1, y1 = self.window
+        for _ in range(count):
+            if self.x < self.width and self.y < self.height:
+                self.pixels[self.y * self.width + self.x] = color
+            self.count += 1
+            self.x += 1
+            if self.x > x1:
+                self.x = x0
+                self.y += 1
+                if self.y > y1:
+                    self.y = y0
+
+    def png(self):
+        rows = bytearray()
+        for y in range(self.height):
+            rows.append(0)
+            for c in self.pixels[y * self.width:(y + 1) * self.width]:
+                r, g, b = (c >> 11) & 0x1f, (c >> 5) & 0x3f, c & 0x1f
+                rows += bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4),
+                               (b << 3) | (b >> 2)))
+
+        def chunk(tag, data):
+            body = tag + data
+            return (struct.pack(">I", len(data)) + body +
+                    struct.pack(">I", zlib.crc32(body) & 0xffffffff))
+
+        ihdr = struct.pack(">IIBBBBB", self.width, self.height, 8, 2, 0, 0, 0)
+        return (b"\x89PNG\r\n\x1a\n" + chunk(b"IHDR", ihdr) +
+                chunk(b"IDAT", zlib.compress(bytes(rows), 9)) +
+                chunk(b"IEND", b""))
+
+
+def capture(port, ms, timeout):
+    """Run one capture; returns (frame, page, sent) or None."""
+    dec = Decoder()
+    frame = None
+    page = 0
+    port.reset_input_buffer()
+    port.write(b"SHOT %d\n" % ms)
+    port.flush()
+
+    end = time.monotonic() + timeout + ms / 1000.0
+    while time.monotonic() < end:
+        for ctype, p in dec.feed(port.read(4096)):
+            if ctype == BEGIN:
+                width, height, page = struct.unpack("<HHB", p)
+                frame = Frame(width, height)
+            elif frame is None:
+                continue
+            elif ctype == WINDOW:
+                frame.set_window(*struct.unpack("<HHHH", p))
+            elif ctype == RUNS:
+                for i in range(0, len(p), 3):
+                    count, color = struct.unpack_from("<BH", p, i)
+                    frame.put(count, color)
+            elif ctype == END:
+                sent = struct.unpack("<I", p)[0]
+                return frame, page, sent
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    ap.add_argument("port")
+    ap.add_argument("-o", "--output", default="shot.png")
+    ap.add_argument("--ms", type=int, default=0,
+                    help="keep capturing page updates this long")
+    ap.add_argument("--timeout", type=float, default=5.0)
+    args = ap.parse_args()
+
+    with serial.Serial(args.port, 115200, timeout=0.1) as port:
+        result = capture(port, args.ms, args.timeout)
+    if result is None:
+        sys.exit("no capture received")
+
+    frame, page, sent = result
+    if frame.count != sent:
+        print("warning: got %d of %d pixels" % (frame.count, sent),
+              file=sys.stderr)
+    with open(args.output, "wb") as f:
+        f.write(frame.png())
+    print("page %d %dx%d -> %s" % (page, frame.width, frame.height,
+                                   args.output))
+
+
+if __name__ == "__main__":
+    main()
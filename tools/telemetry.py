@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+telemetry.py
+
+Host side of the widget's binary telemetry stream. Sends "TLM 1", then
+decodes the 24-byte records the render core produces for every page
+update and page entry, and prints a per-page summary every period:
+updates per second, mean and worst update time, pixels per second,
+estimated SPI DMA utilisation, page work per second (Mandelbrot
+iterations, ball steps), missed ticks, overruns and dropped records.
+
+Records start with A5 5A and their bytes sum to 0 mod 256; anything
+else on the port (text replies) is skipped, and the decoder resyncs
+on the next valid record. DMA utilisation is pixels * 16 bits divided
+by the SPI baud rate from the HELLO record, per second of wall time.
+
+Requires pyserial.
+
+Usage:
+    telemetry.py /dev/ttyACM0 [--period 1.0] [--raw]
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+try:
+    import serial
+except ImportError:
+    sys.exit("telemetry.py needs pyserial (pip install pyserial)")
+
+RECORD = struct.Struct("<BBBBIIIIHBB")
+SYNC = b"\xa5\x5a"
+HELLO, TICK, ENTER = 0, 1, 2
+FLAG_MISSED, FLAG_OVERRUN = 1, 2
+
+
+class Decoder:
+    """Splits a byte stream into records, skipping anything else."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.skipped = 0
+
+    def feed(self, data):
+        self.buf += data
+        out = []
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                keep = 1 if self.buf[-1:] == SYNC[:1] else 0
+                self.skipped += len(self.buf) - keep
+                del self.buf[:len(self.buf) - keep]
+                break
+            self.skipped += i
+            del self.buf[:i]
+            if len(self.buf) < RECORD.size:
+                break
+            rec = bytes(self.buf[:RECORD.size])
+            fields = RECORD.unpack(rec)
+            if sum(rec) & 0xff == 0 and fields[2] <= ENTER:
+                out.append(fields[2:10])
+                del self.buf[:RECORD.size]
+            else:
+                self.skipped += 1
+                del self.buf[:1]
+        return out
+
+
+class PageSummary:
+    def __init__(self):
+        self.ticks = 0
+        self.dur = 0
+        self.max_dur = 0
+        self.pixels = 0
+        self.work = 0
+        self.missed = 0
+        self.overruns = 0
+        self.enters = []
+
+    def add(self, rtype, dur, pixels, work, flags):
+        self.pixels += pixels
+        if rtype == ENTER:
+            self.enters.append((dur, work))
+            return
+        self.ticks += 1
+        self.dur += dur
+        self.max_dur = max(self.max_dur, dur)
+        self.work += work
+        self.missed += bool(flags & FLAG_MISSED)
+        self.overruns += bool(flags & FLAG_OVERRUN)
+
+
+def report(pages, elapsed, baud, dropped):
+    for page in sorted(pages):
+        s = pages[page]
+        mean = s.dur // s.ticks if s.ticks else 0
+        line = ("page %d: %5.1f/s dur=%dus max=%dus px=%d/s" %
+                (page, s.ticks / elapsed, mean, s.max_dur,
+                 s.pixels / elapsed))
+        if baud:
+            line += " dma=%.1f%%" % (100.0 * s.pixels * 16 / baud / elapsed)
+        line += " work=%d/s missed=%d overrun=%d" % (
+            s.work / elapsed, s.missed, s.overruns)
+        for dur, slices in s.enters:
+            line += " enter=%dus/%d" % (dur, slices)
+        print(line)
+    print("dropped=%d" % dropped)
+    sys.stdout.flush()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    ap.add_argument("port")
+    ap.add_argument("--period", type=float, default=1.0,
+                    help="seconds between summaries")
+    ap.add_argument("--raw", action="store_true",
+                    help="print every record instead of summaries")
+    args = ap.parse_args()
+
+    dec = Decoder()
+    baud = 0
+    pages = {}
+    dropped = 0
+    with serial.Serial(args.port, 115200, timeout=0.1) as port:
+        port.write(b"TLM 1\n")
+        port.flush()
+        start = time.monotonic()
+        try:
+            while True:
+                for rec in dec.feed(port.read(4096)):
+                    rtype, page, t_us, dur, pixels, work, drop, flags = rec
+                    if args.raw:
+                        print("%d page=%d t=%d dur=%d px=%d work=%d "
+                              "drop=%d flags=%x" % rec)
+                    if rtype == HELLO:
+                        baud = dur
+                        print("HELLO baud=%d pages=%d" % (baud, work))
+                        continue
+                    dropped = drop
+                    pages.setdefault(page, PageSummary()).add(
+                        rtype, dur, pixels, work, flags)
+
+                now = time.monotonic()
+                if not args.raw and now - start >= args.period:
+                    report(pages, now - start, baud, dropped)
+                    pages = {}
+                    start = now
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.write(b"TLM 0\n")
+            port.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+timesync.py
+
+Host side of the widget's drift-corrected time sync. Plays the role of
+an NTP client: every interval it sends a burst of "Y" probes over the
+USB serial port, keeps the one with the shortest round trip, and sends
+back "Y <local_us> <host_us> <rtt_us>" with the host UTC time at the
+middle of that round trip. The widget fits its crystal drift from these
+samples and slews its clock toward the host.
+
+Requires pyserial.
+
+Usage:
+    timesync.py /dev/ttyACM0 [--interval 60] [--probes 8] [--once]
+"""
+
+import argparse
+import sys
+import time
+
+try:
+    import serial
+except ImportError:
+    sys.exit("timesync.py needs pyserial (pip install pyserial)")
+
+
+def now_us():
+    return time.time_ns() // 1000
+
+
+def read_reply(port, prefixes, timeout):
+    """Return the first line starting with one of prefixes."""
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        line = port.readline().decode("ascii", "replace").strip()
+        if line.startswith(prefixes):
+            return line
+    return None
+
+
+def probe(port, timeout):
+    """One round trip; returns (local_us, host_mid_us, rtt_us)."""
+    port.reset_input_buffer()
+    t0 = now_us()
+    port.write(b"Y\n")
+    port.flush()
+    line = read_reply(port, ("Y ",), timeout)
+    t3 = now_us()
+    if line is None:
+        return None
+    local_us = int(line.split()[1])
+    return local_us, (t0 + t3) // 2, t3 - t0
+
+
+def sync_once(port, probes, timeout):
+    best = None
+    for _ in range(probes):
+        p = probe(port, timeout)
+        if p is not None and (best is None or p[2] < best[2]):
+            best = p
+        time.sleep(0.05)
+    if best is None:
+        print("no reply from widget", file=sys.stderr)
+        return False
+
+    local_us, host_us, rtt_us = best
+    port.write(b"Y %d %d %d\n" % (local_us, host_us, rtt_us))
+    port.flush()
+
+    status = None
+    while True:
+        line = read_reply(port, ("SYNC", "OK", "ERR"), timeout)
+        if line is None or line.startswith(("OK", "ERR")):
+            break
+        status = line
+    print("rtt=%dus %s %s" % (rtt_us, status or "", line or "timeout"))
+    return line == "OK"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    ap.add_argument("port")
+    ap.add_argument("--interval", type=float, default=60.0,
+                    help="seconds between samples")
+    ap.add_argument("--probes", type=int, default=8,
+                    help="probes per sample; the fastest is used")
+    ap.add_argument("--timeout", type=float, default=0.5)
+    ap.add_argument("--once", action="store_true")
+    args = ap.parse_args()
+
+    with serial.Serial(args.port, 115200, timeout=args.timeout) as port:
+        while True:
+            sync_once(port, args.probes, args.timeout)
+            if args.once:
+                break
+            time.sleep(args.interval)
+
+
+if __name__ == "__main__":
+    main()